@@ -4,16 +4,33 @@ from esphome.components.http_request import CONF_HTTP_REQUEST_ID, HttpRequestCom
 from esphome.components.display import Display
 from esphome.components.font import Font
 from esphome.components.time import RealTimeClock
-from esphome.components import color
-from esphome.const import CONF_ID, CONF_DISPLAY_ID, CONF_TIME_ID, CONF_SHOW_UNITS, __version__ as ESPHOME_VERSION
+from esphome.components import color, sensor, text_sensor
+from esphome.core import CORE
+from esphome.helpers import cpp_string_escape
+from esphome.const import (
+    CONF_ID,
+    CONF_DISPLAY_ID,
+    CONF_TIME_ID,
+    CONF_SHOW_UNITS,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_BYTES,
+    UNIT_MILLISECOND,
+    __version__ as ESPHOME_VERSION,
+)
 
 _MINIMUM_ESPHOME_VERSION = "2025.7.0"
 
 DEPENDENCIES = ["network"]
-AUTO_LOAD = ["json", "watchdog"]
+AUTO_LOAD = ["json", "sensor", "text_sensor"]
+MULTI_CONF = True
 
 transit_tracker_ns = cg.esphome_ns.namespace("transit_tracker")
 TransitTracker = transit_tracker_ns.class_("TransitTracker", cg.Component)
+ConnectionHub = transit_tracker_ns.class_("ConnectionHub", cg.Component)
+RouteStyleEntry = transit_tracker_ns.struct("RouteStyleEntry")
+AbbreviationEntry = transit_tracker_ns.struct("AbbreviationEntry")
 
 UnitDisplay = transit_tracker_ns.enum("UnitDisplay")
 UNIT_DISPLAY_VALUES = {
@@ -22,9 +39,22 @@ UNIT_DISPLAY_VALUES = {
     "none": UnitDisplay.UNIT_DISPLAY_NONE,
 }
 
+MemoryPlacement = transit_tracker_ns.enum("MemoryPlacement")
+MEMORY_PLACEMENT_VALUES = {
+    "internal": MemoryPlacement.MEMORY_PLACEMENT_INTERNAL,
+    "psram": MemoryPlacement.MEMORY_PLACEMENT_PSRAM,
+}
+
+MessageEncoding = transit_tracker_ns.enum("MessageEncoding")
+MESSAGE_ENCODING_VALUES = {
+    "json": MessageEncoding.MESSAGE_ENCODING_JSON,
+    "msgpack": MessageEncoding.MESSAGE_ENCODING_MSGPACK,
+}
+
 CONF_ROUTES = "routes"
 CONF_STOPS = "stops"
 CONF_BASE_URL = "base_url"
+CONF_HUB_ID = "hub_id"
 CONF_FONT_ID = "font_id"
 CONF_LIMIT = "limit"
 CONF_ABBREVIATIONS = "abbreviations"
@@ -35,6 +65,35 @@ CONF_TIME_DISPLAY = "time_display"
 CONF_LIST_MODE = "list_mode"
 CONF_SCROLL_HEADSIGNS = "scroll_headsigns"
 CONF_RTL_MODE = "rtl_mode"
+CONF_SCHEDULE_PATCHES = "schedule_patches"
+CONF_ENCODING = "encoding"
+CONF_TELEMETRY_INTERVAL = "telemetry_interval"
+CONF_PERSIST_SCHEDULE = "persist_schedule"
+CONF_MEMORY_PLACEMENT = "memory_placement"
+CONF_NETWORK_TASK = "network_task"
+CONF_RENDER_TIME = "render_time"
+CONF_PARSE_TIME = "parse_time"
+CONF_LOCK_TIME = "lock_time"
+CONF_MESSAGE_SIZE = "message_size"
+CONF_HEAP_MIN_FREE = "heap_min_free"
+CONF_LARGEST_FREE_BLOCK = "largest_free_block"
+CONF_ALLOC_FAILURES = "alloc_failures"
+CONF_CONNECTION_RTT = "connection_rtt"
+CONF_TELEMETRY_SUMMARY = "telemetry_summary"
+
+_TIMING_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_MILLISECOND,
+    accuracy_decimals=2,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
+
+_BYTES_SENSOR_SCHEMA = sensor.sensor_schema(
+    unit_of_measurement=UNIT_BYTES,
+    accuracy_decimals=0,
+    state_class=STATE_CLASS_MEASUREMENT,
+    entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+)
 
 
 def validate_ws_url(value):
@@ -54,11 +113,19 @@ def validate_esphome_version(obj):
     return obj
 
 
+def validate_http_request(config):
+    # Schedules are polled from the server that base_url points at
+    if CONF_HTTP_REQUEST_ID in config and CONF_BASE_URL not in config:
+        raise cv.Invalid(f"'{CONF_HTTP_REQUEST_ID}' requires '{CONF_BASE_URL}' to be set")
+    return config
+
+
 CONFIG_SCHEMA = cv.All(
     validate_esphome_version,
     cv.Schema(
         {
             cv.GenerateID(): cv.declare_id(TransitTracker),
+            cv.GenerateID(CONF_HUB_ID): cv.declare_id(ConnectionHub),
             cv.GenerateID(CONF_DISPLAY_ID): cv.use_id(Display),
             cv.GenerateID(CONF_FONT_ID): cv.use_id(Font),
             cv.GenerateID(CONF_TIME_ID): cv.use_id(RealTimeClock),
@@ -73,6 +140,28 @@ CONFIG_SCHEMA = cv.All(
             ),
             cv.Optional(CONF_SCROLL_HEADSIGNS, default=False) : cv.boolean,
             cv.Optional(CONF_RTL_MODE, default=False) : cv.boolean,
+            cv.Optional(CONF_SCHEDULE_PATCHES, default=False): cv.boolean,
+            cv.Optional(CONF_ENCODING, default="json"): cv.enum(MESSAGE_ENCODING_VALUES),
+            cv.Optional(CONF_PERSIST_SCHEDULE, default=True): cv.boolean,
+            cv.Optional(CONF_MEMORY_PLACEMENT, default="psram"): cv.enum(MEMORY_PLACEMENT_VALUES),
+            cv.Optional(CONF_NETWORK_TASK, default=False): cv.boolean,
+            cv.Optional(CONF_HTTP_REQUEST_ID): cv.use_id(HttpRequestComponent),
+            cv.Optional(CONF_TELEMETRY_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_RENDER_TIME): _TIMING_SENSOR_SCHEMA,
+            cv.Optional(CONF_PARSE_TIME): _TIMING_SENSOR_SCHEMA,
+            cv.Optional(CONF_LOCK_TIME): _TIMING_SENSOR_SCHEMA,
+            cv.Optional(CONF_MESSAGE_SIZE): _BYTES_SENSOR_SCHEMA,
+            cv.Optional(CONF_HEAP_MIN_FREE): _BYTES_SENSOR_SCHEMA,
+            cv.Optional(CONF_LARGEST_FREE_BLOCK): _BYTES_SENSOR_SCHEMA,
+            cv.Optional(CONF_ALLOC_FAILURES): sensor.sensor_schema(
+                accuracy_decimals=0,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_CONNECTION_RTT): _TIMING_SENSOR_SCHEMA,
+            cv.Optional(CONF_TELEMETRY_SUMMARY): text_sensor.text_sensor_schema(
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
             cv.Optional(CONF_STOPS, default=[]): cv.ensure_list(
                 cv.Schema(
                     {
@@ -103,6 +192,7 @@ CONFIG_SCHEMA = cv.All(
             ),
         }
     ).extend(cv.COMPONENT_SCHEMA),
+    validate_http_request,
 )
 
 
@@ -116,9 +206,48 @@ def _generate_schedule_string(stops):
     )
 
 
+def _add_flash_table(config, name, entry_type, entries):
+    # Emitted as a static const array so the entries and their strings stay in
+    # flash instead of being copied into RAM at boot
+    table = f"{config[CONF_ID]}_{name}"
+    cg.add_global(
+        cg.RawStatement(
+            f"static const {entry_type} {table}[] = {{\n  " + ",\n  ".join(entries) + "\n};"
+        )
+    )
+    return cg.RawExpression(table)
+
+
+async def _get_connection_hub(config):
+    # Trackers pointed at the same server share one connection; the first
+    # tracker for each base URL creates its hub.
+    hubs = CORE.data.setdefault("transit_tracker", {}).setdefault("hubs", {})
+    base_url = config.get(CONF_BASE_URL, "")
+
+    if base_url not in hubs:
+        hub = cg.new_Pvariable(config[CONF_HUB_ID])
+        cg.add(hub.set_base_url(base_url))
+        await cg.register_component(hub, {})
+        hubs[base_url] = hub
+
+    # The connection is shared, so any tracker can move it to its own task
+    if config[CONF_NETWORK_TASK]:
+        cg.add(hubs[base_url].set_network_task(True))
+
+    # Likewise for the HTTP polling fallback
+    if CONF_HTTP_REQUEST_ID in config:
+        http_request = await cg.get_variable(config[CONF_HTTP_REQUEST_ID])
+        cg.add(hubs[base_url].set_http_request(http_request))
+        cg.add_define("USE_TRANSIT_TRACKER_HTTP_POLLING")
+
+    return hubs[base_url]
+
+
 async def to_code(config):
     var = cg.new_Pvariable(config[CONF_ID])
 
+    cg.add(var.set_hub(await _get_connection_hub(config)))
+
     drawing_display = await cg.get_variable(config[CONF_DISPLAY_ID])
     cg.add(var.set_display(drawing_display))
 
@@ -128,9 +257,6 @@ async def to_code(config):
     time = await cg.get_variable(config[CONF_TIME_ID])
     cg.add(var.set_rtc(time))
 
-    if CONF_BASE_URL in config:
-        cg.add(var.set_base_url(config[CONF_BASE_URL]))
-
     cg.add(var.set_feed_code(config[CONF_FEED_CODE]))
     cg.add(var.set_schedule_string(_generate_schedule_string(config[CONF_STOPS])))
 
@@ -140,14 +266,24 @@ async def to_code(config):
     cg.add(var.set_list_mode(config[CONF_LIST_MODE]))
     cg.add(var.set_scroll_headsigns(config[CONF_SCROLL_HEADSIGNS]))
     cg.add(var.set_rtl_mode(config[CONF_RTL_MODE]))
+    cg.add(var.set_schedule_patches(config[CONF_SCHEDULE_PATCHES]))
+    cg.add(var.set_message_encoding(config[CONF_ENCODING]))
+    cg.add(var.set_persist_schedule(config[CONF_PERSIST_SCHEDULE]))
+    cg.add(var.set_memory_placement(config[CONF_MEMORY_PLACEMENT]))
 
     cg.add(var.set_limit(config[CONF_LIMIT]))
 
     cg.add(var.set_unit_display(config[CONF_SHOW_UNITS]))
 
-    if CONF_ABBREVIATIONS in config:
-        for abbreviation in config[CONF_ABBREVIATIONS]:
-            cg.add(var.add_abbreviation(abbreviation["from"], abbreviation["to"]))
+    if config.get(CONF_ABBREVIATIONS):
+        # Later entries win, as they did when each one was added at runtime
+        abbreviations = {a["from"]: a["to"] for a in config[CONF_ABBREVIATIONS]}
+        entries = [
+            f"{{{cpp_string_escape(from_)}, {cpp_string_escape(to)}}}"
+            for from_, to in abbreviations.items()
+        ]
+        table = _add_flash_table(config, "abbreviations", AbbreviationEntry, entries)
+        cg.add(var.set_abbreviation_table(table, len(entries)))
 
     if CONF_DEFAULT_ROUTE_COLOR in config:
         cg.add(
@@ -156,10 +292,38 @@ async def to_code(config):
             )
         )
 
-    if CONF_STYLES in config:
-        for style in config[CONF_STYLES]:
+    if config.get(CONF_STYLES):
+        styles = {style["route_id"]: style for style in config[CONF_STYLES]}
+        entries = []
+        # Sorted in strcmp() order for the binary search at ingest
+        for route_id in sorted(styles, key=lambda route_id: route_id.encode()):
+            style = styles[route_id]
             color_struct = await cg.get_variable(style["color"])
-            cg.add(var.add_route_style(style["route_id"], style["name"], color_struct))
+            entries.append(
+                f"{{{cpp_string_escape(route_id)}, {cpp_string_escape(style['name'])}, &{color_struct}}}"
+            )
+        table = _add_flash_table(config, "route_styles", RouteStyleEntry, entries)
+        cg.add(var.set_route_style_table(table, len(entries)))
+
+    cg.add(var.set_telemetry_interval(config[CONF_TELEMETRY_INTERVAL]))
+
+    for key, setter in (
+        (CONF_RENDER_TIME, var.set_render_time_sensor),
+        (CONF_PARSE_TIME, var.set_parse_time_sensor),
+        (CONF_LOCK_TIME, var.set_lock_time_sensor),
+        (CONF_MESSAGE_SIZE, var.set_message_size_sensor),
+        (CONF_HEAP_MIN_FREE, var.set_heap_min_free_sensor),
+        (CONF_LARGEST_FREE_BLOCK, var.set_largest_free_block_sensor),
+        (CONF_ALLOC_FAILURES, var.set_alloc_failures_sensor),
+        (CONF_CONNECTION_RTT, var.set_connection_rtt_sensor),
+    ):
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(setter(sens))
+
+    if CONF_TELEMETRY_SUMMARY in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_TELEMETRY_SUMMARY])
+        cg.add(var.set_telemetry_summary_text_sensor(sens))
 
     await cg.register_component(var, config)
 
@@ -0,0 +1,211 @@
+#include "abbreviations.h"
+
+#include <cstring>
+
+namespace esphome {
+namespace transit_tracker {
+
+void AbbreviationMatcher::set_table(const AbbreviationEntry *table, size_t size) {
+  this->table_ = table;
+  this->table_size_ = size;
+  this->dirty_ = true;
+}
+
+void AbbreviationMatcher::add(const std::string &from, const std::string &to) {
+  if (from.empty()) {
+    return;
+  }
+
+  this->rules_[from] = to;
+  this->dirty_ = true;
+}
+
+void AbbreviationMatcher::clear() {
+  this->rules_.clear();
+  this->dirty_ = true;
+}
+
+uint32_t AbbreviationMatcher::child_(uint32_t node, uint8_t label) const {
+  // Children are stored contiguously and sorted by label
+  uint32_t lo = this->nodes_[node].first_child;
+  uint32_t hi = lo + this->nodes_[node].child_count;
+
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    uint8_t mid_label = this->nodes_[mid].label;
+    if (mid_label == label) {
+      return mid;
+    }
+    if (mid_label < label) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return 0;
+}
+
+void AbbreviationMatcher::compile() {
+  this->dirty_ = false;
+  this->patterns_.clear();
+  this->nodes_.clear();
+
+  // Table entries are referenced in place; runtime rules shadow them
+  for (size_t i = 0; i < this->table_size_; i++) {
+    const AbbreviationEntry &entry = this->table_[i];
+    if (entry.from[0] == '\0' || this->rules_.count(entry.from) != 0) {
+      continue;
+    }
+
+    this->patterns_.push_back(Pattern{
+      entry.from, entry.to, static_cast<uint16_t>(strlen(entry.from)), static_cast<uint16_t>(strlen(entry.to))
+    });
+  }
+
+  for (const auto &rule : this->rules_) {
+    this->patterns_.push_back(Pattern{
+      rule.first.c_str(), rule.second.c_str(), static_cast<uint16_t>(rule.first.length()),
+      static_cast<uint16_t>(rule.second.length())
+    });
+  }
+
+  if (this->patterns_.empty()) {
+    return;
+  }
+
+  // Build a plain trie first, then lay it out in breadth-first order so that
+  // each node's children occupy a contiguous, label-sorted range.
+  struct BuildNode {
+    std::map<uint8_t, uint32_t> children;
+    int32_t pattern = -1;
+  };
+
+  std::vector<BuildNode> trie(1);
+
+  for (size_t i = 0; i < this->patterns_.size(); i++) {
+    const Pattern &pattern = this->patterns_[i];
+    uint32_t node = 0;
+    for (size_t j = 0; j < pattern.from_length; j++) {
+      auto label = static_cast<uint8_t>(pattern.from[j]);
+      auto it = trie[node].children.find(label);
+      if (it == trie[node].children.end()) {
+        trie[node].children[label] = trie.size();
+        node = trie.size();
+        trie.emplace_back();
+      } else {
+        node = it->second;
+      }
+    }
+
+    // Table entries sharing a pattern resolve to the later one, as with add()
+    trie[node].pattern = i;
+  }
+
+  this->nodes_.resize(trie.size());
+
+  std::vector<uint32_t> order;
+  order.reserve(trie.size());
+  order.push_back(0);
+
+  for (uint32_t id = 0; id < order.size(); id++) {
+    BuildNode &source = trie[order[id]];
+    Node &node = this->nodes_[id];
+
+    node.pattern = source.pattern;
+    node.first_child = order.size();
+    node.child_count = source.children.size();
+
+    for (const auto &child : source.children) {
+      this->nodes_[order.size()].label = child.first;
+      order.push_back(child.second);
+    }
+  }
+
+  trie.clear();
+  trie.shrink_to_fit();
+
+  // Failure and dictionary-suffix links, in breadth-first order
+  for (uint32_t id = 0; id < this->nodes_.size(); id++) {
+    const Node &node = this->nodes_[id];
+
+    for (uint32_t child = node.first_child; child < node.first_child + node.child_count; child++) {
+      uint8_t label = this->nodes_[child].label;
+      uint32_t fail = 0;
+
+      if (id != 0) {
+        uint32_t state = node.fail;
+        while (state != 0 && this->child_(state, label) == 0) {
+          state = this->nodes_[state].fail;
+        }
+        fail = this->child_(state, label);
+      }
+
+      this->nodes_[child].fail = fail;
+      this->nodes_[child].dict = this->nodes_[fail].pattern >= 0 ? fail : this->nodes_[fail].dict;
+    }
+  }
+}
+
+std::string AbbreviationMatcher::apply(const std::string &text) {
+  if (this->dirty_) {
+    this->compile();
+  }
+
+  if (this->nodes_.size() <= 1 || text.empty()) {
+    return text;
+  }
+
+  // Longest rule starting at each byte offset
+  std::vector<int32_t> best(text.length(), -1);
+  bool matched = false;
+
+  uint32_t state = 0;
+  for (size_t i = 0; i < text.length(); i++) {
+    auto label = static_cast<uint8_t>(text[i]);
+
+    uint32_t next = this->child_(state, label);
+    while (next == 0 && state != 0) {
+      state = this->nodes_[state].fail;
+      next = this->child_(state, label);
+    }
+    state = next;
+
+    uint32_t output = this->nodes_[state].pattern >= 0 ? state : this->nodes_[state].dict;
+    while (output != 0) {
+      int32_t pattern = this->nodes_[output].pattern;
+      size_t length = this->patterns_[pattern].from_length;
+      size_t start = i + 1 - length;
+
+      if (best[start] < 0 || length > this->patterns_[best[start]].from_length) {
+        best[start] = pattern;
+      }
+
+      matched = true;
+      output = this->nodes_[output].dict;
+    }
+  }
+
+  if (!matched) {
+    return text;
+  }
+
+  std::string result;
+  result.reserve(text.length());
+
+  for (size_t i = 0; i < text.length();) {
+    if (best[i] < 0) {
+      result += text[i++];
+      continue;
+    }
+
+    const Pattern &pattern = this->patterns_[best[i]];
+    result.append(pattern.to, pattern.to_length);
+    i += pattern.from_length;
+  }
+
+  return result;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace transit_tracker {
+
+// Generated at compile time from the YAML config; kept in flash
+struct AbbreviationEntry {
+  const char *from;
+  const char *to;
+};
+
+// Multi-pattern abbreviation rules compiled into an Aho-Corasick automaton.
+// Every non-overlapping occurrence is replaced in a single left-to-right pass,
+// preferring the leftmost and then the longest matching rule.
+class AbbreviationMatcher {
+  public:
+    // Rules added at runtime take precedence over table entries with the same
+    // pattern, and clear() only removes those.
+    void set_table(const AbbreviationEntry *table, size_t size);
+    void add(const std::string &from, const std::string &to);
+    void clear();
+
+    // Number of rules in effect as of the last compile()
+    size_t size() const { return this->patterns_.size(); }
+    bool empty() const { return this->table_size_ == 0 && this->rules_.empty(); }
+
+    void compile();
+    std::string apply(const std::string &text);
+
+  protected:
+    struct Node {
+      uint32_t first_child = 0;
+      uint16_t child_count = 0;
+      uint8_t label = 0;
+      int32_t pattern = -1;
+      uint32_t fail = 0;
+      uint32_t dict = 0;
+    };
+
+    struct Pattern {
+      const char *from;
+      const char *to;
+      uint16_t from_length;
+      uint16_t to_length;
+    };
+
+    uint32_t child_(uint32_t node, uint8_t label) const;
+
+    const AbbreviationEntry *table_ = nullptr;
+    size_t table_size_ = 0;
+    std::map<std::string, std::string> rules_;
+    std::vector<Pattern> patterns_;
+    std::vector<Node> nodes_;
+    bool dirty_ = true;
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
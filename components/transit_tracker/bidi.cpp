@@ -0,0 +1,308 @@
+#include "bidi.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace transit_tracker {
+
+enum BidiType : uint8_t {
+  BIDI_L,    // Strong left-to-right
+  BIDI_R,    // Strong right-to-left
+  BIDI_EN,   // European number
+  BIDI_ES,   // European separator
+  BIDI_ET,   // European terminator
+  BIDI_CS,   // Common separator
+  BIDI_NSM,  // Non-spacing mark
+  BIDI_WS,   // Whitespace
+  BIDI_ON,   // Other neutral
+};
+
+struct BidiChar {
+  uint16_t offset;
+  uint8_t length;
+  uint8_t type;
+  uint8_t level;
+  uint32_t code_point;
+};
+
+static uint32_t decode_utf8(const std::string &s, size_t i, uint8_t *length) {
+  unsigned char c = s[i];
+  uint8_t len = 1;
+  uint32_t cp = c;
+
+  if ((c & 0xE0) == 0xC0) {
+    len = 2;
+    cp = c & 0x1F;
+  } else if ((c & 0xF0) == 0xE0) {
+    len = 3;
+    cp = c & 0x0F;
+  } else if ((c & 0xF8) == 0xF0) {
+    len = 4;
+    cp = c & 0x07;
+  } else if ((c & 0x80) != 0) {
+    // Stray continuation or invalid lead byte; pass it through as a neutral
+    *length = 1;
+    return 0xFFFD;
+  }
+
+  if (i + len > s.length()) {
+    *length = 1;
+    return 0xFFFD;
+  }
+
+  for (uint8_t k = 1; k < len; k++) {
+    unsigned char cc = s[i + k];
+    if ((cc & 0xC0) != 0x80) {
+      *length = 1;
+      return 0xFFFD;
+    }
+    cp = (cp << 6) | (cc & 0x3F);
+  }
+
+  *length = len;
+  return cp;
+}
+
+static BidiType classify(uint32_t cp) {
+  if (cp < 0x80) {
+    if ((cp >= 'A' && cp <= 'Z') || (cp >= 'a' && cp <= 'z')) {
+      return BIDI_L;
+    }
+    if (cp >= '0' && cp <= '9') {
+      return BIDI_EN;
+    }
+    switch (cp) {
+      case '+':
+      case '-':
+        return BIDI_ES;
+      case '#':
+      case '$':
+      case '%':
+        return BIDI_ET;
+      case ',':
+      case '.':
+      case '/':
+      case ':':
+        return BIDI_CS;
+      case ' ':
+      case '\t':
+        return BIDI_WS;
+      default:
+        return BIDI_ON;
+    }
+  }
+
+  if (cp == 0xA0) {
+    return BIDI_CS;
+  }
+  if ((cp >= 0xA2 && cp <= 0xA5) || cp == 0xB0 || cp == 0x20AA || cp == 0x20AC) {
+    return BIDI_ET;
+  }
+  if (cp < 0xC0) {
+    return BIDI_ON;
+  }
+  if (cp >= 0x0300 && cp <= 0x036F) {
+    return BIDI_NSM;
+  }
+  if ((cp >= 0x0591 && cp <= 0x05BD) || cp == 0x05BF || cp == 0x05C1 || cp == 0x05C2 || cp == 0x05C4 ||
+      cp == 0x05C5 || cp == 0x05C7) {
+    return BIDI_NSM;
+  }
+  if (cp >= 0x0660 && cp <= 0x0669) {
+    return BIDI_EN;
+  }
+  if ((cp >= 0x0590 && cp <= 0x08FF) || (cp >= 0xFB1D && cp <= 0xFDFF) || (cp >= 0xFE70 && cp <= 0xFEFF) ||
+      cp == 0x200F) {
+    return BIDI_R;
+  }
+  if ((cp >= 0x2000 && cp <= 0x200A) || cp == 0x3000) {
+    return BIDI_WS;
+  }
+  if ((cp >= 0x2010 && cp <= 0x2027) || (cp >= 0x2030 && cp <= 0x205E) || (cp >= 0x2190 && cp <= 0x2BFF)) {
+    return BIDI_ON;
+  }
+
+  return BIDI_L;
+}
+
+static uint32_t mirror(uint32_t cp) {
+  switch (cp) {
+    case '(': return ')';
+    case ')': return '(';
+    case '[': return ']';
+    case ']': return '[';
+    case '{': return '}';
+    case '}': return '{';
+    case '<': return '>';
+    case '>': return '<';
+    case 0xAB: return 0xBB;
+    case 0xBB: return 0xAB;
+    default: return 0;
+  }
+}
+
+static bool is_strong_for_neutrals(uint8_t type) {
+  return type == BIDI_L || type == BIDI_R || type == BIDI_EN;
+}
+
+std::string bidi_visual_order(const std::string &text, bool rtl_paragraph) {
+  const uint8_t base_level = rtl_paragraph ? 1 : 0;
+  const uint8_t base_type = rtl_paragraph ? BIDI_R : BIDI_L;
+
+  std::vector<BidiChar> chars;
+  chars.reserve(text.length());
+
+  bool has_rtl = rtl_paragraph;
+  for (size_t i = 0; i < text.length();) {
+    uint8_t length;
+    uint32_t cp = decode_utf8(text, i, &length);
+    uint8_t type = classify(cp);
+    has_rtl |= type == BIDI_R;
+    chars.push_back({static_cast<uint16_t>(i), length, type, base_level, cp});
+    i += length;
+  }
+
+  // A purely left-to-right string in a left-to-right paragraph is already in visual order
+  if (!has_rtl) {
+    return text;
+  }
+
+  const size_t n = chars.size();
+
+  // W1: non-spacing marks take the type of the preceding character
+  for (size_t i = 0; i < n; i++) {
+    if (chars[i].type == BIDI_NSM) {
+      chars[i].type = i == 0 ? base_type : chars[i - 1].type;
+    }
+  }
+
+  // W4: a single separator between two European numbers becomes a number
+  for (size_t i = 1; i + 1 < n; i++) {
+    uint8_t type = chars[i].type;
+    if ((type == BIDI_ES || type == BIDI_CS) && chars[i - 1].type == BIDI_EN && chars[i + 1].type == BIDI_EN) {
+      chars[i].type = BIDI_EN;
+    }
+  }
+
+  // W5: terminators adjacent to European numbers become numbers
+  for (size_t i = 0; i < n; i++) {
+    if (chars[i].type != BIDI_ET) {
+      continue;
+    }
+
+    size_t run_end = i;
+    while (run_end < n && chars[run_end].type == BIDI_ET) {
+      run_end++;
+    }
+
+    bool touches_number = (i > 0 && chars[i - 1].type == BIDI_EN) || (run_end < n && chars[run_end].type == BIDI_EN);
+    if (touches_number) {
+      for (size_t k = i; k < run_end; k++) {
+        chars[k].type = BIDI_EN;
+      }
+    }
+    i = run_end - 1;
+  }
+
+  // W6: remaining separators and terminators are neutral
+  for (auto &c : chars) {
+    if (c.type == BIDI_ES || c.type == BIDI_ET || c.type == BIDI_CS) {
+      c.type = BIDI_ON;
+    }
+  }
+
+  // W7: European numbers preceded by strong L are treated as L
+  uint8_t last_strong = base_type;
+  for (auto &c : chars) {
+    if (c.type == BIDI_L || c.type == BIDI_R) {
+      last_strong = c.type;
+    } else if (c.type == BIDI_EN && last_strong == BIDI_L) {
+      c.type = BIDI_L;
+    }
+  }
+
+  // N1/N2: neutrals between matching strong directions take that direction,
+  // otherwise the paragraph direction. Numbers count as R here.
+  for (size_t i = 0; i < n; i++) {
+    if (is_strong_for_neutrals(chars[i].type)) {
+      continue;
+    }
+
+    size_t run_end = i;
+    while (run_end < n && !is_strong_for_neutrals(chars[run_end].type)) {
+      run_end++;
+    }
+
+    uint8_t before = i == 0 ? base_type : chars[i - 1].type;
+    uint8_t after = run_end == n ? base_type : chars[run_end].type;
+    if (before == BIDI_EN) {
+      before = BIDI_R;
+    }
+    if (after == BIDI_EN) {
+      after = BIDI_R;
+    }
+
+    uint8_t resolved = before == after ? before : base_type;
+    for (size_t k = i; k < run_end; k++) {
+      chars[k].type = resolved;
+    }
+    i = run_end - 1;
+  }
+
+  // I1/I2: implicit levels
+  uint8_t max_level = base_level;
+  for (auto &c : chars) {
+    if (base_level == 0) {
+      c.level = c.type == BIDI_R ? 1 : (c.type == BIDI_EN ? 2 : 0);
+    } else {
+      c.level = c.type == BIDI_R ? 1 : 2;
+    }
+    max_level = std::max(max_level, c.level);
+  }
+
+  // L1: trailing whitespace goes back to the paragraph level
+  for (size_t i = n; i > 0 && classify(chars[i - 1].code_point) == BIDI_WS; i--) {
+    chars[i - 1].level = base_level;
+  }
+
+  // L2: reverse every run at or above each level, from the highest level down to the lowest odd one
+  uint8_t lowest_odd_level = base_level | 1;
+  for (uint8_t level = max_level; level >= lowest_odd_level; level--) {
+    for (size_t i = 0; i < n; i++) {
+      if (chars[i].level < level) {
+        continue;
+      }
+
+      size_t run_end = i;
+      while (run_end < n && chars[run_end].level >= level) {
+        run_end++;
+      }
+
+      std::reverse(chars.begin() + i, chars.begin() + run_end);
+      i = run_end;
+    }
+  }
+
+  std::string result;
+  result.reserve(text.length());
+
+  for (const auto &c : chars) {
+    // L4: mirrored glyphs in right-to-left runs
+    uint32_t mirrored = (c.level & 1) ? mirror(c.code_point) : 0;
+    if (mirrored != 0 && mirrored < 0x80) {
+      result += static_cast<char>(mirrored);
+    } else if (mirrored != 0) {
+      result += static_cast<char>(0xC0 | (mirrored >> 6));
+      result += static_cast<char>(0x80 | (mirrored & 0x3F));
+    } else {
+      result.append(text, c.offset, c.length);
+    }
+  }
+
+  return result;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+namespace esphome {
+namespace transit_tracker {
+
+// Reorders a logical-order UTF-8 string into visual (left-to-right display)
+// order using a compact subset of the Unicode Bidirectional Algorithm (UAX #9):
+// strong L/R, European numbers and their separators/terminators, neutrals,
+// non-spacing marks and mirrored brackets. Explicit embeddings and isolates are
+// not supported.
+std::string bidi_visual_order(const std::string &text, bool rtl_paragraph);
+
+}  // namespace transit_tracker
+}  // namespace esphome
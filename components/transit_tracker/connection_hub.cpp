@@ -0,0 +1,848 @@
+#include "connection_hub.h"
+#include "transit_tracker.h"
+#include "memory.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstring>
+
+#include "esphome/core/log.h"
+#include "esphome/core/application.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/network/util.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <lwip/netdb.h>
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *TAG = "transit_tracker.hub";
+
+HubMessage::HubMessage() : doc(PlacedJsonAllocator::instance()) {}
+
+const char *reconnect_cause_to_string(ReconnectCause cause) {
+  switch (cause) {
+    case RECONNECT_HEARTBEAT_TIMEOUT:
+      return "heartbeat timeout";
+    case RECONNECT_PING_TIMEOUT:
+      return "ping timeout";
+    case RECONNECT_CONNECTION_CLOSED:
+      return "connection closed";
+    case RECONNECT_REQUESTED:
+      return "requested";
+    default:
+      return "unknown";
+  }
+}
+
+// Mean deviation update shared by the RTT and heartbeat estimators: gains of
+// 1/8 for the mean and 1/4 for the deviation, seeded from the first sample
+static void update_estimate(uint32_t sample, uint32_t *mean, uint32_t *deviation) {
+  if (*mean == 0) {
+    *mean = sample;
+    *deviation = sample / 2;
+    return;
+  }
+
+  int32_t error = static_cast<int32_t>(sample - *mean);
+  *deviation += (static_cast<int32_t>(std::abs(error)) - static_cast<int32_t>(*deviation)) / 4;
+  *mean += error / 8;
+}
+
+void ConnectionHub::setup() {
+  this->build_message_filter_();
+
+  this->ws_client_.onMessage([this](websockets::WebsocketsMessage message) {
+    this->on_ws_message_(message);
+  });
+
+  this->ws_client_.onEvent([this](websockets::WebsocketsEvent event, String data) {
+    this->on_ws_event_(event, data);
+  });
+
+  if (this->use_network_task_) {
+    this->start_network_task_();
+  }
+
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+  if (this->http_request_ != nullptr) {
+    if (str_startswith(this->base_url_, "ws://") || str_startswith(this->base_url_, "wss://")) {
+      // ws://host[:port]/... -> http://host[:port]/schedule
+      std::string url = "http" + this->base_url_.substr(2);
+      size_t path_start = url.find('/', url.find("://") + 3);
+      this->poll_url_ = url.substr(0, path_start) + "/schedule";
+    } else {
+      ESP_LOGW(TAG, "Can't poll '%s', not a ws:// or wss:// URL", this->base_url_.c_str());
+      this->http_request_ = nullptr;
+    }
+  }
+#endif
+
+  // Wait for the network before the first attempt rather than spending it on
+  // the reconnect backoff.
+  this->set_interval("initial_connect", 500, [this]() {
+    if (!esphome::network::is_connected()) {
+      return;
+    }
+
+    this->cancel_interval("initial_connect");
+    this->connect_ws_();
+  });
+}
+
+void ConnectionHub::loop() {
+  if (this->message_queue_ != nullptr) {
+    HubMessage *message;
+    while (xQueueReceive(this->message_queue_, &message, 0) == pdTRUE) {
+      this->deliver_message_(*message);
+      delete message;
+    }
+  }
+
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+  if (this->polling_) {
+    this->poll_schedules_();
+  }
+#endif
+
+  if (this->connection_state_ == CONNECTION_CONNECTING) {
+    this->check_connect_attempt_();
+    return;
+  }
+
+  if (this->connection_state_ != CONNECTION_CONNECTED) {
+    return;
+  }
+
+  if (!this->use_network_task_) {
+    std::lock_guard<std::recursive_mutex> lock(this->ws_mutex_);
+    this->ws_client_.poll();
+  }
+
+  if (this->connection_state_ == CONNECTION_CONNECTED) {
+    this->supervise_connection_();
+  }
+}
+
+void ConnectionHub::supervise_connection_() {
+  uint32_t now = millis();
+  ConnectionStats &stats = this->connection_stats_;
+
+  // The heartbeat clock starts at connect, so a server that never sends one
+  // is caught too. Intervals are only sampled between two heartbeats.
+  uint32_t last_heartbeat = this->last_heartbeat_.load();
+  if (last_heartbeat != this->observed_heartbeat_) {
+    if (this->heartbeat_seen_) {
+      update_estimate(last_heartbeat - this->observed_heartbeat_, &stats.heartbeat_interval_ms, &stats.heartbeat_jitter_ms);
+    }
+    this->observed_heartbeat_ = last_heartbeat;
+    this->heartbeat_seen_ = true;
+  }
+
+  uint32_t heartbeat_timeout = this->heartbeat_timeout_();
+  if (now - last_heartbeat > heartbeat_timeout) {
+    ESP_LOGW(TAG, "No heartbeat for %" PRIu32 "ms, reconnecting", heartbeat_timeout);
+    this->reconnect_(RECONNECT_HEARTBEAT_TIMEOUT);
+    return;
+  }
+
+  if (!this->ping_outstanding_) {
+    if (now - this->last_ping_ >= PING_INTERVAL) {
+      std::lock_guard<std::recursive_mutex> lock(this->ws_mutex_);
+      this->ws_client_.ping();
+      this->last_ping_ = now;
+      this->ping_outstanding_ = true;
+    }
+    return;
+  }
+
+  uint32_t last_pong = this->last_pong_.load();
+  if (static_cast<int32_t>(last_pong - this->last_ping_) >= 0) {
+    update_estimate(last_pong - this->last_ping_, &stats.rtt_ms, &stats.rtt_jitter_ms);
+    ESP_LOGV(TAG, "Ping RTT %" PRIu32 "ms (smoothed %" PRIu32 "ms, jitter %" PRIu32 "ms)", last_pong - this->last_ping_,
+             stats.rtt_ms, stats.rtt_jitter_ms);
+    this->ping_outstanding_ = false;
+    return;
+  }
+
+  uint32_t pong_timeout = this->pong_timeout_();
+  if (now - this->last_ping_ > pong_timeout) {
+    ESP_LOGW(TAG, "No pong within %" PRIu32 "ms, reconnecting", pong_timeout);
+    this->reconnect_(RECONNECT_PING_TIMEOUT);
+  }
+}
+
+uint32_t ConnectionHub::pong_timeout_() const {
+  const ConnectionStats &stats = this->connection_stats_;
+  if (stats.rtt_ms == 0) {
+    return PONG_TIMEOUT_DEFAULT;
+  }
+
+  return std::clamp<uint32_t>(stats.rtt_ms + 4 * stats.rtt_jitter_ms, PONG_TIMEOUT_MIN, PONG_TIMEOUT_MAX);
+}
+
+uint32_t ConnectionHub::heartbeat_timeout_() const {
+  const ConnectionStats &stats = this->connection_stats_;
+  if (stats.heartbeat_interval_ms == 0) {
+    return HEARTBEAT_TIMEOUT_DEFAULT;
+  }
+
+  // One late or lost heartbeat is tolerated
+  return std::clamp<uint32_t>(2 * stats.heartbeat_interval_ms + 4 * stats.heartbeat_jitter_ms, HEARTBEAT_TIMEOUT_MIN,
+                              HEARTBEAT_TIMEOUT_MAX);
+}
+
+void ConnectionHub::dump_config() {
+  ESP_LOGCONFIG(TAG, "Transit Tracker Connection:");
+  ESP_LOGCONFIG(TAG, "  Base URL: %s", this->base_url_.c_str());
+  ESP_LOGCONFIG(TAG, "  Subscriptions: %zu", this->trackers_.size());
+  ESP_LOGCONFIG(TAG, "  Ping interval: %" PRIu32 "ms", PING_INTERVAL);
+  ESP_LOGCONFIG(TAG, "  Network task: %s", this->message_queue_ != nullptr ? "true" : "false");
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+  if (this->http_request_ != nullptr) {
+    ESP_LOGCONFIG(TAG, "  Polling fallback: %s", this->poll_url_.c_str());
+  }
+#endif
+}
+
+void ConnectionHub::on_shutdown() {
+  this->cancel_interval("initial_connect");
+  this->cancel_timeout("reconnect");
+  // Before closing, so the task isn't polling the client as it goes
+  this->stop_network_task_();
+  this->close(true);
+}
+
+uint32_t ConnectionHub::register_tracker(TransitTracker *tracker) {
+  this->trackers_.push_back(tracker);
+  return this->trackers_.size() - 1;
+}
+
+bool ConnectionHub::send(const std::string &message) {
+  if (this->connection_state_ != CONNECTION_CONNECTED) {
+    return false;
+  }
+
+  ESP_LOGV(TAG, "Sending message: %s", message.c_str());
+  std::lock_guard<std::recursive_mutex> lock(this->ws_mutex_);
+  return this->ws_client_.send(message.c_str());
+}
+
+void ConnectionHub::reconnect() {
+  this->reconnect_(RECONNECT_REQUESTED);
+}
+
+void ConnectionHub::reconnect_(ReconnectCause cause) {
+  this->connection_stats_.reconnects[cause]++;
+  this->close();
+  this->connect_ws_();
+}
+
+void ConnectionHub::close(bool fully) {
+  if (fully) {
+    this->fully_closed_ = true;
+  }
+
+  // The client belongs to the connect task until the attempt finishes
+  if (this->connection_state_ != CONNECTION_CONNECTED) {
+    return;
+  }
+
+  // Under the lock, so the network task sees the state change before it
+  // polls again and leaves the client to the next connect task
+  std::lock_guard<std::recursive_mutex> lock(this->ws_mutex_);
+  this->connection_state_ = CONNECTION_IDLE;
+  this->ws_client_.close();
+}
+
+void ConnectionHub::start_network_task_() {
+  this->message_queue_ = xQueueCreate(MESSAGE_QUEUE_LENGTH, sizeof(HubMessage *));
+  if (this->message_queue_ == nullptr) {
+    ESP_LOGE(TAG, "Failed to create message queue, polling from the main loop");
+    this->use_network_task_ = false;
+    return;
+  }
+
+  // setup() runs on the main loop's core; the network task takes the other one
+  BaseType_t core = portNUM_PROCESSORS > 1 ? 1 - xPortGetCoreID() : tskNO_AFFINITY;
+  this->network_task_running_ = true;
+  if (xTaskCreatePinnedToCore(ConnectionHub::network_task_, "tt_network", NETWORK_TASK_STACK_SIZE, this, 1, nullptr, core) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start network task, polling from the main loop");
+    this->network_task_running_ = false;
+    vQueueDelete(this->message_queue_);
+    this->message_queue_ = nullptr;
+    this->use_network_task_ = false;
+  }
+}
+
+void ConnectionHub::stop_network_task_() {
+  if (this->message_queue_ == nullptr) {
+    return;
+  }
+
+  this->network_task_stopping_ = true;
+  for (uint32_t waited = 0; this->network_task_running_; waited += NETWORK_TASK_POLL_INTERVAL) {
+    if (waited >= NETWORK_TASK_STOP_TIMEOUT) {
+      // The task may still hold the queue, so it's left to the reboot
+      ESP_LOGW(TAG, "Network task didn't stop");
+      return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(NETWORK_TASK_POLL_INTERVAL));
+  }
+
+  HubMessage *message;
+  while (xQueueReceive(this->message_queue_, &message, 0) == pdTRUE) {
+    delete message;
+  }
+  vQueueDelete(this->message_queue_);
+  this->message_queue_ = nullptr;
+}
+
+void ConnectionHub::network_task_(void *arg) {
+  auto *hub = static_cast<ConnectionHub *>(arg);
+  // Scoped, since a deleted task never returns to run destructors
+  {
+    std::vector<websockets::WebsocketsMessage> received;
+
+    while (!hub->network_task_stopping_) {
+      {
+        std::lock_guard<std::recursive_mutex> lock(hub->ws_mutex_);
+        if (hub->connection_state_ == CONNECTION_CONNECTED) {
+          hub->ws_client_.poll();
+        }
+        received.swap(hub->received_);
+      }
+
+      for (auto &message : received) {
+        auto decoded = hub->decode_message_(message);
+        if (decoded == nullptr) {
+          continue;
+        }
+
+        // Waiting for room bounds the memory held by decoded documents; the
+        // socket buffers whatever arrives in the meantime. The lock must not be
+        // held here, since the main loop needs it to send and ping while it
+        // drains the queue. The wait is cut short to check for shutdown.
+        HubMessage *queued = decoded.release();
+        while (xQueueSend(hub->message_queue_, &queued, pdMS_TO_TICKS(NETWORK_TASK_POLL_INTERVAL)) != pdTRUE) {
+          if (hub->network_task_stopping_) {
+            delete queued;
+            break;
+          }
+        }
+      }
+      received.clear();
+
+      vTaskDelay(pdMS_TO_TICKS(NETWORK_TASK_POLL_INTERVAL));
+    }
+  }
+
+  hub->network_task_running_ = false;
+  vTaskDelete(nullptr);
+}
+
+void ConnectionHub::build_message_filter_() {
+  this->message_filter_.clear();
+  this->message_filter_["event"] = true;
+
+  auto data = this->message_filter_["data"];
+  data["subscriptionId"] = true;
+  data["seq"] = true;
+  data["remove"] = true;
+
+  for (const char *list : {"trips", "add", "update"}) {
+    auto trip = data[list][0];
+    trip["tripId"] = true;
+    trip["headsign"] = true;
+    trip["routeId"] = true;
+    trip["routeName"] = true;
+    trip["routeColor"] = true;
+    trip["arrivalTime"] = true;
+    trip["departureTime"] = true;
+    trip["isRealtime"] = true;
+  }
+}
+
+void ConnectionHub::on_ws_message_(websockets::WebsocketsMessage message) {
+  if (this->message_queue_ != nullptr) {
+    // Runs inside poll() with ws_mutex_ held; the network task decodes and
+    // queues the message once it has released the lock
+    this->received_.push_back(std::move(message));
+    return;
+  }
+
+  auto decoded = this->decode_message_(message);
+  if (decoded != nullptr) {
+    this->deliver_message_(*decoded);
+  }
+}
+
+std::unique_ptr<HubMessage> ConnectionHub::decode_message_(const websockets::WebsocketsMessage &message) {
+  const auto &payload = message.rawData();
+  bool binary = message.isBinary();
+
+  if (binary) {
+    ESP_LOGV(TAG, "Received binary message (%zu bytes)", payload.length());
+  } else {
+    ESP_LOGV(TAG, "Received message (%zu bytes): %s", payload.length(), payload.c_str());
+  }
+
+  // Only the fields rendered on the display are kept in the document, so its
+  // size depends on the number of trips rather than on the payload size.
+  uint32_t decode_start = micros();
+
+  auto decoded = std::make_unique<HubMessage>();
+  decoded->length = payload.length();
+
+  DeserializationError error;
+  if (binary) {
+    error = deserializeMsgPack(decoded->doc, payload, DeserializationOption::Filter(this->message_filter_));
+  } else {
+    error = deserializeJson(decoded->doc, payload, DeserializationOption::Filter(this->message_filter_));
+  }
+
+  if (error) {
+    ESP_LOGW(TAG, "Failed to parse message: %s", error.c_str());
+    decoded->doc.clear();
+    decoded->failed = true;
+    return decoded;
+  }
+
+  decoded->decode_us = micros() - decode_start;
+  ESP_LOGV(TAG, "Decoded %s message in %" PRIu32 "us", binary ? "MessagePack" : "JSON", decoded->decode_us);
+
+  // Heartbeats are tracked where they arrive, so a busy main loop can't make
+  // a live connection look dead
+  const char *event = decoded->doc["event"];
+  if (event != nullptr && strcmp(event, "heartbeat") == 0) {
+    ESP_LOGD(TAG, "Received heartbeat");
+    this->last_heartbeat_.store(millis());
+    return nullptr;
+  }
+
+  return decoded;
+}
+
+void ConnectionHub::deliver_message_(HubMessage &message) {
+  if (message.failed && message.tracker != nullptr) {
+    message.tracker->on_hub_message_dropped(message.length);
+    return;
+  }
+
+  if (message.failed) {
+    // There's no telling which subscription the message was meant for
+    for (auto *tracker : this->trackers_) {
+      tracker->on_hub_message_dropped(message.length);
+    }
+    return;
+  }
+
+  if (message.tracker != nullptr) {
+    message.tracker->on_hub_message("schedule", message.doc.as<JsonObject>(), message.length, message.decode_us);
+    return;
+  }
+
+  JsonObject root = message.doc.as<JsonObject>();
+  auto event = root["event"].as<const char *>();
+  if (event == nullptr) {
+    return;
+  }
+
+  JsonObject data = root["data"].as<JsonObject>();
+  TransitTracker *tracker = this->find_tracker_(data);
+  if (tracker == nullptr) {
+    ESP_LOGW(TAG, "Received %s event for an unknown subscription", event);
+    return;
+  }
+
+  tracker->on_hub_message(event, data, message.length, message.decode_us);
+}
+
+TransitTracker *ConnectionHub::find_tracker_(JsonObject data) {
+  // Servers that don't echo subscription IDs can still serve a single tracker
+  auto subscription_id = data["subscriptionId"];
+  if (subscription_id.isNull()) {
+    return this->trackers_.size() == 1 ? this->trackers_[0] : nullptr;
+  }
+
+  uint32_t index = subscription_id.as<uint32_t>();
+  return index < this->trackers_.size() ? this->trackers_[index] : nullptr;
+}
+
+void ConnectionHub::on_ws_event_(websockets::WebsocketsEvent event, String data) {
+  if (event == websockets::WebsocketsEvent::ConnectionOpened) {
+    // Runs on the connect task; trackers are notified from loop()
+    ESP_LOGV(TAG, "WebSocket handshake complete");
+  } else if (event == websockets::WebsocketsEvent::ConnectionClosed) {
+    ESP_LOGD(TAG, "WebSocket connection closed");
+    // Still connected means the server or the network closed it, not close()
+    bool dropped = this->connection_state_ == CONNECTION_CONNECTED;
+    if (dropped) {
+      this->connection_state_ = CONNECTION_IDLE;
+    }
+
+    // May run on the network task; the scheduler accepts defers from any task
+    if (!this->fully_closed_ && this->connection_attempts_ == 0) {
+      this->defer([this, dropped]() {
+        if (dropped) {
+          this->connection_stats_.reconnects[RECONNECT_CONNECTION_CLOSED]++;
+        }
+        this->connect_ws_();
+      });
+    }
+  } else if (event == websockets::WebsocketsEvent::GotPing) {
+    ESP_LOGV(TAG, "Received ping");
+  } else if (event == websockets::WebsocketsEvent::GotPong) {
+    ESP_LOGV(TAG, "Received pong");
+    this->last_pong_.store(millis());
+  }
+}
+
+void ConnectionHub::connect_ws_() {
+  if (this->base_url_.empty()) {
+    ESP_LOGW(TAG, "No base URL set, not connecting");
+    return;
+  }
+
+  if (this->fully_closed_) {
+    ESP_LOGW(TAG, "Connection fully closed, not reconnecting");
+    return;
+  }
+
+  if (this->connection_state_ == CONNECTION_CONNECTING || this->connection_state_ == CONNECTION_CONNECTED) {
+    ESP_LOGV(TAG, "Not reconnecting, already connected or connecting");
+    return;
+  }
+
+  this->cancel_timeout("reconnect");
+
+  if (!esphome::network::is_connected()) {
+    ESP_LOGW(TAG, "Not connected to network; skipping connection attempt");
+    this->on_connect_failed_();
+    return;
+  }
+
+  ESP_LOGD(TAG, "Connecting to WebSocket server (attempt %d): %s", this->connection_attempts_, this->base_url_.c_str());
+
+  this->connection_state_ = CONNECTION_CONNECTING;
+  this->connect_abandoned_ = false;
+  this->connect_hang_reported_ = false;
+  this->connect_result_.store(CONNECT_PENDING);
+  this->set_connect_stage_(CONNECT_STAGE_DNS);
+
+  // DNS, TCP, TLS and the websocket upgrade all block, so they run on a
+  // short-lived task while loop() keeps rendering and tracks the deadlines.
+  if (xTaskCreate(ConnectionHub::connect_task_, "tt_connect", CONNECT_TASK_STACK_SIZE, this, 1, nullptr) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to start connect task");
+    this->connection_state_ = CONNECTION_IDLE;
+    this->on_connect_failed_();
+  }
+}
+
+void ConnectionHub::connect_task_(void *arg) {
+  auto *hub = static_cast<ConnectionHub *>(arg);
+
+  if (!hub->resolve_host_()) {
+    hub->connect_result_.store(CONNECT_DNS_FAILED);
+  } else {
+    hub->set_connect_stage_(CONNECT_STAGE_HANDSHAKE);
+    bool connected = hub->ws_client_.connect(hub->base_url_.c_str());
+    hub->connect_stack_free_.store(uxTaskGetStackHighWaterMark(nullptr));
+    hub->connect_result_.store(connected ? CONNECT_SUCCEEDED : CONNECT_HANDSHAKE_FAILED);
+  }
+
+  vTaskDelete(nullptr);
+}
+
+bool ConnectionHub::resolve_host_() {
+  // Resolving up front gives DNS its own timeout; lwIP caches the answer for
+  // the lookup the websocket client does next.
+  size_t host_start = this->base_url_.find("://");
+  host_start = host_start == std::string::npos ? 0 : host_start + 3;
+  size_t host_end = this->base_url_.find_first_of(":/", host_start);
+  std::string host = this->base_url_.substr(host_start, host_end == std::string::npos ? std::string::npos : host_end - host_start);
+
+  struct addrinfo hints {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  struct addrinfo *result = nullptr;
+  int err = getaddrinfo(host.c_str(), nullptr, &hints, &result);
+  if (result != nullptr) {
+    freeaddrinfo(result);
+  }
+
+  return err == 0;
+}
+
+void ConnectionHub::set_connect_stage_(ConnectStage stage) {
+  this->connect_stage_started_.store(millis());
+  this->connect_stage_.store(stage);
+}
+
+void ConnectionHub::check_connect_attempt_() {
+  auto result = this->connect_result_.load();
+
+  if (result == CONNECT_PENDING) {
+    if (this->connect_abandoned_) {
+      this->check_connect_hang_();
+      return;
+    }
+
+    auto stage = this->connect_stage_.load();
+    uint32_t timeout = stage == CONNECT_STAGE_DNS ? DNS_TIMEOUT : HANDSHAKE_TIMEOUT;
+    if (millis() - this->connect_stage_started_.load() > timeout) {
+      ESP_LOGW(TAG, "%s timed out after %" PRIu32 "ms", stage == CONNECT_STAGE_DNS ? "DNS lookup" : "Connection handshake", timeout);
+      // The blocking call can't be interrupted; wait for it to return before
+      // the client is touched again, but report the failure now.
+      this->connect_abandoned_ = true;
+      this->on_connect_failed_();
+    }
+    return;
+  }
+
+  this->connection_state_ = CONNECTION_IDLE;
+
+  if (result != CONNECT_DNS_FAILED) {
+    ESP_LOGV(TAG, "Connect task had %" PRIu32 " bytes of stack to spare", this->connect_stack_free_.load());
+  }
+
+  if (this->connect_abandoned_) {
+    if (result == CONNECT_SUCCEEDED) {
+      this->ws_client_.close();
+    }
+    this->schedule_reconnect_();
+    return;
+  }
+
+  if (result != CONNECT_SUCCEEDED) {
+    ESP_LOGW(TAG, "%s failed", result == CONNECT_DNS_FAILED ? "DNS lookup" : "Connection handshake");
+    this->on_connect_failed_();
+    return;
+  }
+
+  ESP_LOGD(TAG, "WebSocket connection opened");
+
+  if (this->polling_) {
+    ESP_LOGI(TAG, "WebSocket is back, no longer polling");
+    this->polling_ = false;
+  }
+
+  this->connection_state_ = CONNECTION_CONNECTED;
+
+  // Supervision starts over for the new connection; the cadence estimates
+  // are kept, as they describe the server rather than the link.
+  uint32_t now = millis();
+  this->last_heartbeat_.store(now);
+  this->observed_heartbeat_ = now;
+  this->heartbeat_seen_ = false;
+  this->last_ping_ = now;
+  this->ping_outstanding_ = false;
+
+  bool reconnected = this->has_ever_connected_;
+  this->has_ever_connected_ = true;
+  this->connection_attempts_ = 0;
+  this->status_clear_error();
+
+  for (auto *tracker : this->trackers_) {
+    tracker->on_hub_connected(reconnected);
+  }
+}
+
+void ConnectionHub::check_connect_hang_() {
+  if (this->connect_hang_reported_ || millis() - this->connect_stage_started_.load() <= CONNECT_HANG_TIMEOUT) {
+    return;
+  }
+
+  this->connect_hang_reported_ = true;
+  ESP_LOGE(TAG, "Connection attempt still hasn't returned after %" PRIu32 "ms", CONNECT_HANG_TIMEOUT);
+  this->status_set_error("Connection attempt hung");
+
+  // Schedules keep arriving while polling works, so only the websocket is lost
+  if (!(this->polling_ && this->poll_succeeded_)) {
+    ESP_LOGE(TAG, "Rebooting the device to recover.");
+    App.reboot();
+  }
+}
+
+void ConnectionHub::on_connect_failed_() {
+  this->connection_attempts_++;
+
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+  if (this->http_request_ != nullptr && !this->polling_ && this->connection_attempts_ >= POLL_FALLBACK_ATTEMPTS) {
+    this->start_polling_();
+  }
+#endif
+
+  // Schedules keep arriving while polling works; the error is the poll's to report
+  if (this->connection_attempts_ >= 3 && !this->polling_) {
+    this->status_set_error("Failed to connect to WebSocket server");
+  }
+
+  if (this->connection_attempts_ >= MAX_CONNECT_ATTEMPTS && !(this->polling_ && this->poll_succeeded_)) {
+    ESP_LOGE(TAG, "Could not connect to WebSocket server within %d attempts.", MAX_CONNECT_ATTEMPTS);
+    ESP_LOGE(TAG, "It's likely that the network is not truly connected; rebooting the device to try to recover.");
+    App.reboot();
+  }
+
+  if (this->connection_state_ != CONNECTION_CONNECTING) {
+    this->schedule_reconnect_();
+  }
+}
+
+void ConnectionHub::schedule_reconnect_() {
+  // Exponential backoff with jitter: a random delay in [backoff / 2, backoff]
+  uint32_t backoff = RECONNECT_BACKOFF_MAX;
+  if (this->connection_attempts_ <= 16) {
+    backoff = std::min<uint32_t>(RECONNECT_BACKOFF_MAX, RECONNECT_BACKOFF_BASE << std::max(0, this->connection_attempts_ - 1));
+  }
+  uint32_t timeout = backoff / 2 + random_uint32() % (backoff / 2 + 1);
+
+  ESP_LOGW(TAG, "Failed to connect, retrying in %" PRIu32 "ms", timeout);
+
+  this->connection_state_ = CONNECTION_BACKOFF;
+  this->set_timeout("reconnect", timeout, [this]() {
+    this->connection_state_ = CONNECTION_IDLE;
+    this->connect_ws_();
+  });
+}
+
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+void ConnectionHub::start_polling_() {
+  ESP_LOGW(TAG, "WebSocket unavailable after %d attempts, polling %s", this->connection_attempts_, this->poll_url_.c_str());
+
+  this->polling_ = true;
+  this->poll_succeeded_ = false;
+  this->polls_.resize(this->trackers_.size());
+  for (auto &poll : this->polls_) {
+    poll.next_poll = millis();
+  }
+}
+
+void ConnectionHub::poll_schedules_() {
+  // Requests block, like other http_request users, so at most one is made per
+  // loop. Most are answered with a 304 and no body.
+  uint32_t now = millis();
+  for (size_t i = 0; i < this->polls_.size(); i++) {
+    PollSubscription &poll = this->polls_[i];
+    if (static_cast<int32_t>(now - poll.next_poll) < 0) {
+      continue;
+    }
+
+    this->poll_succeeded_ = this->poll_schedule_(i);
+    if (this->poll_succeeded_) {
+      this->has_ever_connected_ = true;
+      this->status_clear_error();
+      poll.next_poll = millis() + this->trackers_[i]->get_poll_interval();
+    } else {
+      this->status_set_error("Failed to poll schedule");
+      poll.next_poll = millis() + POLL_RETRY_INTERVAL;
+    }
+    return;
+  }
+}
+
+bool ConnectionHub::poll_schedule_(size_t index) {
+  TransitTracker *tracker = this->trackers_[index];
+  PollSubscription &poll = this->polls_[index];
+
+  std::string url = this->poll_url_ + "?" + tracker->get_schedule_query();
+  ESP_LOGV(TAG, "Polling %s", url.c_str());
+
+  std::list<http_request::Header> headers;
+  if (!poll.etag.empty()) {
+    headers.push_back({"If-None-Match", poll.etag});
+  }
+
+  auto container = this->http_request_->get(url, headers, {"etag"});
+  if (container == nullptr) {
+    ESP_LOGW(TAG, "Schedule request failed");
+    return false;
+  }
+
+  if (container->status_code == 304) {
+    ESP_LOGV(TAG, "Schedule not modified");
+    container->end();
+    return true;
+  }
+
+  // Chunked responses come without a length, reported as 0 or -1 depending
+  // on the HTTP backend, and are read to the end of the stream instead
+  size_t length = container->content_length;
+  bool length_known = length != 0 && length != static_cast<size_t>(-1);
+  if (container->status_code < 200 || container->status_code >= 300 || (length_known && length > MAX_POLL_RESPONSE_SIZE)) {
+    ESP_LOGW(TAG, "Unexpected schedule response: HTTP %d, %zu bytes", container->status_code, length_known ? length : 0);
+    container->end();
+    return false;
+  }
+
+  // Unknown lengths grow the buffer as they go, to one byte past the limit so
+  // that an oversized body can be told apart
+  PlacedVector<uint8_t> body(length_known ? length : POLL_READ_CHUNK_SIZE);
+  size_t read_index = 0;
+  for (;;) {
+    if (read_index == body.size()) {
+      if (length_known || body.size() > MAX_POLL_RESPONSE_SIZE) {
+        break;
+      }
+      body.resize(std::min(body.size() * 2, MAX_POLL_RESPONSE_SIZE + 1));
+    }
+
+    int read = container->read(body.data() + read_index, body.size() - read_index);
+    if (read <= 0) {
+      break;
+    }
+    read_index += read;
+    App.feed_wdt();
+  }
+
+  std::string etag = container->get_response_header("etag");
+  container->end();
+
+  if (length_known && read_index < length) {
+    ESP_LOGW(TAG, "Schedule response truncated at %zu of %zu bytes", read_index, length);
+    return false;
+  }
+  if (read_index > MAX_POLL_RESPONSE_SIZE) {
+    ESP_LOGW(TAG, "Schedule response larger than %zu bytes", MAX_POLL_RESPONSE_SIZE);
+    return false;
+  }
+  if (read_index == 0) {
+    ESP_LOGW(TAG, "Empty schedule response");
+    return false;
+  }
+  length = read_index;
+
+  HubMessage message;
+  message.tracker = tracker;
+  message.length = length;
+
+  uint32_t decode_start = micros();
+  auto error = deserializeJson(message.doc, body.data(), length, DeserializationOption::Filter(this->message_filter_["data"]));
+  if (error) {
+    ESP_LOGW(TAG, "Failed to parse schedule response: %s", error.c_str());
+    message.doc.clear();
+    message.failed = true;
+  } else {
+    message.decode_us = micros() - decode_start;
+    // Kept only for bodies that parse, so a bad one is fetched again
+    poll.etag = std::move(etag);
+  }
+
+  this->deliver_message_(message);
+  if (message.failed) {
+    return false;
+  }
+
+  // As on_hub_connected() does for the websocket, so that a good schedule
+  // clears a parse error left by an earlier poll
+  tracker->status_clear_error();
+  return true;
+}
+#endif
+
+}  // namespace transit_tracker
+}  // namespace esphome
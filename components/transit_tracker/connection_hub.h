@@ -0,0 +1,232 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <ArduinoWebsockets.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "esphome/core/component.h"
+#include "esphome/components/json/json_util.h"
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+#include "esphome/components/http_request/http_request.h"
+#endif
+
+namespace esphome {
+namespace transit_tracker {
+
+class TransitTracker;
+
+enum ConnectionState : uint8_t {
+  CONNECTION_IDLE,
+  CONNECTION_CONNECTING,
+  CONNECTION_CONNECTED,
+  CONNECTION_BACKOFF,
+};
+
+enum ConnectStage : uint8_t {
+  CONNECT_STAGE_DNS,
+  CONNECT_STAGE_HANDSHAKE,  // TCP, TLS and the websocket upgrade
+};
+
+enum ConnectResult : uint8_t {
+  CONNECT_PENDING,
+  CONNECT_SUCCEEDED,
+  CONNECT_DNS_FAILED,
+  CONNECT_HANDSHAKE_FAILED,
+};
+
+enum ReconnectCause : uint8_t {
+  RECONNECT_HEARTBEAT_TIMEOUT,
+  RECONNECT_PING_TIMEOUT,
+  RECONNECT_CONNECTION_CLOSED,
+  RECONNECT_REQUESTED,
+  RECONNECT_CAUSE_COUNT,
+};
+
+const char *reconnect_cause_to_string(ReconnectCause cause);
+
+// Estimates follow the current connection; counters are cumulative since boot
+struct ConnectionStats {
+  // Smoothed ping round trip time and its mean deviation, as for TCP (RFC 6298).
+  // Zero until the first pong.
+  uint32_t rtt_ms = 0;
+  uint32_t rtt_jitter_ms = 0;
+  // Smoothed interval between server heartbeats and its mean deviation. Zero
+  // until two heartbeats have arrived.
+  uint32_t heartbeat_interval_ms = 0;
+  uint32_t heartbeat_jitter_ms = 0;
+  uint32_t reconnects[RECONNECT_CAUSE_COUNT] = {};
+};
+
+// A decoded message on its way from the websocket client to a tracker
+struct HubMessage {
+  HubMessage();
+
+  JsonDocument doc;
+  size_t length = 0;
+  uint32_t decode_us = 0;
+  // Set when the payload could not be decoded
+  bool failed = false;
+  // Polled schedules carry only the schedule data, for this tracker
+  TransitTracker *tracker = nullptr;
+};
+
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+struct PollSubscription {
+  std::string etag;
+  uint32_t next_poll = 0;
+};
+#endif
+
+// Owns the websocket connection to one server. Every tracker pointed at the
+// same base URL registers a subscription here, so they share a single socket,
+// TLS session and heartbeat; schedule events are routed back by the
+// subscriptionId the server echoes in their data.
+class ConnectionHub : public Component {
+  public:
+    void setup() override;
+    void loop() override;
+    void dump_config() override;
+    void on_shutdown() override;
+
+    float get_setup_priority() const override { return setup_priority::AFTER_WIFI; }
+
+    void set_base_url(const std::string &base_url) { base_url_ = base_url; }
+    // Polls the websocket client and decodes messages on a task pinned to the
+    // core the main loop doesn't run on, so TLS reads and parsing don't stall
+    // rendering. Decoded messages are handed back to loop() through a bounded
+    // queue and ingested there.
+    void set_network_task(bool network_task) { use_network_task_ = network_task; }
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+    // Falls back to polling each tracker's schedule over HTTP when the
+    // websocket can't be established, e.g. behind proxies that drop upgrades.
+    // Websocket attempts continue in the background and take over again once
+    // one succeeds.
+    void set_http_request(http_request::HttpRequestComponent *http_request) { http_request_ = http_request; }
+#endif
+    const ConnectionStats &get_connection_stats() const { return connection_stats_; }
+    const std::string &get_base_url() const { return base_url_; }
+
+    // Returns the subscription ID the tracker should send with its subscribe
+    uint32_t register_tracker(TransitTracker *tracker);
+
+    bool is_connected() const { return this->connection_state_ == CONNECTION_CONNECTED; }
+    bool has_ever_connected() const { return has_ever_connected_; }
+    bool send(const std::string &message);
+
+    void reconnect();
+    void close(bool fully = false);
+
+  protected:
+    static constexpr uint32_t DNS_TIMEOUT = 10000;
+    static constexpr uint32_t HANDSHAKE_TIMEOUT = 20000;
+    // An abandoned attempt that still hasn't returned by then is stuck in a
+    // socket call, and the client is unusable until it does
+    static constexpr uint32_t CONNECT_HANG_TIMEOUT = 3 * HANDSHAKE_TIMEOUT;
+    static constexpr uint32_t RECONNECT_BACKOFF_BASE = 1000;
+    static constexpr uint32_t RECONNECT_BACKOFF_MAX = 60000;
+    // mbedTLS certificate verification and ECDHE take about 7 KB on their
+    // own, which left 8 KB with no room for the client's frames
+    static constexpr uint32_t CONNECT_TASK_STACK_SIZE = 12288;
+    static constexpr uint32_t NETWORK_TASK_STACK_SIZE = 8192;
+    static constexpr uint32_t NETWORK_TASK_POLL_INTERVAL = 10;
+    // How long on_shutdown() waits for the network task to see its stop flag
+    static constexpr uint32_t NETWORK_TASK_STOP_TIMEOUT = 1000;
+    // Each entry holds a decoded document; the network task waits for room
+    static constexpr size_t MESSAGE_QUEUE_LENGTH = 4;
+    static constexpr int MAX_CONNECT_ATTEMPTS = 15;
+    static constexpr uint32_t PING_INTERVAL = 15000;
+    // Until the round trip time has been measured
+    static constexpr uint32_t PONG_TIMEOUT_DEFAULT = 10000;
+    static constexpr uint32_t PONG_TIMEOUT_MIN = 3000;
+    static constexpr uint32_t PONG_TIMEOUT_MAX = 20000;
+    // Until the heartbeat cadence has been observed
+    static constexpr uint32_t HEARTBEAT_TIMEOUT_DEFAULT = 60000;
+    static constexpr uint32_t HEARTBEAT_TIMEOUT_MIN = 10000;
+    static constexpr uint32_t HEARTBEAT_TIMEOUT_MAX = 120000;
+    static constexpr int POLL_FALLBACK_ATTEMPTS = 5;
+    static constexpr uint32_t POLL_RETRY_INTERVAL = 30000;
+    static constexpr size_t MAX_POLL_RESPONSE_SIZE = 16384;
+    // First buffer for responses of unknown length, doubled as needed
+    static constexpr size_t POLL_READ_CHUNK_SIZE = 1024;
+
+    void build_message_filter_();
+    void on_ws_message_(websockets::WebsocketsMessage message);
+    // Null for heartbeats, which are handled here
+    std::unique_ptr<HubMessage> decode_message_(const websockets::WebsocketsMessage &message);
+    void deliver_message_(HubMessage &message);
+    TransitTracker *find_tracker_(JsonObject data);
+    void start_network_task_();
+    void stop_network_task_();
+    static void network_task_(void *arg);
+    void on_ws_event_(websockets::WebsocketsEvent event, String data);
+    void connect_ws_();
+    static void connect_task_(void *arg);
+    bool resolve_host_();
+    void set_connect_stage_(ConnectStage stage);
+    void check_connect_attempt_();
+    void check_connect_hang_();
+    void on_connect_failed_();
+    void schedule_reconnect_();
+    void reconnect_(ReconnectCause cause);
+    void supervise_connection_();
+    uint32_t pong_timeout_() const;
+    uint32_t heartbeat_timeout_() const;
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+    void start_polling_();
+    void poll_schedules_();
+    bool poll_schedule_(size_t index);
+#endif
+
+    std::vector<TransitTracker *> trackers_;
+
+    websockets::WebsocketsClient ws_client_{};
+    // Held around client calls once the network task polls it. Recursive
+    // because message callbacks run inside poll() and may send.
+    std::recursive_mutex ws_mutex_;
+    JsonDocument message_filter_;
+
+    bool use_network_task_ = false;
+    QueueHandle_t message_queue_ = nullptr;
+    std::atomic<bool> network_task_stopping_{false};
+    std::atomic<bool> network_task_running_{false};
+    // Messages received by the network task's poll(), under ws_mutex_
+    std::vector<websockets::WebsocketsMessage> received_;
+
+    std::atomic<ConnectionState> connection_state_{CONNECTION_IDLE};
+    std::atomic<ConnectStage> connect_stage_{CONNECT_STAGE_DNS};
+    std::atomic<uint32_t> connect_stage_started_{0};
+    std::atomic<ConnectResult> connect_result_{CONNECT_PENDING};
+    bool connect_abandoned_ = false;
+    bool connect_hang_reported_ = false;
+    // Unused stack of the last connect task, in bytes
+    std::atomic<uint32_t> connect_stack_free_{0};
+    int connection_attempts_ = 0;
+    // Written by whichever task polls the client, checked in loop()
+    std::atomic<uint32_t> last_heartbeat_{0};
+    std::atomic<uint32_t> last_pong_{0};
+    uint32_t observed_heartbeat_ = 0;
+    bool heartbeat_seen_ = false;
+    uint32_t last_ping_ = 0;
+    bool ping_outstanding_ = false;
+    ConnectionStats connection_stats_{};
+    bool has_ever_connected_ = false;
+    bool fully_closed_ = false;
+
+    bool polling_ = false;
+    bool poll_succeeded_ = false;
+#ifdef USE_TRANSIT_TRACKER_HTTP_POLLING
+    http_request::HttpRequestComponent *http_request_{nullptr};
+    std::string poll_url_;
+    std::vector<PollSubscription> polls_;
+#endif
+
+    std::string base_url_;
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
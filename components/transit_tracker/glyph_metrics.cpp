@@ -0,0 +1,128 @@
+#include "glyph_metrics.h"
+
+#include <algorithm>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+static const char *TAG = "transit_tracker.glyph_metrics";
+
+// Decodes one UTF-8 sequence; returns its length, or 0 if it is malformed
+static size_t decode_utf8(const uint8_t *str, uint32_t *code_point) {
+  uint8_t lead = str[0];
+  size_t length;
+
+  if (lead < 0x80) {
+    *code_point = lead;
+    return 1;
+  } else if ((lead & 0xE0) == 0xC0) {
+    *code_point = lead & 0x1F;
+    length = 2;
+  } else if ((lead & 0xF0) == 0xE0) {
+    *code_point = lead & 0x0F;
+    length = 3;
+  } else if ((lead & 0xF8) == 0xF0) {
+    *code_point = lead & 0x07;
+    length = 4;
+  } else {
+    return 0;
+  }
+
+  for (size_t i = 1; i < length; i++) {
+    if ((str[i] & 0xC0) != 0x80) {
+      return 0;
+    }
+    *code_point = (*code_point << 6) | (str[i] & 0x3F);
+  }
+
+  return length;
+}
+
+void GlyphMetrics::build(font::Font *font) {
+  for (auto &page : this->pages_) {
+    page.reset();
+  }
+
+  for (const auto &glyph : font->get_glyphs()) {
+    const uint8_t *str = glyph.get_char();
+
+    uint32_t code_point;
+    size_t length = decode_utf8(str, &code_point);
+    if (length == 0 || str[length] != '\0' || code_point > 0xFFFF) {
+      // Multi-character glyphs would need the font's longest-match rules
+      ESP_LOGW(TAG, "Font has glyphs that can't be cached, measuring text with the font");
+      for (auto &page : this->pages_) {
+        page.reset();
+      }
+      return;
+    }
+
+    // A single glyph measures as its advance less its left bearing
+    int width, x_offset, baseline, height;
+    font->measure(reinterpret_cast<const char *>(str), &width, &x_offset, &baseline, &height);
+
+    auto &page = this->pages_[code_point >> 8];
+    if (page == nullptr) {
+      page = std::make_unique<Page>();
+    }
+
+    Entry &entry = (*page)[code_point & 0xFF];
+    entry.advance = width + x_offset;
+    entry.offset_x = x_offset;
+  }
+
+  ESP_LOGD(TAG, "Cached metrics for %zu glyphs in %zu pages", font->get_glyphs().size(), this->page_count());
+}
+
+const GlyphMetrics::Entry *GlyphMetrics::find_(uint32_t code_point) const {
+  if (code_point > 0xFFFF) {
+    return nullptr;
+  }
+
+  const auto &page = this->pages_[code_point >> 8];
+  if (page == nullptr) {
+    return nullptr;
+  }
+
+  const Entry &entry = (*page)[code_point & 0xFF];
+  return entry.advance == MISSING ? nullptr : &entry;
+}
+
+bool GlyphMetrics::measure(const char *text, int *width, int *x_offset) const {
+  // Same accumulation as font::Font::measure()
+  const auto *str = reinterpret_cast<const uint8_t *>(text);
+  int x = 0;
+  int min_x = 0;
+  bool has_char = false;
+
+  while (*str != '\0') {
+    uint32_t code_point;
+    size_t length = decode_utf8(str, &code_point);
+    const Entry *entry = length == 0 ? nullptr : this->find_(code_point);
+    if (entry == nullptr) {
+      return false;
+    }
+
+    min_x = has_char ? std::min(min_x, x + entry->offset_x) : entry->offset_x;
+    x += entry->advance;
+    has_char = true;
+    str += length;
+  }
+
+  *width = x - min_x;
+  *x_offset = min_x;
+  return true;
+}
+
+size_t GlyphMetrics::page_count() const {
+  size_t count = 0;
+  for (const auto &page : this->pages_) {
+    count += page != nullptr;
+  }
+  return count;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+
+#include "esphome/components/font/font.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+// Advance and left bearing of every glyph in a font, looked up by code point
+// in direct-mapped pages of 256 entries. Only pages the font has glyphs in
+// are allocated, so a Latin + Hebrew font takes two.
+//
+// measure() gives the same result as font::Font::measure() without the glyph
+// table search. Strings it can't measure exactly (code points outside the
+// BMP or without a glyph, malformed UTF-8) make it return false, and the
+// caller falls back to the font.
+class GlyphMetrics {
+  public:
+    void build(font::Font *font);
+    bool measure(const char *text, int *width, int *x_offset) const;
+    size_t page_count() const;
+
+  protected:
+    static constexpr int16_t MISSING = INT16_MIN;
+
+    struct Entry {
+      int16_t advance = MISSING;
+      int16_t offset_x = 0;
+    };
+    using Page = std::array<Entry, 256>;
+
+    const Entry *find_(uint32_t code_point) const;
+
+    // Indexed by the high byte of BMP code points
+    std::array<std::unique_ptr<Page>, 256> pages_;
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
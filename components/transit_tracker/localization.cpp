@@ -1,55 +1,151 @@
 #include "localization.h"
 
+#include <cstring>
+#include <limits>
+
 namespace esphome {
 namespace transit_tracker {
 
-std::string Localization::fmt_duration_from_now(time_t unix_timestamp, uint rtc_now, bool rtl_mode) const {
-  int diff = unix_timestamp - rtc_now;
+void Localization::compile_templates_() {
+  for (bool rtl_mode : {false, true}) {
+    DurationTemplate &minutes = this->templates_[rtl_mode][DURATION_MINUTES];
+    DurationTemplate &hours = this->templates_[rtl_mode][DURATION_HOURS];
+    minutes = DurationTemplate{};
+    hours = DurationTemplate{};
 
-  if (diff < 30) {
-    return this->now_string_;
+    const std::string *minutes_unit = nullptr;
+    if (this->unit_display_ == UNIT_DISPLAY_LONG) {
+      minutes_unit = &this->minutes_long_string_;
+    } else if (this->unit_display_ == UNIT_DISPLAY_SHORT) {
+      minutes_unit = &this->minutes_short_string_;
+    }
+
+    if (minutes_unit == nullptr) {
+      minutes.add(DurationToken::MINUTES);
+    } else if (rtl_mode) {
+      minutes.add(DurationToken::LITERAL, minutes_unit);
+      minutes.add(DurationToken::MINUTES);
+    } else {
+      minutes.add(DurationToken::MINUTES);
+      minutes.add(DurationToken::LITERAL, minutes_unit);
+    }
+
+    // Hours always use the short units, or h:mm without units
+    if (this->unit_display_ == UNIT_DISPLAY_NONE) {
+      static const std::string separator = ":";
+      hours.add(DurationToken::HOURS);
+      hours.add(DurationToken::LITERAL, &separator);
+      hours.add(DurationToken::MINUTES_PADDED);
+    } else if (rtl_mode) {
+      hours.add(DurationToken::LITERAL, &this->minutes_short_string_);
+      hours.add(DurationToken::MINUTES);
+      hours.add(DurationToken::LITERAL, &this->hours_short_string_);
+      hours.add(DurationToken::HOURS);
+    } else {
+      hours.add(DurationToken::HOURS);
+      hours.add(DurationToken::LITERAL, &this->hours_short_string_);
+      hours.add(DurationToken::MINUTES);
+      hours.add(DurationToken::LITERAL, &this->minutes_short_string_);
+    }
+  }
+}
+
+// Appends as much of `str` as fits, leaving room for the terminator
+static size_t append(char *buffer, size_t size, size_t length, const char *str, size_t str_length) {
+  size_t available = size - 1 - length;
+  size_t count = str_length < available ? str_length : available;
+  memcpy(buffer + length, str, count);
+  return length + count;
+}
+
+static size_t append_number(char *buffer, size_t size, size_t length, int value, bool padded) {
+  char digits[12];
+  size_t count = 0;
+
+  do {
+    digits[sizeof(digits) - 1 - count++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+
+  if (padded && count < 2) {
+    digits[sizeof(digits) - 1 - count++] = '0';
+  }
+
+  return append(buffer, size, length, digits + sizeof(digits) - count, count);
+}
+
+size_t Localization::fmt_duration_from_now(char *buffer, size_t size, time_t unix_timestamp, uint rtc_now,
+                                           bool rtl_mode, time_t *valid_until) const {
+  if (size == 0) {
+    return 0;
   }
 
-  if (diff < 60) {
-    switch (this->unit_display_) {
-      case UNIT_DISPLAY_LONG:
-        return rtl_mode ? (this->minutes_long_string_ + "0") : ("0" + this->minutes_long_string_);
-      case UNIT_DISPLAY_SHORT:
-        return rtl_mode ? (this->minutes_short_string_ + "0") : ("0" + this->minutes_short_string_);
-      case UNIT_DISPLAY_NONE:
-        return "0";
+  int diff = unix_timestamp - rtc_now;
+  size_t length = 0;
+
+  if (diff < 30) {
+    if (valid_until != nullptr) {
+      *valid_until = std::numeric_limits<time_t>::max();
     }
+
+    length = append(buffer, size, length, this->now_string_.data(), this->now_string_.length());
+    buffer[length] = '\0';
+    return length;
   }
 
+  // Between 30 and 60 seconds out, the countdown shows zero minutes
   int minutes = diff / 60;
+  int hours = minutes / 60;
+
+  if (valid_until != nullptr) {
+    *valid_until = unix_timestamp - (minutes == 0 ? 30 : minutes * 60);
+  }
 
-  if (minutes < 60) {
-    switch (this->unit_display_) {
-      case UNIT_DISPLAY_LONG:
-        return rtl_mode ? str_sprintf("%s%d", this->minutes_long_string_.c_str(), minutes) 
-                        : str_sprintf("%d%s", minutes, this->minutes_long_string_.c_str());
-      case UNIT_DISPLAY_SHORT:
-        return rtl_mode ? str_sprintf("%s%d", this->minutes_short_string_.c_str(), minutes)
-                        : str_sprintf("%d%s", minutes, this->minutes_short_string_.c_str());
-      case UNIT_DISPLAY_NONE:
-      default:
-        return str_sprintf("%d", minutes);
+  const DurationTemplate &tmpl = this->templates_[rtl_mode][hours > 0 ? DURATION_HOURS : DURATION_MINUTES];
+  if (hours > 0) {
+    minutes = minutes % 60;
+  }
+
+  for (uint8_t i = 0; i < tmpl.count; i++) {
+    const DurationToken &token = tmpl.tokens[i];
+    switch (token.kind) {
+      case DurationToken::LITERAL:
+        length = append(buffer, size, length, token.literal->data(), token.literal->length());
+        break;
+      case DurationToken::HOURS:
+        length = append_number(buffer, size, length, hours, false);
+        break;
+      case DurationToken::MINUTES:
+        length = append_number(buffer, size, length, minutes, false);
+        break;
+      case DurationToken::MINUTES_PADDED:
+        length = append_number(buffer, size, length, minutes, true);
+        break;
     }
   }
 
-  int hours = minutes / 60;
-  minutes = minutes % 60;
+  buffer[length] = '\0';
+  return length;
+}
 
-  switch (this->unit_display_) {
-    case UNIT_DISPLAY_LONG:
-    case UNIT_DISPLAY_SHORT:
-      return rtl_mode ? str_sprintf("%s%d%s%d", this->minutes_short_string_.c_str(), minutes, this->hours_short_string_.c_str(), hours)
-                      : str_sprintf("%d%s%d%s", hours, this->hours_short_string_.c_str(), minutes, this->minutes_short_string_.c_str());
-    case UNIT_DISPLAY_NONE:
-    default:
-      return str_sprintf("%d:%02d", hours, minutes);
+size_t Localization::fmt_time_of_day(char *buffer, size_t size, time_t unix_timestamp) const {
+  if (size == 0) {
+    return 0;
   }
+
+  ESPTime time = ESPTime::from_epoch_local(unix_timestamp);
+  size_t length = append_number(buffer, size, 0, time.hour, true);
+  length = append(buffer, size, length, ":", 1);
+  length = append_number(buffer, size, length, time.minute, true);
+  buffer[length] = '\0';
+  return length;
 }
 
+std::string Localization::fmt_duration_from_now(time_t unix_timestamp, uint rtc_now, bool rtl_mode) const {
+  char buffer[32];
+  size_t length = this->fmt_duration_from_now(buffer, sizeof(buffer), unix_timestamp, rtc_now, rtl_mode);
+  return std::string(buffer, length);
+}
+
+}
 }
-}
\ No newline at end of file
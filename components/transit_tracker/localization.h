@@ -13,23 +13,74 @@ enum UnitDisplay : uint8_t {
   UNIT_DISPLAY_NONE
 };
 
+// One piece of a countdown: either a literal unit string or a number
+struct DurationToken {
+  enum Kind : uint8_t {
+    LITERAL,
+    HOURS,
+    MINUTES,
+    // Zero-padded to two digits
+    MINUTES_PADDED,
+  };
+
+  Kind kind;
+  const std::string *literal;
+};
+
+// Countdown layout for one duration range, tokenized when the unit strings
+// change so formatting only copies literals and writes digits.
+struct DurationTemplate {
+  static constexpr size_t MAX_TOKENS = 4;
+
+  DurationToken tokens[MAX_TOKENS];
+  uint8_t count = 0;
+
+  void add(DurationToken::Kind kind, const std::string *literal = nullptr) { tokens[count++] = DurationToken{kind, literal}; }
+};
+
 class Localization {
   public:
+    Localization() { this->compile_templates_(); }
+    // The templates point into this instance's strings, which a copy or move
+    // would leave them pointing into
+    Localization(const Localization &) = delete;
+    Localization &operator=(const Localization &) = delete;
+
+    // Writes the countdown into `buffer` (always NUL-terminated, truncated to
+    // fit) without allocating and returns its length. If `valid_until` is
+    // given, it receives the last RTC time at which the text is unchanged.
+    size_t fmt_duration_from_now(char *buffer, size_t size, time_t unix_timestamp, uint rtc_now, bool rtl_mode = false,
+                                 time_t *valid_until = nullptr) const;
     std::string fmt_duration_from_now(time_t unix_timestamp, uint rtc_now, bool rtl_mode = false) const;
+    // Writes the local time of day as HH:MM, for when there is no clock to
+    // count down from
+    size_t fmt_time_of_day(char *buffer, size_t size, time_t unix_timestamp) const;
 
-    void set_unit_display(UnitDisplay unit_display) { unit_display_ = unit_display; }
+    void set_unit_display(UnitDisplay unit_display) { unit_display_ = unit_display; this->compile_templates_(); }
     void set_now_string(const std::string &now_string) { now_string_ = now_string; }
     void set_minutes_long_string(const std::string &minutes_long_string) { minutes_long_string_ = minutes_long_string; }
-    void set_minutes_short_string(const std::string &minutes_long_string) { minutes_long_string_ = minutes_long_string; }
+    void set_minutes_short_string(const std::string &minutes_short_string) { minutes_short_string_ = minutes_short_string; }
     void set_hours_short_string(const std::string &hours_short_string) { hours_short_string_ = hours_short_string; }
 
   protected:
+    enum DurationRange : uint8_t {
+      DURATION_MINUTES,
+      DURATION_HOURS,
+      DURATION_RANGE_COUNT,
+    };
+
+    void compile_templates_();
+
     UnitDisplay unit_display_ = UNIT_DISPLAY_LONG;
     std::string now_string_ = "Now";
     std::string minutes_long_string_ = "min";
     std::string minutes_short_string_ = "m";
     std::string hours_short_string_ = "h";
+
+    // Indexed by [rtl_mode][range]; literals point at the strings above, so
+    // only the unit display setting requires recompiling.
+    DurationTemplate templates_[2][DURATION_RANGE_COUNT];
 };
 
 }  // namespace transit_tracker
-}  // namespace esphome
\ No newline at end of file
+}  // namespace esphome
@@ -0,0 +1,104 @@
+#include "memory.h"
+
+#include <cstdlib>
+
+#ifdef USE_ESP32
+#include <esp_heap_caps.h>
+#endif
+
+namespace esphome {
+namespace transit_tracker {
+
+static bool use_psram = false;
+static MemoryStats memory_stats;
+
+void set_memory_placement(MemoryPlacement placement) {
+#ifdef USE_ESP32
+  // Without PSRAM every allocation would count as a fallback
+  use_psram = placement == MEMORY_PLACEMENT_PSRAM && heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0;
+#else
+  use_psram = false;
+#endif
+}
+
+bool uses_psram() { return use_psram; }
+
+void *placed_malloc(size_t size) {
+  void *ptr = nullptr;
+
+#ifdef USE_ESP32
+  if (use_psram) {
+    ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (ptr != nullptr) {
+      return ptr;
+    }
+    memory_stats.psram_fallbacks++;
+  }
+
+  ptr = heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+  ptr = malloc(size);
+#endif
+
+  if (ptr == nullptr && size != 0) {
+    memory_stats.failures++;
+  }
+
+  return ptr;
+}
+
+void *placed_realloc(void *ptr, size_t size) {
+  if (ptr == nullptr) {
+    return placed_malloc(size);
+  }
+
+  void *new_ptr = nullptr;
+
+#ifdef USE_ESP32
+  // heap_caps_realloc keeps the block in a region matching the caps, moving
+  // it if needed
+  if (use_psram) {
+    new_ptr = heap_caps_realloc(ptr, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (new_ptr != nullptr) {
+      return new_ptr;
+    }
+    memory_stats.psram_fallbacks++;
+  }
+
+  new_ptr = heap_caps_realloc(ptr, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+  new_ptr = realloc(ptr, size);
+#endif
+
+  if (new_ptr == nullptr && size != 0) {
+    memory_stats.failures++;
+  }
+
+  return new_ptr;
+}
+
+void placed_free(void *ptr) {
+#ifdef USE_ESP32
+  heap_caps_free(ptr);
+#else
+  free(ptr);
+#endif
+}
+
+const MemoryStats &get_memory_stats() { return memory_stats; }
+
+size_t get_largest_free_internal_block() {
+#ifdef USE_ESP32
+  return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+  return 0;
+#endif
+}
+
+PlacedJsonAllocator *PlacedJsonAllocator::instance() {
+  static PlacedJsonAllocator allocator;
+  return &allocator;
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
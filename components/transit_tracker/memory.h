@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <ArduinoJson.h>
+
+namespace esphome {
+namespace transit_tracker {
+
+enum MemoryPlacement : uint8_t {
+  MEMORY_PLACEMENT_INTERNAL,
+  MEMORY_PLACEMENT_PSRAM,
+};
+
+// Counts since boot. Atomic, since documents are also decoded on the network
+// task.
+struct MemoryStats {
+  // PSRAM allocations that had to be served from internal RAM
+  std::atomic<uint32_t> psram_fallbacks{0};
+  // Allocations that could not be served at all
+  std::atomic<uint32_t> failures{0};
+};
+
+// Schedule buffers (decoded messages, trips, headsigns and sprites) are kept
+// out of internal RAM when PSRAM placement is selected, leaving it to TLS and
+// display DMA. PSRAM placement falls back to internal RAM on boards without
+// PSRAM or when it is exhausted. The setting is shared by all trackers.
+void set_memory_placement(MemoryPlacement placement);
+bool uses_psram();
+
+void *placed_malloc(size_t size);
+void *placed_realloc(void *ptr, size_t size);
+void placed_free(void *ptr);
+
+const MemoryStats &get_memory_stats();
+size_t get_largest_free_internal_block();
+
+template<typename T> class PlacedAllocator {
+  public:
+    using value_type = T;
+
+    PlacedAllocator() = default;
+    template<typename U> PlacedAllocator(const PlacedAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+      void *ptr = placed_malloc(n * sizeof(T));
+      if (ptr == nullptr) {
+        // Containers can't handle a null allocation; fail the way
+        // std::allocator does
+#if __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+      }
+      return static_cast<T *>(ptr);
+    }
+    void deallocate(T *ptr, size_t) { placed_free(ptr); }
+
+    template<typename U> bool operator==(const PlacedAllocator<U> &) const { return true; }
+    template<typename U> bool operator!=(const PlacedAllocator<U> &) const { return false; }
+};
+
+template<typename T> using PlacedVector = std::vector<T, PlacedAllocator<T>>;
+
+// ArduinoJson reports failed allocations as NoMemory, so documents can use
+// the placement directly.
+class PlacedJsonAllocator : public ArduinoJson::Allocator {
+  public:
+    void *allocate(size_t size) override { return placed_malloc(size); }
+    void deallocate(void *ptr) override { placed_free(ptr); }
+    void *reallocate(void *ptr, size_t new_size) override { return placed_realloc(ptr, new_size); }
+
+    static PlacedJsonAllocator *instance();
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace transit_tracker {
+
+// Fixed-size ring of the most recent samples with min/avg/percentile roll-ups.
+// Adding a sample is O(1) and never allocates.
+class SampleWindow {
+  public:
+    static constexpr size_t CAPACITY = 64;
+
+    void add(uint32_t sample) {
+      this->samples_[this->next_] = sample;
+      this->next_ = (this->next_ + 1) % CAPACITY;
+      this->count_ = std::min(this->count_ + 1, CAPACITY);
+    }
+
+    void reset() {
+      this->count_ = 0;
+      this->next_ = 0;
+    }
+
+    size_t count() const { return this->count_; }
+    bool empty() const { return this->count_ == 0; }
+
+    uint32_t min() const {
+      if (this->empty()) {
+        return 0;
+      }
+      return *std::min_element(this->samples_.begin(), this->samples_.begin() + this->count_);
+    }
+
+    uint32_t max() const {
+      if (this->empty()) {
+        return 0;
+      }
+      return *std::max_element(this->samples_.begin(), this->samples_.begin() + this->count_);
+    }
+
+    uint32_t average() const {
+      if (this->empty()) {
+        return 0;
+      }
+
+      uint64_t sum = 0;
+      for (size_t i = 0; i < this->count_; i++) {
+        sum += this->samples_[i];
+      }
+      return sum / this->count_;
+    }
+
+    // Nearest-rank percentile, percent in [0, 100]
+    uint32_t percentile(uint8_t percent) const {
+      if (this->empty()) {
+        return 0;
+      }
+
+      std::array<uint32_t, CAPACITY> sorted = this->samples_;
+      size_t rank = (this->count_ * std::min<uint8_t>(percent, 100) + 99) / 100;
+      size_t index = rank == 0 ? 0 : rank - 1;
+
+      std::nth_element(sorted.begin(), sorted.begin() + index, sorted.begin() + this->count_);
+      return sorted[index];
+    }
+
+  protected:
+    std::array<uint32_t, CAPACITY> samples_{};
+    size_t count_ = 0;
+    size_t next_ = 0;
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
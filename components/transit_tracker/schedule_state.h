@@ -1,28 +1,174 @@
 #pragma once
 
-#include <vector>
+#include <cstdint>
+#include <string>
+#include <memory>
 #include <mutex>
+#include <vector>
 
 #include "esphome/components/display/display.h"
 
+#include "memory.h"
+#include "sprite.h"
+
 namespace esphome {
 namespace transit_tracker {
 
+// Route names are stored in visual order when RTL mode is enabled
+class Route {
+  public:
+    std::string id;
+    std::string name;
+    Color color;
+};
+
+// Bump allocator for NUL-terminated strings. Offsets stay valid until the
+// next clear(), and the buffer keeps its capacity across schedules.
+class StringArena {
+  public:
+    uint32_t add(const char *str, size_t length) {
+      uint32_t offset = this->buffer_.size();
+      this->buffer_.insert(this->buffer_.end(), str, str + length);
+      this->buffer_.push_back('\0');
+      return offset;
+    }
+    uint32_t add(const std::string &str) { return this->add(str.data(), str.length()); }
+
+    const char *get(uint32_t offset) const { return this->buffer_.data() + offset; }
+    void clear() { this->buffer_.clear(); }
+    void swap(StringArena &other) { this->buffer_.swap(other.buffer_); }
+    size_t size() const { return this->buffer_.size(); }
+    size_t capacity() const { return this->buffer_.capacity(); }
+    void reserve(size_t capacity) { this->buffer_.reserve(capacity); }
+    // Releases the buffer and starts over with `capacity`
+    void reset(size_t capacity) {
+      PlacedVector<char>().swap(this->buffer_);
+      this->buffer_.reserve(capacity);
+    }
+
+  protected:
+    PlacedVector<char> buffer_;
+};
+
 class Trip {
   public:
-    std::string route_id;
-    std::string route_name;
-    Color route_color;
-    std::string headsign;
+    // Hash of the server's tripId, used to match schedule patches
+    uint32_t trip_key;
+    // Headsigns are stored in visual order when RTL mode is enabled
+    uint32_t headsign_offset;
+    uint16_t headsign_length;
+    uint16_t route_index;
     time_t arrival_time;
     time_t departure_time;
     bool is_realtime;
+    // Restored from a snapshot before the clock was set, so possibly long gone
+    bool is_stale = false;
+};
+
+static constexpr size_t TIME_DISPLAY_SIZE = 32;
+
+// Measured geometry for a trip row, rebuilt when a new schedule is published
+// and refreshed only when the trip's countdown string changes.
+class TripLayout {
+  public:
+    // Countdown text, reformatted only once the RTC moves past the window in
+    // which it stays the same
+    char time_display[TIME_DISPLAY_SIZE] = "";
+    time_t time_display_from = 0;
+    time_t time_display_until = -1;
+    int route_width = -1;
+    int time_width = -1;
+    int headsign_width = -1;
+    int headsign_x_offset = 0;
+    int headsign_clipping_start = 0;
+    int headsign_clipping_end = 0;
+    int headsign_overflow = 0;
+    int icon_x = 0;
+    // Only rendered for headsigns that scroll
+    TextSprite headsign_sprite;
 };
 
+// Fixed-size copy of the displayed schedule that is persisted to flash, so
+// the last known trips can be shown after a reboot or during an outage.
+static constexpr size_t MAX_SNAPSHOT_TRIPS = 8;
+static constexpr size_t SNAPSHOT_ROUTE_NAME_SIZE = 16;
+static constexpr size_t SNAPSHOT_HEADSIGN_SIZE = 48;
+
+struct SnapshotTrip {
+  uint32_t trip_key;
+  int32_t arrival_time;
+  int32_t departure_time;
+  uint32_t route_color;
+  bool is_realtime;
+  char route_name[SNAPSHOT_ROUTE_NAME_SIZE];
+  char headsign[SNAPSHOT_HEADSIGN_SIZE];
+};
+
+struct ScheduleSnapshot {
+  // RTC time when the schedule was received
+  int32_t saved_at;
+  uint8_t trip_count;
+  SnapshotTrip trips[MAX_SNAPSHOT_TRIPS];
+};
+
+// An immutable schedule as shown by the renderer. Ingest builds the next one
+// off to the side and publishes it whole, so a frame never sees a partially
+// applied update.
+class Schedule {
+  public:
+    const Route &route(const Trip &trip) const { return (*this->routes)[trip.route_index]; }
+    const char *headsign(const Trip &trip) const { return this->headsigns.get(trip.headsign_offset); }
+
+    // Changes with every published schedule, so layouts know to be rebuilt
+    uint32_t generation = 0;
+    PlacedVector<Trip> trips;
+    // Shared between schedules until the ingest route table changes
+    std::shared_ptr<const std::vector<Route>> routes = std::make_shared<const std::vector<Route>>();
+    StringArena headsigns;
+};
+
+// Double-buffered handoff of the displayed schedule from the ingest path to
+// the renderer. Ingest fills the spare buffer and publishes it whole; readers
+// load() a reference and may keep it for as long as they draw. The mutex
+// only guards copying the pointer, never building or drawing a schedule.
+// The previous schedule's buffers are recycled once no reader holds it,
+// otherwise a fresh one is allocated.
 class ScheduleState {
   public:
-    std::mutex mutex;
-    std::vector<Trip> trips;
+    std::shared_ptr<const Schedule> load() const {
+      std::lock_guard<std::mutex> lock(this->current_mutex_);
+      return this->current_;
+    }
+
+    // Ingest side only
+    const Schedule &published() const { return *this->published_; }
+
+    Schedule &begin() {
+      if (this->spare_ == nullptr || this->spare_.use_count() > 1) {
+        this->spare_ = std::make_shared<Schedule>();
+      }
+      this->spare_->trips.clear();
+      this->spare_->headsigns.clear();
+      return *this->spare_;
+    }
+
+    // The schedule being built since the last begin()
+    Schedule &pending() { return *this->spare_; }
+
+    void publish() {
+      this->spare_->generation = ++this->generation_;
+      this->spare_.swap(this->published_);
+
+      std::lock_guard<std::mutex> lock(this->current_mutex_);
+      this->current_ = this->published_;
+    }
+
+  protected:
+    uint32_t generation_ = 0;
+    std::shared_ptr<Schedule> published_ = std::make_shared<Schedule>();
+    std::shared_ptr<Schedule> spare_;
+    mutable std::mutex current_mutex_;
+    std::shared_ptr<const Schedule> current_ = published_;
 };
 
 } // namespace transit_tracker
@@ -0,0 +1,54 @@
+#include "sprite.h"
+
+#include <algorithm>
+
+namespace esphome {
+namespace transit_tracker {
+
+bool SpriteCanvas::render(TextSprite &sprite, font::Font *font, const char *text, int width, int x_offset, int height) {
+  if (width <= 0 || height <= 0) {
+    sprite.clear();
+    return false;
+  }
+
+  sprite.width = width;
+  sprite.x_offset = x_offset;
+  sprite.height = height;
+  sprite.pixels.assign(width * height, 0);
+
+  this->target_ = &sprite;
+  this->print(-x_offset, 0, font, display::COLOR_ON, display::TextAlign::TOP_LEFT, text);
+  this->target_ = nullptr;
+
+  return true;
+}
+
+void SpriteCanvas::draw_pixel_at(int x, int y, Color color) {
+  if (this->target_ == nullptr || x < 0 || y < 0 || x >= this->target_->width || y >= this->target_->height) {
+    return;
+  }
+
+  // Anti-aliased fonts blend from COLOR_OFF towards COLOR_ON, so any channel gives the coverage
+  this->target_->pixels[y * this->target_->width + x] = std::max(color.r, std::max(color.g, color.b));
+}
+
+void SpriteCanvas::blit(display::Display *display, const TextSprite &sprite, int x, int y, int clip_start, int clip_end, Color color) const {
+  int column_start = std::max(0, clip_start - x);
+  int column_end = std::min(sprite.width, clip_end - x);
+
+  for (int row = 0; row < sprite.height; row++) {
+    const uint8_t *line = sprite.pixels.data() + row * sprite.width;
+
+    for (int column = column_start; column < column_end; column++) {
+      uint8_t coverage = line[column];
+      if (coverage == 0) {
+        continue;
+      }
+
+      display->draw_pixel_at(x + column, y + row, coverage == 255 ? color : display::COLOR_OFF.gradient(color, coverage));
+    }
+  }
+}
+
+}  // namespace transit_tracker
+}  // namespace esphome
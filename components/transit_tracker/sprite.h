@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "esphome/components/display/display.h"
+#include "esphome/components/font/font.h"
+
+#include "memory.h"
+
+namespace esphome {
+namespace transit_tracker {
+
+// Pre-rasterized text as one coverage byte per pixel (0 = transparent,
+// 255 = fully lit), so scrolling only has to blit the visible columns.
+// Column 0 is the first inked column, which the font draws x_offset pixels
+// right of the print position.
+class TextSprite {
+  public:
+    bool empty() const { return this->pixels.empty(); }
+    void clear() {
+      this->pixels.clear();
+      this->pixels.shrink_to_fit();
+      this->width = 0;
+      this->x_offset = 0;
+      this->height = 0;
+    }
+
+    int width = 0;
+    int x_offset = 0;
+    int height = 0;
+    PlacedVector<uint8_t> pixels;
+    size_t size_bytes() const { return this->pixels.capacity(); }
+};
+
+// Off-screen display that captures font rendering into a TextSprite
+class SpriteCanvas : public display::Display {
+  public:
+    bool render(TextSprite &sprite, font::Font *font, const char *text, int width, int x_offset, int height);
+    void blit(display::Display *display, const TextSprite &sprite, int x, int y, int clip_start, int clip_end, Color color) const;
+
+    void update() override {}
+    void draw_pixel_at(int x, int y, Color color) override;
+    display::DisplayType get_display_type() override { return display::DisplayType::DISPLAY_TYPE_GRAYSCALE; }
+
+  protected:
+    int get_width_internal() override { return this->target_ == nullptr ? 0 : this->target_->width; }
+    int get_height_internal() override { return this->target_ == nullptr ? 0 : this->target_->height; }
+
+    TextSprite *target_ = nullptr;
+};
+
+}  // namespace transit_tracker
+}  // namespace esphome
@@ -1,49 +1,60 @@
 #include "string_utils.h"
-#include <sstream>
-#include <algorithm>
-#include <vector>
-
-std::vector<std::string> split(const std::string &s, char delim) {
-  std::vector<std::string> elems;
-  std::stringstream ss(s);
-  std::string item;
-  while (std::getline(ss, item, delim)) {
-    elems.push_back(item);
+#include <charconv>
+
+bool SplitIterator::next(std::string_view *field) {
+  if (this->pos_ >= this->text_.size()) {
+    return false;
+  }
+
+  size_t end = this->text_.find(this->delim_, this->pos_);
+  if (end == std::string_view::npos) {
+    end = this->text_.size();
   }
-  return elems;
+
+  *field = this->text_.substr(this->pos_, end - this->pos_);
+  this->pos_ = end + 1;
+  return true;
 }
 
-std::string reverse_string(const std::string &s) {
-  std::vector<std::string> chars;
-  size_t i = 0;
-  
-  while (i < s.length()) {
-    unsigned char c = s[i];
-    size_t char_len = 1;
-    
-    if ((c & 0x80) == 0) {
-      char_len = 1;
-    } else if ((c & 0xE0) == 0xC0) {
-      char_len = 2;
-    } else if ((c & 0xF0) == 0xE0) {
-      char_len = 3;
-    } else if ((c & 0xF8) == 0xF0) {
-      char_len = 4;
-    }
-    
-    if (i + char_len <= s.length()) {
-      chars.push_back(s.substr(i, char_len));
+size_t split(std::string_view text, char delim, std::string_view *fields, size_t max_fields) {
+  SplitIterator it(text, delim);
+  std::string_view field;
+  size_t count = 0;
+
+  while (it.next(&field)) {
+    if (count < max_fields) {
+      fields[count] = field;
     }
-    
-    i += char_len;
+    count++;
   }
-  
-  std::reverse(chars.begin(), chars.end());
-  
-  std::string result;
-  for (const auto &ch : chars) {
-    result += ch;
+
+  return count;
+}
+
+bool parse_hex(std::string_view text, uint32_t *value) {
+  const char *end = text.data() + text.size();
+  auto result = std::from_chars(text.data(), end, *value, 16);
+  return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+std::string url_encode(std::string_view value) {
+  static const char HEX[] = "0123456789ABCDEF";
+
+  std::string encoded;
+  encoded.reserve(value.size());
+
+  for (char c : value) {
+    bool unreserved = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' ||
+                      c == '_' || c == '.' || c == '~';
+    if (unreserved) {
+      encoded += c;
+    } else {
+      encoded += '%';
+      auto byte = static_cast<uint8_t>(c);
+      encoded += HEX[byte >> 4];
+      encoded += HEX[byte & 0xF];
+    }
   }
-  
-  return result;
-}
\ No newline at end of file
+
+  return encoded;
+}
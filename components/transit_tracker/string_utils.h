@@ -1,7 +1,32 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <vector>
+#include <string_view>
 
-std::vector<std::string> split(const std::string &s, char delim);
-std::string reverse_string(const std::string &s);
+// Iterates over the fields of `text` separated by `delim` without copying.
+// Like std::getline, a trailing delimiter does not produce an empty field.
+class SplitIterator {
+  public:
+    SplitIterator(std::string_view text, char delim) : text_(text), delim_(delim) {}
+
+    bool next(std::string_view *field);
+
+  protected:
+    std::string_view text_;
+    char delim_;
+    size_t pos_ = 0;
+};
+
+// Splits `text` into at most `max_fields` views and returns the total number
+// of fields, which may be larger than `max_fields`.
+size_t split(std::string_view text, char delim, std::string_view *fields, size_t max_fields);
+
+// Parses all of `text` as a hexadecimal number. Fails on empty input,
+// trailing characters and overflow, leaving `value` unspecified.
+bool parse_hex(std::string_view text, uint32_t *value);
+
+// Percent-encodes everything but RFC 3986 unreserved characters, for use in
+// URL query values.
+std::string url_encode(std::string_view value);
@@ -1,281 +1,765 @@
 #include "transit_tracker.h"
 #include "string_utils.h"
+#include "bidi.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <limits>
 
 #include "esphome/core/log.h"
 #include "esphome/core/application.h"
 #include "esphome/components/json/json_util.h"
-#include "esphome/components/watchdog/watchdog.h"
 #include "esphome/components/network/util.h"
 
+#ifdef USE_ESP32
+#include <esp_heap_caps.h>
+#endif
+
 namespace esphome {
 namespace transit_tracker {
 
 static const char *TAG = "transit_tracker.component";
 
 void TransitTracker::setup() {
-  this->ws_client_.onMessage([this](websockets::WebsocketsMessage message) {
-    this->on_ws_message_(message);
-  });
-
-  this->ws_client_.onEvent([this](websockets::WebsocketsEvent event, String data) {
-    this->on_ws_event_(event, data);
-  });
-
-  this->connect_ws_();
+  this->abbreviations_.compile();
+  this->glyph_metrics_.build(this->font_);
 
-  this->set_interval("check_stale_trips", 10000, [this]() {
-    if (this->ws_client_.available() && !this->schedule_state_.trips.empty()) {
-      bool has_stale_trips = false;
+  this->load_snapshot_();
+  this->schedule_trip_expiry_();
 
-      this->schedule_state_.mutex.lock();
-
-      auto now = this->rtc_->now();
-      if (now.is_valid()) {
-        for (auto &trip : this->schedule_state_.trips) {
-          if (now.timestamp - trip.departure_time > 60) {
-            has_stale_trips = true;
-            break;
-          }
-        }
-      }
-
-      this->schedule_state_.mutex.unlock();
-
-      if (has_stale_trips) {
-        ESP_LOGD(TAG, "Stale trips detected, reconnecting");
-        ESP_LOGD(TAG, "  Current RTC time: %d", now.timestamp);
-        ESP_LOGD(TAG, "  Last heartbeat: %d", this->last_heartbeat_);
-        this->reconnect();
-      }
-    }
+  // Restored trips can be checked and pruned as soon as the time is known
+  this->rtc_->add_on_time_sync_callback([this]() {
+    this->check_stale_snapshot_();
+    this->expire_trips_();
   });
-}
 
-void TransitTracker::loop() {
-  this->ws_client_.poll();
+  this->set_interval("log_stats", 60000, [this]() {
+    this->log_render_stats_();
+    this->log_ingest_stats_();
+  });
 
-  if (this->last_heartbeat_ != 0 && millis() - this->last_heartbeat_ > 60000) {
-    ESP_LOGW(TAG, "Heartbeat timeout, reconnecting");
-    this->reconnect();
-    return;
+  if (this->has_telemetry_()) {
+    this->set_interval("telemetry", this->telemetry_interval_, [this]() {
+      this->publish_telemetry_();
+    });
   }
 }
 
 void TransitTracker::dump_config() {
   ESP_LOGCONFIG(TAG, "Transit Tracker:");
-  ESP_LOGCONFIG(TAG, "  Base URL: %s", this->base_url_.c_str());
+  ESP_LOGCONFIG(TAG, "  Base URL: %s", this->hub_->get_base_url().c_str());
+  ESP_LOGCONFIG(TAG, "  Subscription ID: %" PRIu32, this->subscription_id_);
   ESP_LOGCONFIG(TAG, "  Schedule: %s", this->schedule_string_.c_str());
   ESP_LOGCONFIG(TAG, "  Limit: %d", this->limit_);
   ESP_LOGCONFIG(TAG, "  List mode: %s", this->list_mode_.c_str());
   ESP_LOGCONFIG(TAG, "  Display departure times: %s", this->display_departure_times_ ? "true" : "false");
   ESP_LOGCONFIG(TAG, "  Scroll Headsigns: %s", this->scroll_headsigns_ ? "true" : "false");
+  ESP_LOGCONFIG(TAG, "  Schedule patches: %s", this->schedule_patches_ ? "true" : "false");
+  ESP_LOGCONFIG(TAG, "  Message encoding: %s", this->message_encoding_ == MESSAGE_ENCODING_MSGPACK ? "msgpack" : "json");
+  ESP_LOGCONFIG(TAG, "  Persist schedule: %s", this->persist_schedule_ ? "true" : "false");
+  ESP_LOGCONFIG(TAG, "  Memory placement: %s", uses_psram() ? "PSRAM" : "internal");
+}
+
+void TransitTracker::on_shutdown() {
+  this->cancel_timeout("expire_trips");
+  this->cancel_interval("log_stats");
+  this->cancel_interval("telemetry");
+}
+
+void TransitTracker::set_hub(ConnectionHub *hub) {
+  this->hub_ = hub;
+  this->subscription_id_ = hub->register_tracker(this);
 }
 
 void TransitTracker::reconnect() {
-  this->close();
-  this->connect_ws_();
+  this->hub_->reconnect();
 }
 
 void TransitTracker::close(bool fully) {
-  if (fully) {
-    this->fully_closed_ = true;
+  this->hub_->close(fully);
+}
+
+void TransitTracker::on_hub_connected(bool reconnected) {
+  if (reconnected) {
+    this->ingest_stats_.reconnects++;
   }
 
-  this->ws_client_.close();
+  this->status_clear_error();
+  this->send_subscribe_();
 }
 
-void TransitTracker::on_shutdown() {
-  this->cancel_interval("check_stale_trips");
-  this->close(true);
+void TransitTracker::on_hub_message(const char *event, JsonObject data, size_t length, uint32_t decode_us) {
+  this->ingest_stats_.messages++;
+  this->ingest_stats_.bytes += length;
+  this->ingest_stats_.largest_message = std::max<uint32_t>(this->ingest_stats_.largest_message, length);
+  this->ingest_stats_.decode_us.add(decode_us);
+  this->message_bytes_.add(length);
+
+  if (strcmp(event, "schedule") == 0) {
+    ESP_LOGD(TAG, "Received schedule update");
+    this->ingest_schedule_(data);
+    return;
+  }
+
+  if (strcmp(event, "schedule:patch") == 0 && this->schedule_patches_) {
+    ESP_LOGD(TAG, "Received schedule patch");
+    this->apply_schedule_patch_(data);
+    return;
+  }
 }
 
-void TransitTracker::on_ws_message_(websockets::WebsocketsMessage message) {
-  ESP_LOGV(TAG, "Received message: %s", message.rawData().c_str());
+void TransitTracker::on_hub_message_dropped(size_t length) {
+  this->ingest_stats_.messages++;
+  this->ingest_stats_.bytes += length;
+  this->ingest_stats_.largest_message = std::max<uint32_t>(this->ingest_stats_.largest_message, length);
+  this->ingest_stats_.dropped++;
+  this->message_bytes_.add(length);
+  this->status_set_error("Failed to parse schedule data");
+}
+
+void TransitTracker::send_subscribe_() {
+  auto message = json::build_json([this](JsonObject root) {
+    root["event"] = "schedule:subscribe";
+
+    auto data = root.createNestedObject("data");
+    data["subscriptionId"] = this->subscription_id_;
 
-  bool valid = json::parse_json(message.rawData(), [this](JsonObject root) -> bool {
-    if (root["event"].as<std::string>() == "heartbeat") {
-      ESP_LOGD(TAG, "Received heartbeat");
-      this->last_heartbeat_ = millis();
-      return true;
+    if (!this->feed_code_.empty()) {
+      data["feedCode"] = this->feed_code_;
     }
 
-    if (root["event"].as<std::string>() != "schedule") {
-      return true;
+    data["routeStopPairs"] = this->schedule_string_;
+    data["limit"] = this->limit_;
+    data["sortByDeparture"] = this->display_departure_times_;
+    data["listMode"] = this->list_mode_;
+
+    if (this->schedule_patches_) {
+      data["acceptPatches"] = true;
     }
 
-    ESP_LOGD(TAG, "Received schedule update");
+    if (this->message_encoding_ == MESSAGE_ENCODING_MSGPACK) {
+      data["encoding"] = "msgpack";
+    }
+  });
+
+  this->has_schedule_seq_ = false;
+  this->hub_->send(message);
+}
+
+std::string TransitTracker::get_schedule_query() const {
+  // Same parameters as the schedule:subscribe event
+  std::string query = "routeStopPairs=" + url_encode(this->schedule_string_);
+  if (!this->feed_code_.empty()) {
+    query += "&feedCode=" + url_encode(this->feed_code_);
+  }
+  query += "&limit=" + std::to_string(this->limit_);
+  query += this->display_departure_times_ ? "&sortByDeparture=true" : "&sortByDeparture=false";
+  query += "&listMode=" + url_encode(this->list_mode_);
+  return query;
+}
+
+uint32_t TransitTracker::get_poll_interval() const {
+  auto schedule = this->schedule_state_.load();
+  auto now = this->rtc_->now();
+  if (schedule->trips.empty() || !now.is_valid()) {
+    return POLL_INTERVAL_MAX;
+  }
 
-    this->schedule_state_.mutex.lock();
+  // Refresh more often as the next departure approaches, where realtime
+  // updates matter most
+  time_t nearest = std::numeric_limits<time_t>::max();
+  for (const Trip &trip : schedule->trips) {
+    nearest = std::min(nearest, this->display_departure_times_ ? trip.departure_time : trip.arrival_time);
+  }
+
+  time_t until = std::max<time_t>(0, nearest - now.timestamp);
+  return std::clamp<time_t>(until * 1000 / 4, POLL_INTERVAL_MIN, POLL_INTERVAL_MAX);
+}
+
+// fnv1_hash() of the ID, computed in place so that matching patch entries
+// against trips doesn't copy every ID into a std::string
+static uint32_t trip_key(JsonVariant trip_id) {
+  const char *id = trip_id.as<const char *>();
+  if (id == nullptr) {
+    return fnv1_hash(trip_id.as<std::string>());
+  }
+
+  uint32_t hash = 2166136261UL;
+  for (; *id != '\0'; id++) {
+    hash *= 16777619UL;
+    hash ^= *id;
+  }
+  return hash;
+}
+
+void TransitTracker::ingest_schedule_(JsonObject data) {
+  Schedule &next = this->schedule_state_.begin();
+  auto &trips = next.trips;
 
-    this->schedule_state_.trips.clear();
+  this->reserve_ingest_budget_(next);
 
-    auto data = root["data"].as<JsonObject>();
+  for (auto trip : data["trips"].as<JsonArray>()) {
+    if (trips.size() >= static_cast<size_t>(this->limit_)) {
+      break;
+    }
+
+    trips.emplace_back();
+    this->ingest_trip_(trip, trips.back(), next.headsigns);
+  }
+
+  this->has_schedule_seq_ = !data["seq"].isNull();
+  this->schedule_seq_ = data["seq"] | 0;
+
+  this->publish_ingested_schedule_(next);
+}
+
+void TransitTracker::ingest_trip_(JsonVariant json, Trip &trip, StringArena &headsigns) {
+  std::string headsign = this->abbreviations_.apply(json["headsign"].as<std::string>());
+  if (this->rtl_mode_) {
+    headsign = bidi_visual_order(headsign, true);
+  }
+
+  trip.trip_key = trip_key(json["tripId"]);
+  trip.headsign_offset = headsigns.add(headsign);
+  trip.headsign_length = headsign.length();
+  trip.route_index = this->intern_route_(json);
+  trip.arrival_time = json["arrivalTime"].as<time_t>();
+  trip.departure_time = json["departureTime"].as<time_t>();
+  trip.is_realtime = json["isRealtime"].as<bool>();
+}
+
+void TransitTracker::apply_schedule_patch_(JsonObject data) {
+  uint32_t seq = data["seq"] | 0;
+  if (!this->has_schedule_seq_ || seq != this->schedule_seq_ + 1) {
+    ESP_LOGW(TAG, "Schedule patch %" PRIu32 " does not follow %" PRIu32 ", requesting a full schedule", seq, this->schedule_seq_);
+    this->ingest_stats_.dropped++;
+    this->send_subscribe_();
+    return;
+  }
 
-    for (auto trip : data["trips"].as<JsonArray>()) {
-      std::string headsign = trip["headsign"].as<std::string>();
-      for (const auto &abbr : this->abbreviations_) {
-        size_t pos = headsign.find(abbr.first);
-        if (pos != std::string::npos) {
-          ESP_LOGV(TAG, "Applying abbreviation '%s' -> '%s' in headsign", abbr.first.c_str(), abbr.second.c_str());
-          headsign.replace(pos, abbr.first.length(), abbr.second);
-        }
+  this->schedule_seq_ = seq;
+
+  // The published schedule is only replaced by the ingest path, so it stays
+  // put while the next one is built from it.
+  const Schedule &current = this->schedule_state_.published();
+  Schedule &next = this->schedule_state_.begin();
+  auto &trips = next.trips;
+  this->reserve_ingest_budget_(next);
+
+  JsonArray removals = data["remove"].as<JsonArray>();
+  JsonArray updates = data["update"].as<JsonArray>();
+
+  // Surviving trips are all copied before any route is interned, so that a
+  // route table compaction remaps every one of them.
+  std::vector<JsonVariant> trip_updates;
+  trip_updates.reserve(current.trips.size());
+
+  for (const Trip &existing : current.trips) {
+    bool removed = false;
+    for (auto trip_id : removals) {
+      if (trip_key(trip_id) == existing.trip_key) {
+        removed = true;
+        break;
       }
+    }
 
-      auto route_id = trip["routeId"].as<std::string>();
-      auto route_style = this->route_styles_.find(route_id);
+    if (removed) {
+      continue;
+    }
 
-      Color route_color = this->default_route_color_;
-      std::string route_name = trip["routeName"].as<std::string>();
+    trips.push_back(existing);
+    Trip &trip = trips.back();
 
-      if (route_style != this->route_styles_.end()) {
-        route_color = route_style->second.color;
-        route_name = route_style->second.name;
-      } else if (!trip["routeColor"].isNull()) {
-        route_color = Color(std::stoul(trip["routeColor"].as<std::string>(), nullptr, 16));
+    JsonVariant update;
+    for (auto candidate : updates) {
+      if (trip_key(candidate["tripId"]) == existing.trip_key) {
+        update = candidate;
+        break;
       }
+    }
+    trip_updates.push_back(update);
 
-      this->schedule_state_.trips.push_back({
-        .route_id = route_id,
-        .route_name = route_name,
-        .route_color = route_color,
-        .headsign = headsign,
-        .arrival_time = trip["arrivalTime"].as<time_t>(),
-        .departure_time = trip["departureTime"].as<time_t>(),
-        .is_realtime = trip["isRealtime"].as<bool>(),
-      });
+    if (update.isNull() || update["headsign"].isNull()) {
+      trip.headsign_offset = next.headsigns.add(current.headsign(existing), existing.headsign_length);
+    } else {
+      std::string headsign = this->abbreviations_.apply(update["headsign"].as<std::string>());
+      if (this->rtl_mode_) {
+        headsign = bidi_visual_order(headsign, true);
+      }
+      trip.headsign_offset = next.headsigns.add(headsign);
+      trip.headsign_length = headsign.length();
     }
+  }
 
-    this->schedule_state_.mutex.unlock();
+  for (size_t i = 0; i < trip_updates.size(); i++) {
+    JsonVariant update = trip_updates[i];
+    if (update.isNull()) {
+      continue;
+    }
 
-    return true;
+    Trip &trip = trips[i];
+    if (!update["routeId"].isNull() || !update["routeName"].isNull() || !update["routeColor"].isNull()) {
+      Route current_route = this->routes_[trip.route_index];
+      trip.route_index = this->intern_route_(update, &current_route);
+    }
+    if (!update["arrivalTime"].isNull()) {
+      trip.arrival_time = update["arrivalTime"].as<time_t>();
+    }
+    if (!update["departureTime"].isNull()) {
+      trip.departure_time = update["departureTime"].as<time_t>();
+    }
+    if (!update["isRealtime"].isNull()) {
+      trip.is_realtime = update["isRealtime"].as<bool>();
+    }
+  }
+
+  for (auto trip : data["add"].as<JsonArray>()) {
+    trips.emplace_back();
+    this->ingest_trip_(trip, trips.back(), next.headsigns);
+  }
+
+  bool by_departure = this->display_departure_times_;
+  std::stable_sort(trips.begin(), trips.end(), [by_departure](const Trip &a, const Trip &b) {
+    return by_departure ? a.departure_time < b.departure_time : a.arrival_time < b.arrival_time;
   });
 
-  if (!valid) {
-    this->status_set_error("Failed to parse schedule data");
-    return;
+  if (trips.size() > static_cast<size_t>(this->limit_)) {
+    trips.resize(this->limit_);
+  }
+
+  this->publish_ingested_schedule_(next);
+}
+
+void TransitTracker::reserve_ingest_budget_(Schedule &next) {
+  // The headsign budget follows recent schedules, so the arena rarely grows
+  // mid-ingest and gives memory back after an unusually large schedule.
+  size_t budget = std::max<size_t>(HEADSIGN_BUDGET_MIN, this->headsign_bytes_.empty() ? 0 : this->headsign_bytes_.max());
+  if (next.headsigns.capacity() > 2 * budget) {
+    next.headsigns.reset(budget);
+  } else {
+    next.headsigns.reserve(budget);
+  }
+
+  next.trips.reserve(this->limit_);
+}
+
+void TransitTracker::publish_schedule_(Schedule &next) {
+  // Schedules share one copy of the route table until intern_route_() changes it
+  if (this->published_routes_ == nullptr) {
+    this->published_routes_ = std::make_shared<const std::vector<Route>>(this->routes_);
   }
+  next.routes = this->published_routes_;
+
+  uint32_t publish_start = micros();
+  this->schedule_state_.publish();
+  this->lock_us_.add(micros() - publish_start);
+
+  this->redraw_requested_ = true;
 }
 
-void TransitTracker::on_ws_event_(websockets::WebsocketsEvent event, String data) {
-  if (event == websockets::WebsocketsEvent::ConnectionOpened) {
-    ESP_LOGD(TAG, "WebSocket connection opened");
+void TransitTracker::publish_ingested_schedule_(Schedule &next) {
+  this->headsign_bytes_.add(next.headsigns.size());
+  this->publish_schedule_(next);
+
+  this->showing_snapshot_ = false;
+  this->save_snapshot_();
+  this->schedule_trip_expiry_();
+}
 
-    auto message = json::build_json([this](JsonObject root) {
-      root["event"] = "schedule:subscribe";
+void TransitTracker::load_snapshot_() {
+  if (!this->persist_schedule_) {
+    return;
+  }
 
-      auto data = root.createNestedObject("data");
+  // A snapshot taken under a different configuration would show the wrong stops
+  std::string key = "transit_tracker_snapshot_v1" + this->hub_->get_base_url() + this->feed_code_ + this->schedule_string_ +
+                    this->list_mode_ + (this->rtl_mode_ ? "rtl" : "ltr");
+  this->snapshot_pref_ = global_preferences->make_preference<ScheduleSnapshot>(fnv1_hash(key), true);
 
-      if (!this->feed_code_.empty()) {
-        data["feedCode"] = this->feed_code_;
+  ScheduleSnapshot snapshot;
+  if (!this->snapshot_pref_.load(&snapshot)) {
+    return;
+  }
+
+  // Without a clock the snapshot's age is unknown; its trips are shown as
+  // stale until the time sync says whether to keep them
+  auto now = this->rtc_->now();
+  bool stale = !now.is_valid();
+  if (!stale && this->is_snapshot_too_old_(snapshot.saved_at, now.timestamp)) {
+    ESP_LOGD(TAG, "Ignoring schedule snapshot saved at %" PRId32, snapshot.saved_at);
+    return;
+  }
+
+  auto &routes = this->routes_;
+  Schedule &next = this->schedule_state_.begin();
+  size_t trip_count = std::min<size_t>(snapshot.trip_count, MAX_SNAPSHOT_TRIPS);
+
+  for (size_t i = 0; i < trip_count; i++) {
+    const SnapshotTrip &saved = snapshot.trips[i];
+
+    std::string route_name(saved.route_name, strnlen(saved.route_name, SNAPSHOT_ROUTE_NAME_SIZE));
+    Color route_color(saved.route_color);
+
+    // Restored routes have no ID; compact_routes_() drops them once unused
+    uint16_t route_index = routes.size();
+    for (size_t j = 0; j < routes.size(); j++) {
+      if (routes[j].name == route_name && routes[j].color == route_color) {
+        route_index = j;
+        break;
       }
+    }
 
-      data["routeStopPairs"] = this->schedule_string_;
-      data["limit"] = this->limit_;
-      data["sortByDeparture"] = this->display_departure_times_;
-      data["listMode"] = this->list_mode_;
-    });
+    if (route_index == routes.size()) {
+      routes.push_back(Route{"", std::move(route_name), route_color});
+      this->published_routes_.reset();
+    }
+
+    size_t headsign_length = strnlen(saved.headsign, SNAPSHOT_HEADSIGN_SIZE);
+
+    Trip trip;
+    trip.trip_key = saved.trip_key;
+    trip.headsign_offset = next.headsigns.add(saved.headsign, headsign_length);
+    trip.headsign_length = headsign_length;
+    trip.route_index = route_index;
+    trip.arrival_time = saved.arrival_time;
+    trip.departure_time = saved.departure_time;
+    trip.is_realtime = saved.is_realtime && !stale;
+    trip.is_stale = stale;
+    next.trips.push_back(trip);
+  }
+
+  size_t restored = next.trips.size();
+  this->publish_schedule_(next);
+  this->showing_snapshot_ = restored > 0;
+  this->snapshot_saved_at_ = snapshot.saved_at;
+
+  ESP_LOGD(TAG, "Restored %zu trips from schedule snapshot saved at %" PRId32, restored, snapshot.saved_at);
+}
+
+bool TransitTracker::is_snapshot_too_old_(time_t saved_at, time_t now) const {
+  // Snapshots saved before the clock was ever set have no known age
+  return saved_at == 0 || now - saved_at > SNAPSHOT_MAX_AGE;
+}
+
+void TransitTracker::check_stale_snapshot_() {
+  const Schedule &current = this->schedule_state_.published();
+  auto now = this->rtc_->now();
+  bool has_stale = std::any_of(current.trips.begin(), current.trips.end(), [](const Trip &trip) { return trip.is_stale; });
+  if (!has_stale || !now.is_valid()) {
+    return;
+  }
 
-    ESP_LOGV(TAG, "Sending message: %s", message.c_str());
-    this->ws_client_.send(message.c_str());
-  } else if (event == websockets::WebsocketsEvent::ConnectionClosed) {
-    ESP_LOGD(TAG, "WebSocket connection closed");
-    if (!this->fully_closed_ && this->connection_attempts_ == 0) {
-      this->defer([this]() {
-        this->connect_ws_();
-      });
+  Schedule &next = this->schedule_state_.begin();
+  if (this->is_snapshot_too_old_(this->snapshot_saved_at_, now.timestamp)) {
+    ESP_LOGD(TAG, "Schedule snapshot saved at %" PRId32 " is too old, dropping it", static_cast<int32_t>(this->snapshot_saved_at_));
+    this->showing_snapshot_ = false;
+  } else {
+    next.headsigns.reserve(current.headsigns.size());
+    for (const Trip &trip : current.trips) {
+      next.trips.push_back(trip);
+      next.trips.back().headsign_offset = next.headsigns.add(current.headsign(trip), trip.headsign_length);
+      next.trips.back().is_stale = false;
     }
-  } else if (event == websockets::WebsocketsEvent::GotPing) {
-    ESP_LOGV(TAG, "Received ping");
-  } else if (event == websockets::WebsocketsEvent::GotPong) {
-    ESP_LOGV(TAG, "Received pong");
   }
+  this->publish_schedule_(next);
 }
 
-void TransitTracker::connect_ws_() {
-  if (this->base_url_.empty()) {
-    ESP_LOGW(TAG, "No base URL set, not connecting");
+void TransitTracker::save_snapshot_() {
+  if (!this->persist_schedule_) {
     return;
   }
 
-  if (this->fully_closed_) {
-    ESP_LOGW(TAG, "Connection fully closed, not reconnecting");
+  // Schedules can arrive every few seconds; coalesce them into at most one
+  // flash write per interval.
+  uint32_t since_last_save = millis() - this->last_snapshot_save_;
+  if (this->has_saved_snapshot_ && since_last_save < SNAPSHOT_SAVE_INTERVAL) {
+    this->set_timeout("save_snapshot", SNAPSHOT_SAVE_INTERVAL - since_last_save, [this]() {
+      this->write_snapshot_();
+    });
     return;
   }
 
-  if (this->ws_client_.available(true)) {
-    ESP_LOGV(TAG, "Not reconnecting, already connected");
+  this->write_snapshot_();
+}
+
+// Truncates at a UTF-8 character boundary so the stored string stays valid
+static void copy_truncated(char *dest, size_t size, const char *src, size_t length) {
+  if (length >= size) {
+    length = size - 1;
+    while (length > 0 && (static_cast<uint8_t>(src[length]) & 0xC0) == 0x80) {
+      length--;
+    }
+  }
+
+  memcpy(dest, src, length);
+  dest[length] = '\0';
+}
+
+void TransitTracker::write_snapshot_() {
+  const Schedule &state = this->schedule_state_.published();
+
+  ScheduleSnapshot snapshot{};
+  auto now = this->rtc_->now();
+  snapshot.saved_at = now.is_valid() ? now.timestamp : 0;
+  snapshot.trip_count = std::min(state.trips.size(), MAX_SNAPSHOT_TRIPS);
+
+  for (size_t i = 0; i < snapshot.trip_count; i++) {
+    const Trip &trip = state.trips[i];
+    const Route &route = state.route(trip);
+    SnapshotTrip &saved = snapshot.trips[i];
+
+    saved.trip_key = trip.trip_key;
+    saved.arrival_time = trip.arrival_time;
+    saved.departure_time = trip.departure_time;
+    saved.route_color = (route.color.r << 16) | (route.color.g << 8) | route.color.b;
+    saved.is_realtime = trip.is_realtime;
+    copy_truncated(saved.route_name, SNAPSHOT_ROUTE_NAME_SIZE, route.name.data(), route.name.length());
+    copy_truncated(saved.headsign, SNAPSHOT_HEADSIGN_SIZE, state.headsign(trip), trip.headsign_length);
+  }
+
+  if (!this->snapshot_pref_.save(&snapshot)) {
+    ESP_LOGW(TAG, "Failed to save schedule snapshot");
+  }
+
+  this->has_saved_snapshot_ = true;
+  this->last_snapshot_save_ = millis();
+}
+
+size_t TransitTracker::prune_departed_trips_(time_t now) {
+  const Schedule &current = this->schedule_state_.published();
+  auto departed = [now](const Trip &trip) { return now - trip.departure_time > TRIP_EXPIRY_GRACE; };
+
+  size_t pruned = std::count_if(current.trips.begin(), current.trips.end(), departed);
+  if (pruned == 0) {
+    return 0;
+  }
+
+  Schedule &next = this->schedule_state_.begin();
+  next.headsigns.reserve(current.headsigns.size());
+  for (const Trip &trip : current.trips) {
+    if (departed(trip)) {
+      continue;
+    }
+
+    next.trips.push_back(trip);
+    next.trips.back().headsign_offset = next.headsigns.add(current.headsign(trip), trip.headsign_length);
+  }
+
+  ESP_LOGD(TAG, "Pruned %zu departed trips", pruned);
+  this->publish_schedule_(next);
+
+  return pruned;
+}
+
+void TransitTracker::schedule_trip_expiry_() {
+  const auto &trips = this->schedule_state_.published().trips;
+  if (trips.empty()) {
+    this->cancel_timeout("expire_trips");
     return;
   }
 
-  watchdog::WatchdogManager wdm(20000);
+  // Schedules hold a handful of trips, so the earliest deadline is found with
+  // a scan whenever the list changes rather than kept in a separate index.
+  uint32_t delay = TRIP_EXPIRY_MAX_DELAY;
+  auto now = this->rtc_->now();
+  if (now.is_valid()) {
+    time_t deadline = std::numeric_limits<time_t>::max();
+    for (const Trip &trip : trips) {
+      deadline = std::min<time_t>(deadline, trip.departure_time + TRIP_EXPIRY_GRACE + 1);
+    }
 
-  this->last_heartbeat_ = 0;
+    // Capped so that RTC corrections are picked up
+    time_t remaining = std::max<time_t>(0, deadline - now.timestamp);
+    delay = std::min<time_t>(remaining * 1000, TRIP_EXPIRY_MAX_DELAY);
+  }
 
-  ESP_LOGD(TAG, "Connecting to WebSocket server (attempt %d): %s", this->connection_attempts_, this->base_url_.c_str());
+  this->set_timeout("expire_trips", delay, [this]() {
+    this->expire_trips_();
+  });
+}
+
+void TransitTracker::expire_trips_() {
+  auto now = this->rtc_->now();
+  size_t pruned = now.is_valid() ? this->prune_departed_trips_(now.timestamp) : 0;
 
-  bool connection_success = false;
-  if (esphome::network::is_connected()) {
-    connection_success = this->ws_client_.connect(this->base_url_.c_str());
+  // Live schedules are normally refreshed by the server as trips depart; only
+  // ask for a new one if expiry left fewer trips than can be shown.
+  if (pruned > 0 && !this->showing_snapshot_ && this->hub_->is_connected() &&
+      this->schedule_state_.published().trips.size() < static_cast<size_t>(this->limit_)) {
+    ESP_LOGD(TAG, "Fewer than %d trips left after expiry, resubscribing", this->limit_);
+    this->send_subscribe_();
+  }
+
+  this->schedule_trip_expiry_();
+}
+
+const RouteStyleEntry *TransitTracker::find_route_style_entry_(const char *route_id) const {
+  // The generated table is sorted by route ID
+  size_t lo = 0;
+  size_t hi = this->route_style_table_size_;
+
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    int cmp = strcmp(this->route_style_table_[mid].route_id, route_id);
+    if (cmp == 0) {
+      return &this->route_style_table_[mid];
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return nullptr;
+}
+
+uint16_t TransitTracker::intern_route_(JsonVariant trip, const Route *current) {
+  auto &routes = this->routes_;
+
+  const char *route_id = trip["routeId"] | (current != nullptr ? current->id.c_str() : "");
+  // Patches may leave out fields that haven't changed
+  bool same_route = current != nullptr && current->id == route_id;
+
+  Color route_color = this->default_route_color_;
+  std::string route_name;
+  bool name_in_visual_order = false;
+
+  // Runtime overrides from set_route_styles_from_text shadow the config table
+  auto route_style = this->route_styles_.find(route_id);
+  const RouteStyleEntry *entry = nullptr;
+
+  if (route_style != this->route_styles_.end()) {
+    route_color = route_style->second.color;
+    route_name = route_style->second.name;
+  } else if ((entry = this->find_route_style_entry_(route_id)) != nullptr) {
+    route_color = *entry->color;
+    route_name = entry->name;
   } else {
-    ESP_LOGW(TAG, "Not connected to network; skipping connection attempt");
+    if (same_route && trip["routeName"].isNull()) {
+      route_name = current->name;
+      name_in_visual_order = true;
+    } else {
+      route_name = trip["routeName"].as<std::string>();
+    }
+
+    // Binary encodings send colors packed as 0xRRGGBB integers, JSON as hex strings
+    auto json_color = trip["routeColor"];
+    if (same_route && json_color.isNull()) {
+      route_color = current->color;
+    } else if (json_color.is<uint32_t>()) {
+      route_color = Color(json_color.as<uint32_t>());
+    } else if (!json_color.isNull()) {
+      const char *hex = json_color.as<const char *>();
+      uint32_t color;
+      if (hex != nullptr && parse_hex(hex, &color)) {
+        route_color = Color(color);
+      } else {
+        ESP_LOGW(TAG, "Invalid color for route %s", route_id);
+      }
+    }
   }
 
-  if (!connection_success) {
-    this->connection_attempts_++;
+  if (this->rtl_mode_ && !name_in_visual_order) {
+    route_name = bidi_visual_order(route_name, true);
+  }
 
-    if (this->connection_attempts_ >= 3) {
-      this->status_set_error("Failed to connect to WebSocket server");
+  // Published schedules hold their own copy of the table, so it is changed
+  // in place and copied again with the next schedule.
+  for (size_t i = 0; i < routes.size(); i++) {
+    Route &route = routes[i];
+    if (route.id != route_id) {
+      continue;
     }
 
-    if (this->connection_attempts_ >= 15) {
-      ESP_LOGE(TAG, "Could not connect to WebSocket server within 15 attempts.");
-      ESP_LOGE(TAG, "It's likely that the network is not truly connected; rebooting the device to try to recover.");
-      App.reboot();
+    if (route.name != route_name || route.color != route_color) {
+      route.name = std::move(route_name);
+      route.color = route_color;
+      this->published_routes_.reset();
     }
 
-    auto timeout = std::min(15000, this->connection_attempts_ * 5000);
-    ESP_LOGW(TAG, "Failed to connect, retrying in %ds", timeout / 1000);
+    return i;
+  }
 
-    this->set_timeout("reconnect", timeout, [this]() {
-      this->connect_ws_();
-    });
-  } else {
-    this->has_ever_connected_ = true;
-    this->connection_attempts_ = 0;
-    this->status_clear_error();
+  if (routes.size() >= MAX_INTERNED_ROUTES) {
+    this->compact_routes_();
+  }
+
+  routes.push_back({
+    .id = route_id,
+    .name = std::move(route_name),
+    .color = route_color,
+  });
+  this->published_routes_.reset();
+
+  return routes.size() - 1;
+}
+
+void TransitTracker::compact_routes_() {
+  // Keep only the routes referenced by the trips being ingested. The
+  // published schedule keeps the table it was published with.
+  auto &routes = this->routes_;
+  std::vector<Route> kept;
+  std::vector<int> remap(routes.size(), -1);
+
+  for (auto &trip : this->schedule_state_.pending().trips) {
+    int &index = remap[trip.route_index];
+    if (index < 0) {
+      index = kept.size();
+      kept.push_back(routes[trip.route_index]);
+    }
+    trip.route_index = index;
   }
+
+  ESP_LOGD(TAG, "Compacting route table (%zu -> %zu routes)", routes.size(), kept.size());
+
+  routes.swap(kept);
+  this->published_routes_.reset();
 }
 
 void TransitTracker::set_abbreviations_from_text(const std::string &text) {
   this->abbreviations_.clear();
-  for (const auto &line : split(text, '\n')) {
-    auto parts = split(line, ';');
 
-    if (parts.size() == 1) {
+  SplitIterator lines(text, '\n');
+  std::string_view line;
+  while (lines.next(&line)) {
+    std::string_view parts[2];
+    size_t count = split(line, ';', parts, 2);
+
+    if (count == 1) {
       // If only one part is provided, treat it as a removal (replace with empty string)
-      this->add_abbreviation(parts[0], "");
+      this->add_abbreviation(std::string(parts[0]), "");
       continue;
     }
 
-    if (parts.size() != 2) {
-      ESP_LOGW(TAG, "Invalid abbreviation line: %s", line.c_str());
+    if (count != 2) {
+      ESP_LOGW(TAG, "Invalid abbreviation line: %.*s", static_cast<int>(line.size()), line.data());
       continue;
     }
 
-    this->add_abbreviation(parts[0], parts[1]);
+    this->add_abbreviation(std::string(parts[0]), std::string(parts[1]));
   }
+
+  this->abbreviations_.compile();
+  ESP_LOGD(TAG, "Loaded %zu abbreviations", this->abbreviations_.size());
 }
 
 void TransitTracker::set_route_styles_from_text(const std::string &text) {
   this->route_styles_.clear();
-  for (const auto &line : split(text, '\n')) {
-    auto parts = split(line, ';');
-    if (parts.size() != 3) {
-      ESP_LOGW(TAG, "Invalid route style line: %s", line.c_str());
+
+  SplitIterator lines(text, '\n');
+  std::string_view line;
+  while (lines.next(&line)) {
+    std::string_view parts[3];
+    uint32_t color = 0;
+
+    if (split(line, ';', parts, 3) != 3 || !parse_hex(parts[2], &color)) {
+      ESP_LOGW(TAG, "Invalid route style line: %.*s", static_cast<int>(line.size()), line.data());
       continue;
     }
-    uint32_t color = std::stoul(parts[2], nullptr, 16);
-    this->add_route_style(parts[0], parts[1], Color(color));
+
+    this->add_route_style(std::string(parts[0]), std::string(parts[1]), Color(color));
   }
 }
 
@@ -284,10 +768,14 @@ void TransitTracker::draw_text_centered_(const char *text, Color color) {
   int display_center_y = this->display_->get_height() / 2;
   
   if (this->rtl_mode_) {
-    std::string reversed_text = reverse_string(text);
-    this->display_->print(display_center_x, display_center_y, this->font_, color, display::TextAlign::CENTER, reversed_text.c_str());
+    if (this->centered_text_logical_ != text) {
+      this->centered_text_logical_ = text;
+      this->centered_text_visual_ = bidi_visual_order(this->centered_text_logical_, true);
+    }
+
+    this->print_text_(display_center_x, display_center_y, color, display::TextAlign::CENTER, this->centered_text_visual_.c_str());
   } else {
-    this->display_->print(display_center_x, display_center_y, this->font_, color, display::TextAlign::CENTER, text);
+    this->print_text_(display_center_x, display_center_y, color, display::TextAlign::CENTER, text);
   }
 }
 
@@ -301,10 +789,9 @@ const uint8_t realtime_icon[6][6] = {
 };
 
 void HOT TransitTracker::draw_realtime_icon_(int bottom_right_x, int bottom_right_y, unsigned long uptime) {
-  const int num_frames = 6;
-  const int idle_frame_duration = 3000;
-  const int anim_frame_duration = 200;
-  const int cycle_duration = idle_frame_duration + (num_frames - 1) * anim_frame_duration;
+  const int idle_frame_duration = realtime_icon_idle_duration;
+  const int anim_frame_duration = realtime_icon_frame_duration;
+  const int cycle_duration = realtime_icon_cycle_duration;
 
   unsigned long cycle_time = uptime % cycle_duration;
 
@@ -340,86 +827,136 @@ void HOT TransitTracker::draw_realtime_icon_(int bottom_right_x, int bottom_righ
   }
 }
 
-void TransitTracker::draw_trip(
-    const Trip &trip, int y_offset, int font_height, unsigned long uptime, uint rtc_now,
-    bool no_draw, int *headsign_overflow_out, int scroll_cycle_duration
-) {
-    int route_width, _;
-    this->font_->measure(trip.route_name.c_str(), &route_width, &_, &_, &_);
+void TransitTracker::layout_trip_(const Schedule &schedule, const Trip &trip, TripLayout &layout) {
+  if (layout.route_width < 0) {
+    layout.route_width = this->measure_text_width_(schedule.route(trip).name.c_str());
+  }
 
-    auto time_display = this->localization_.fmt_duration_from_now(
-      this->display_departure_times_ ? trip.departure_time : trip.arrival_time,
-      rtc_now,
-      this->rtl_mode_
-    );
+  if (layout.headsign_width < 0) {
+    layout.headsign_width = this->measure_text_width_(schedule.headsign(trip), &layout.headsign_x_offset);
+  }
+
+  layout.time_width = this->measure_text_width_(layout.time_display);
+
+  if (this->rtl_mode_) {
+    int icon_width = trip.is_realtime ? 9 : 0;
+
+    layout.headsign_clipping_start = icon_width + 1 + layout.time_width + 2;
+    layout.headsign_clipping_end = this->display_->get_width() - layout.route_width - 3;
+    layout.icon_x = trip.is_realtime ? 6 : 0;
+  } else {
+    layout.headsign_clipping_start = layout.route_width + 3;
+    layout.headsign_clipping_end = this->display_->get_width() - layout.time_width - 2;
+    layout.icon_x = 0;
+
+    if (trip.is_realtime) {
+      layout.headsign_clipping_end -= 8;
+      layout.icon_x = this->display_->get_width() - layout.time_width - 2;
+    }
+  }
+
+  int headsign_max_width = layout.headsign_clipping_end - layout.headsign_clipping_start;
+  layout.headsign_overflow = layout.headsign_width - headsign_max_width;
+
+  // Scrolling headsigns are rasterized once so each frame is just a clipped blit
+  if (this->scroll_headsigns_ && layout.headsign_overflow > 0 && layout.headsign_sprite.empty()) {
+    int sprite_height = this->font_->get_ascender() + this->font_->get_descender();
+    if (static_cast<size_t>(layout.headsign_width * sprite_height) <= this->sprite_budget_remaining_()) {
+      this->sprite_canvas_.render(
+        layout.headsign_sprite, this->font_, schedule.headsign(trip), layout.headsign_width,
+        layout.headsign_x_offset, sprite_height
+      );
+    }
+  }
+}
+
+size_t TransitTracker::sprite_budget_remaining_() const {
+  // Headsigns over budget fall back to clipped text rendering
+  size_t used = 0;
+  for (const TripLayout &layout : this->layouts_) {
+    used += layout.headsign_sprite.size_bytes();
+  }
+
+  size_t budget = uses_psram() ? SPRITE_BUDGET_PSRAM : SPRITE_BUDGET_INTERNAL;
+  return used < budget ? budget - used : 0;
+}
+
+void TransitTracker::update_layouts_(const Schedule &schedule, uint rtc_now, bool clock_valid) {
+  auto &trips = schedule.trips;
+  auto &layouts = this->layouts_;
+
+  if (schedule.generation != this->layout_generation_ || clock_valid != this->layouts_clock_valid_) {
+    layouts.assign(trips.size(), TripLayout{});
+    this->layout_generation_ = schedule.generation;
+    this->layouts_clock_valid_ = clock_valid;
+  }
+
+  for (size_t i = 0; i < trips.size(); i++) {
+    const Trip &trip = trips[i];
+    TripLayout &layout = layouts[i];
+
+    if (layout.time_width >= 0 && rtc_now >= layout.time_display_from && rtc_now <= layout.time_display_until) {
+      continue;
+    }
+
+    char time_display[TIME_DISPLAY_SIZE];
+    time_t time = this->display_departure_times_ ? trip.departure_time : trip.arrival_time;
+    if (clock_valid) {
+      this->localization_.fmt_duration_from_now(
+        time_display, sizeof(time_display), time, rtc_now, this->rtl_mode_, &layout.time_display_until
+      );
+      layout.time_display_from = rtc_now;
+    } else {
+      this->localization_.fmt_time_of_day(time_display, sizeof(time_display), time);
+      layout.time_display_from = 0;
+      layout.time_display_until = std::numeric_limits<time_t>::max();
+    }
+
+    if (layout.time_width >= 0 && strcmp(time_display, layout.time_display) == 0) {
+      continue;
+    }
 
-    int time_width;
-    this->font_->measure(time_display.c_str(), &time_width, &_, &_, &_);
+    memcpy(layout.time_display, time_display, sizeof(time_display));
+    this->layout_trip_(schedule, trip, layout);
+  }
+}
 
-    int headsign_clipping_start, headsign_clipping_end;
+void TransitTracker::draw_trip(
+    const Schedule &schedule, const Trip &trip, const TripLayout &layout, int y_offset, int font_height, unsigned long uptime,
+    int scroll_cycle_duration
+) {
     int route_x_pos, time_x_pos;
     display::TextAlign time_align;
-    int icon_x = 0;
 
     if (this->rtl_mode_) {
       route_x_pos = this->display_->get_width() - 1;
-      
-      int icon_width = trip.is_realtime ? 9 : 0;
-      time_x_pos = icon_width + 1;
+      time_x_pos = (trip.is_realtime ? 9 : 0) + 1;
       time_align = display::TextAlign::TOP_LEFT;
-      
-      headsign_clipping_start = time_x_pos + time_width + 2;
-      headsign_clipping_end = this->display_->get_width() - route_width - 3;
-      
-      if (trip.is_realtime) {
-        icon_x = 6;
-      }
     } else {
       route_x_pos = 0;
       time_x_pos = this->display_->get_width() + 1;
       time_align = display::TextAlign::TOP_RIGHT;
-      
-      headsign_clipping_start = route_width + 3;
-      headsign_clipping_end = this->display_->get_width() - time_width - 2;
-      
-      if (trip.is_realtime) {
-        headsign_clipping_end -= 8;
-        icon_x = this->display_->get_width() - time_width - 2;
-      }
     }
 
-    if (!no_draw) {
-      this->display_->print(route_x_pos, y_offset, this->font_, trip.route_color, 
-                           this->rtl_mode_ ? display::TextAlign::TOP_RIGHT : display::TextAlign::TOP_LEFT, 
-                           trip.route_name.c_str());
+    const Route &route = schedule.route(trip);
+    this->print_text_(route_x_pos, y_offset, route.color,
+                      this->rtl_mode_ ? display::TextAlign::TOP_RIGHT : display::TextAlign::TOP_LEFT,
+                      route.name.c_str());
 
-      Color time_color = trip.is_realtime ? Color(0x20FF00) : Color(0xa7a7a7);
-      this->display_->print(time_x_pos, y_offset, this->font_, time_color, time_align, time_display.c_str());
+    Color time_color = trip.is_realtime ? Color(0x20FF00) : Color(0xa7a7a7);
+    if (trip.is_stale) {
+      time_color = Color(0x505050);
     }
+    this->print_text_(time_x_pos, y_offset, time_color, time_align, layout.time_display);
 
-    if (trip.is_realtime && !no_draw) {
+    if (trip.is_realtime) {
       int icon_bottom_right_y = y_offset + font_height - 6;
-      this->draw_realtime_icon_(icon_x, icon_bottom_right_y, uptime);
-    }
-
-    int headsign_max_width = headsign_clipping_end - headsign_clipping_start;
-
-    std::string headsign_text = trip.headsign;
-    if (this->rtl_mode_) {
-      headsign_text = reverse_string(trip.headsign);
+      this->draw_realtime_icon_(layout.icon_x, icon_bottom_right_y, uptime);
     }
 
-    int headsign_actual_width;
-    this->font_->measure(headsign_text.c_str(), &headsign_actual_width, &_, &_, &_);
-
-    int headsign_overflow = headsign_actual_width - headsign_max_width;
-    if (headsign_overflow_out) {
-      *headsign_overflow_out = headsign_overflow;
-    }
-
-    if (no_draw) {
-      return;
-    }
+    int headsign_overflow = layout.headsign_overflow;
+    int headsign_clipping_start = layout.headsign_clipping_start;
+    int headsign_clipping_end = layout.headsign_clipping_end;
 
     int scroll_offset = 0;
     if (headsign_overflow > 0 && scroll_cycle_duration > 0) {
@@ -446,67 +983,354 @@ void TransitTracker::draw_trip(
       headsign_x_pos = headsign_clipping_start - scroll_offset;
     }
 
+    if (!layout.headsign_sprite.empty()) {
+      const TextSprite &sprite = layout.headsign_sprite;
+      // Where the text path's TOP_RIGHT/TOP_LEFT print would put the first inked column
+      int sprite_x = this->rtl_mode_ ? headsign_x_pos - sprite.width : headsign_x_pos + sprite.x_offset;
+      this->sprite_canvas_.blit(this->display_, sprite, sprite_x, y_offset, headsign_clipping_start, headsign_clipping_end, display::COLOR_ON);
+      return;
+    }
+
     this->display_->start_clipping(headsign_clipping_start, 0, headsign_clipping_end, this->display_->get_height());
-    this->display_->print(headsign_x_pos, y_offset, this->font_, 
-                         this->rtl_mode_ ? display::TextAlign::TOP_RIGHT : display::TextAlign::TOP_LEFT,
-                         headsign_text.c_str());
+    this->print_text_(headsign_x_pos, y_offset, display::COLOR_ON,
+                      this->rtl_mode_ ? display::TextAlign::TOP_RIGHT : display::TextAlign::TOP_LEFT,
+                      schedule.headsign(trip));
     this->display_->end_clipping();
 }
 
-void HOT TransitTracker::draw_schedule() {
-  if (this->display_ == nullptr) {
-    ESP_LOGW(TAG, "No display attached, cannot draw schedule");
+int TransitTracker::measure_text_width_(const char *text, int *x_offset) {
+  int width, offset, _;
+  if (!this->glyph_metrics_.measure(text, &width, &offset)) {
+    this->font_->measure(text, &width, &offset, &_, &_);
+    this->render_stats_.measure_calls++;
+  }
+  if (x_offset != nullptr) {
+    *x_offset = offset;
+  }
+  return width;
+}
+
+void TransitTracker::print_text_(int x, int y, Color color, display::TextAlign align, const char *text) {
+  // Display::print() measures the text to align it; the glyph cache gives the
+  // same bounds, so the font can draw it directly.
+  int width, x_offset;
+  if (!this->glyph_metrics_.measure(text, &width, &x_offset)) {
+    // Measures the text once to place it
+    this->display_->print(x, y, this->font_, color, align, text);
+    this->render_stats_.measure_calls++;
     return;
   }
 
-  if (!esphome::network::is_connected()) {
-    this->draw_text_centered_("מחכה לחיבור לאינטרנט", Color(0x252627));
+  // Same placement as Display::get_text_bounds()
+  auto x_align = display::TextAlign(int(align) & 0x18);
+  auto y_align = display::TextAlign(int(align) & 0x07);
+
+  if (x_align == display::TextAlign::RIGHT) {
+    x -= width + x_offset;
+  } else if (x_align == display::TextAlign::CENTER_HORIZONTAL) {
+    x -= (width + x_offset) / 2;
+  }
+
+  if (y_align == display::TextAlign::BOTTOM) {
+    y -= this->font_->get_height();
+  } else if (y_align == display::TextAlign::BASELINE) {
+    y -= this->font_->get_baseline();
+  } else if (y_align == display::TextAlign::CENTER_VERTICAL) {
+    y -= this->font_->get_height() / 2;
+  }
+
+  this->font_->print(x, y, this->display_, color, text, display::COLOR_OFF);
+}
+
+void TransitTracker::log_render_stats_() {
+  if (this->render_stats_.frames == 0) {
     return;
   }
 
+  ESP_LOGV(TAG, "Render stats over %" PRIu32 " frames:", this->render_stats_.frames);
+  ESP_LOGV(TAG, "  Avg frame time: %" PRIu32 "us", this->render_stats_.total_us / this->render_stats_.frames);
+  ESP_LOGV(TAG, "  Max frame time: %" PRIu32 "us", this->render_stats_.max_us);
+  ESP_LOGV(TAG, "  Font measure calls per frame: %" PRIu32, this->render_stats_.measure_calls / this->render_stats_.frames);
+
+  this->reset_render_stats();
+}
+
+const char *TransitTracker::status_text_(Color *color) {
+  *color = Color(0x252627);
+
+  // Trips stay on screen through outages, including a snapshot restored
+  // before the clock is set
+  if (!this->schedule_state_.load()->trips.empty()) {
+    return nullptr;
+  }
+
+  if (!esphome::network::is_connected()) {
+    return "מחכה לחיבור לאינטרנט";
+  }
+
   if (!this->rtc_->now().is_valid()) {
-    this->draw_text_centered_("מחכה לסנכרון זמן", Color(0x252627));
-    return;
+    return "מחכה לסנכרון זמן";
   }
 
-  if (this->base_url_.empty()) {
-    this->draw_text_centered_("לא הוגדרה כתובת לשרת", Color(0x252627));
-    return;
+  if (this->hub_->get_base_url().empty()) {
+    return "לא הוגדרה כתובת לשרת";
+  }
+
+  if (this->status_has_error() || this->hub_->status_has_error()) {
+    *color = Color(0xFE4C5C);
+    return "שגיאה בטעינת לוח הזמנים";
+  }
+
+  if (!this->hub_->has_ever_connected()) {
+    return "טוען...";
+  }
+
+  if (this->display_departure_times_) {
+    return "אין זמני יציאה קרובים";
   }
 
-  if (this->status_has_error()) {
-    this->draw_text_centered_("שגיאה בטעינת לוח הזמנים", Color(0xFE4C5C));
+  return "אין זמני הגעה קרובים";
+}
+
+bool TransitTracker::needs_redraw() {
+  if (this->redraw_requested_) {
+    return true;
+  }
+
+  Color status_color;
+  const char *status_text = this->status_text_(&status_color);
+  if (status_text != this->last_status_text_) {
+    return true;
+  }
+
+  // Status screens are static
+  if (status_text != nullptr) {
+    return false;
+  }
+
+  if (static_cast<int32_t>(millis() - this->next_redraw_uptime_) >= 0) {
+    return true;
+  }
+
+  auto now = this->rtc_->now();
+  if (now.is_valid() != this->layouts_clock_valid_) {
+    return true;
+  }
+
+  return now.timestamp >= this->next_redraw_rtc_;
+}
+
+void TransitTracker::schedule_next_redraw_(const Schedule &schedule, unsigned long uptime, uint rtc_now, int scroll_cycle_duration) {
+  // Redraw at least once a minute even if nothing is expected to change
+  unsigned long next_uptime_delay = 60000;
+  time_t next_rtc = std::numeric_limits<time_t>::max();
+
+  bool has_realtime = false;
+
+  for (size_t i = 0; i < schedule.trips.size(); i++) {
+    const Trip &trip = schedule.trips[i];
+    const TripLayout &layout = this->layouts_[i];
+
+    has_realtime |= trip.is_realtime;
+
+    // The countdown string changes once the RTC passes its memoized window
+    if (layout.time_display_until < std::numeric_limits<time_t>::max()) {
+      next_rtc = std::min<time_t>(next_rtc, layout.time_display_until + 1);
+    }
+
+    if (layout.headsign_overflow > 0 && scroll_cycle_duration > 0) {
+      next_uptime_delay = std::min(next_uptime_delay, this->next_scroll_change_(layout.headsign_overflow, uptime, scroll_cycle_duration));
+    }
+  }
+
+  if (has_realtime) {
+    unsigned long cycle_time = uptime % realtime_icon_cycle_duration;
+    if (cycle_time < realtime_icon_idle_duration) {
+      next_uptime_delay = std::min<unsigned long>(next_uptime_delay, realtime_icon_idle_duration - cycle_time);
+    } else {
+      unsigned long frame_time = (cycle_time - realtime_icon_idle_duration) % realtime_icon_frame_duration;
+      next_uptime_delay = std::min<unsigned long>(next_uptime_delay, realtime_icon_frame_duration - frame_time);
+    }
+  }
+
+  this->next_redraw_uptime_ = uptime + next_uptime_delay;
+  this->next_redraw_rtc_ = next_rtc;
+}
+
+unsigned long TransitTracker::next_scroll_change_(int headsign_overflow, unsigned long uptime, int scroll_cycle_duration) const {
+  // Mirrors the phases in draw_trip(): idle, scroll out, idle, scroll back,
+  // then idle until the longest headsign's cycle ends.
+  const int step = std::max(1, 1000 / scroll_speed);
+  int scroll_time = headsign_overflow * 1000 / scroll_speed;
+  int t = uptime % scroll_cycle_duration;
+
+  int scroll_out_end = idle_time_left + scroll_time;
+  int scroll_back_start = scroll_out_end + idle_time_right;
+  int scroll_back_end = scroll_back_start + scroll_time;
+
+  if (t < idle_time_left) {
+    return idle_time_left - t;
+  }
+  if (t < scroll_out_end) {
+    return step - (t - idle_time_left) % step;
+  }
+  if (t < scroll_back_start) {
+    return scroll_back_start - t;
+  }
+  if (t < scroll_back_end) {
+    return step - (t - scroll_back_start) % step;
+  }
+  return scroll_cycle_duration - t;
+}
+
+void TransitTracker::log_ingest_stats_() {
+  const IngestStats &stats = this->ingest_stats_;
+  if (stats.messages == 0) {
     return;
   }
 
-  if (!this->has_ever_connected_) {
-    this->draw_text_centered_("טוען...", Color(0x252627));
+  ESP_LOGV(TAG, "Ingest stats:");
+  ESP_LOGV(TAG, "  Messages: %" PRIu32 " (%" PRIu32 " bytes, largest %" PRIu32 ")", stats.messages, stats.bytes, stats.largest_message);
+  ESP_LOGV(TAG, "  Dropped: %" PRIu32, stats.dropped);
+  ESP_LOGV(TAG, "  Reconnects: %" PRIu32, stats.reconnects);
+
+  const ConnectionStats &connection = this->hub_->get_connection_stats();
+  ESP_LOGV(TAG, "  Connection: RTT %" PRIu32 "ms (jitter %" PRIu32 "ms), heartbeat every %" PRIu32 "ms (jitter %" PRIu32 "ms)",
+           connection.rtt_ms, connection.rtt_jitter_ms, connection.heartbeat_interval_ms, connection.heartbeat_jitter_ms);
+  for (uint8_t cause = 0; cause < RECONNECT_CAUSE_COUNT; cause++) {
+    ESP_LOGV(TAG, "  Reconnects after %s: %" PRIu32, reconnect_cause_to_string(static_cast<ReconnectCause>(cause)),
+             connection.reconnects[cause]);
+  }
+  ESP_LOGV(TAG, "  Decode time: p50 %" PRIu32 "us, p90 %" PRIu32 "us, p99 %" PRIu32 "us", stats.decode_us.percentile(50),
+           stats.decode_us.percentile(90), stats.decode_us.percentile(99));
+
+  const MemoryStats &memory = get_memory_stats();
+  ESP_LOGV(TAG, "  Memory: %s placement, largest free internal block %zu bytes, %" PRIu32 " PSRAM fallbacks, %" PRIu32 " failed allocations",
+           uses_psram() ? "PSRAM" : "internal", get_largest_free_internal_block(), memory.psram_fallbacks.load(), memory.failures.load());
+}
+
+bool TransitTracker::has_telemetry_() const {
+  bool has_telemetry = false;
+#ifdef USE_SENSOR
+  has_telemetry |= this->render_time_sensor_ != nullptr || this->parse_time_sensor_ != nullptr ||
+                   this->lock_time_sensor_ != nullptr || this->message_size_sensor_ != nullptr ||
+                   this->heap_min_free_sensor_ != nullptr || this->largest_free_block_sensor_ != nullptr ||
+                   this->alloc_failures_sensor_ != nullptr || this->connection_rtt_sensor_ != nullptr;
+#endif
+#ifdef USE_TEXT_SENSOR
+  has_telemetry |= this->telemetry_summary_text_sensor_ != nullptr;
+#endif
+  return has_telemetry;
+}
+
+void TransitTracker::publish_telemetry_() {
+  // Timings are published as the p99 of the most recent samples, in milliseconds
+  auto p99_ms = [](const SampleWindow &window) { return window.percentile(99) / 1000.0f; };
+
+#ifdef USE_SENSOR
+  if (this->render_time_sensor_ != nullptr && !this->frame_us_.empty()) {
+    this->render_time_sensor_->publish_state(p99_ms(this->frame_us_));
+  }
+
+  if (this->parse_time_sensor_ != nullptr && !this->ingest_stats_.decode_us.empty()) {
+    this->parse_time_sensor_->publish_state(p99_ms(this->ingest_stats_.decode_us));
+  }
+
+  if (this->lock_time_sensor_ != nullptr && !this->lock_us_.empty()) {
+    this->lock_time_sensor_->publish_state(p99_ms(this->lock_us_));
+  }
+
+  if (this->message_size_sensor_ != nullptr && !this->message_bytes_.empty()) {
+    this->message_size_sensor_->publish_state(this->message_bytes_.max());
+  }
+
+  if (this->heap_min_free_sensor_ != nullptr) {
+#ifdef USE_ESP32
+    this->heap_min_free_sensor_->publish_state(heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+#endif
+  }
+
+  if (this->largest_free_block_sensor_ != nullptr) {
+#ifdef USE_ESP32
+    this->largest_free_block_sensor_->publish_state(get_largest_free_internal_block());
+#endif
+  }
+
+  if (this->alloc_failures_sensor_ != nullptr) {
+    this->alloc_failures_sensor_->publish_state(get_memory_stats().failures.load());
+  }
+
+  const ConnectionStats &connection = this->hub_->get_connection_stats();
+  if (this->connection_rtt_sensor_ != nullptr && connection.rtt_ms > 0) {
+    this->connection_rtt_sensor_->publish_state(connection.rtt_ms);
+  }
+#endif
+
+#ifdef USE_TEXT_SENSOR
+  if (this->telemetry_summary_text_sensor_ != nullptr) {
+    auto summarize = [](const char *name, const SampleWindow &window) {
+      return str_sprintf(
+        "%s %.2f/%.2f/%.2f", name, window.min() / 1000.0f, window.average() / 1000.0f, window.percentile(99) / 1000.0f
+      );
+    };
+
+    const ConnectionStats &connection = this->hub_->get_connection_stats();
+    this->telemetry_summary_text_sensor_->publish_state(
+      summarize("render", this->frame_us_) + "; " + summarize("parse", this->ingest_stats_.decode_us) + "; " +
+      summarize("lock", this->lock_us_) + " (ms min/avg/p99); " +
+      str_sprintf("rtt %" PRIu32 "±%" PRIu32 "ms; reconnects %" PRIu32 " heartbeat/%" PRIu32 " ping/%" PRIu32 " closed/%" PRIu32 " requested",
+                  connection.rtt_ms, connection.rtt_jitter_ms, connection.reconnects[RECONNECT_HEARTBEAT_TIMEOUT],
+                  connection.reconnects[RECONNECT_PING_TIMEOUT], connection.reconnects[RECONNECT_CONNECTION_CLOSED],
+                  connection.reconnects[RECONNECT_REQUESTED])
+    );
+  }
+#endif
+}
+
+void HOT TransitTracker::draw_schedule() {
+  uint32_t frame_start = micros();
+
+  this->draw_schedule_();
+
+  uint32_t frame_time = micros() - frame_start;
+  this->frame_us_.add(frame_time);
+  this->render_stats_.frames++;
+  this->render_stats_.total_us += frame_time;
+  this->render_stats_.max_us = std::max(this->render_stats_.max_us, frame_time);
+}
+
+void HOT TransitTracker::draw_schedule_() {
+  if (this->display_ == nullptr) {
+    ESP_LOGW(TAG, "No display attached, cannot draw schedule");
     return;
   }
 
-  if (this->schedule_state_.trips.empty()) {
-    auto message = "אין זמני הגעה קרובים";
-    if (this->display_departure_times_) {
-      message = "אין זמני יציאה קרובים";
-    }
+  Color status_color;
+  const char *status_text = this->status_text_(&status_color);
+  this->last_status_text_ = status_text;
+  this->redraw_requested_ = false;
 
-    this->draw_text_centered_(message, Color(0x252627));
+  if (status_text != nullptr) {
+    this->draw_text_centered_(status_text, status_color);
     return;
   }
 
-  this->schedule_state_.mutex.lock();
+  // Ingest may publish a newer schedule mid-frame; this one stays valid for
+  // as long as the reference is held.
+  std::shared_ptr<const Schedule> schedule = this->schedule_state_.load();
 
   int nominal_font_height = this->font_->get_ascender() + this->font_->get_descender();
   unsigned long uptime = millis();
-  uint rtc_now = this->rtc_->now().timestamp;
+  auto now = this->rtc_->now();
+  uint rtc_now = now.timestamp;
+
+  this->update_layouts_(*schedule, rtc_now, now.is_valid());
 
   int scroll_cycle_duration = 0;
   if (this->scroll_headsigns_) {
     int largest_headsign_overflow = 0;
-    for (const Trip &trip : this->schedule_state_.trips) {
-      int headsign_overflow;
-      this->draw_trip(trip, 0, nominal_font_height, uptime, rtc_now, true, &headsign_overflow);
-      largest_headsign_overflow = max(largest_headsign_overflow, headsign_overflow);
+    for (const TripLayout &layout : this->layouts_) {
+      largest_headsign_overflow = max(largest_headsign_overflow, layout.headsign_overflow);
     }
 
     if (largest_headsign_overflow > 0) {
@@ -518,12 +1342,14 @@ void HOT TransitTracker::draw_schedule() {
   int max_trips_height = (this->limit_ * this->font_->get_ascender()) + ((this->limit_ - 1) * this->font_->get_descender());
   int y_offset = (this->display_->get_height() % max_trips_height) / 2;
 
-  for (const Trip &trip : this->schedule_state_.trips) {
-    this->draw_trip(trip, y_offset, nominal_font_height, uptime, rtc_now, false, nullptr, scroll_cycle_duration);
+  for (size_t i = 0; i < schedule->trips.size(); i++) {
+    this->draw_trip(
+      *schedule, schedule->trips[i], this->layouts_[i], y_offset, nominal_font_height, uptime, scroll_cycle_duration
+    );
     y_offset += nominal_font_height;
   }
 
-  this->schedule_state_.mutex.unlock();
+  this->schedule_next_redraw_(*schedule, uptime, rtc_now, scroll_cycle_duration);
 }
 
 }  // namespace transit_tracker
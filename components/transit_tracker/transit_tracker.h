@@ -1,38 +1,104 @@
 #pragma once
 
+#include <atomic>
 #include <map>
-#include <ArduinoWebsockets.h>
 
 #include "esphome/core/component.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/display/display.h"
 #include "esphome/components/font/font.h"
+#include "esphome/components/json/json_util.h"
 #include "esphome/components/time/real_time_clock.h"
 
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+#ifdef USE_TEXT_SENSOR
+#include "esphome/components/text_sensor/text_sensor.h"
+#endif
+
+#include "connection_hub.h"
 #include "schedule_state.h"
+#include "abbreviations.h"
+#include "glyph_metrics.h"
+#include "sample_window.h"
 #include "localization.h"
 
 namespace esphome {
 namespace transit_tracker {
 
+enum MessageEncoding : uint8_t {
+  MESSAGE_ENCODING_JSON,
+  MESSAGE_ENCODING_MSGPACK,
+};
+
 struct RouteStyle {
   std::string name;
   Color color;
 };
 
+// Generated at compile time from the YAML config, sorted by route_id (byte
+// order) and kept in flash
+struct RouteStyleEntry {
+  const char *route_id;
+  const char *name;
+  const Color *color;
+};
+
+struct RenderStats {
+  uint32_t frames = 0;
+  uint32_t total_us = 0;
+  uint32_t max_us = 0;
+  // Font::measure() calls the glyph metrics cache could not answer
+  uint32_t measure_calls = 0;
+};
+
+// Cumulative since boot, except decode_us which holds the most recent messages
+struct IngestStats {
+  uint32_t messages = 0;
+  uint32_t bytes = 0;
+  uint32_t largest_message = 0;
+  uint32_t dropped = 0;
+  uint32_t reconnects = 0;
+  SampleWindow decode_us;
+};
+
 class TransitTracker : public Component {
   public:
     void setup() override;
-    void loop() override;
     void dump_config() override;
     void on_shutdown() override;
 
-    float get_setup_priority() const override { return setup_priority::AFTER_WIFI; }
+    // Set up ahead of Wi-Fi so the persisted schedule is on screen while it connects
+    float get_setup_priority() const override { return setup_priority::WIFI + 1.0f; }
+
+    void set_hub(ConnectionHub *hub);
 
     void reconnect();
     void close(bool fully = false);
 
+    // Called by the hub
+    void on_hub_connected(bool reconnected);
+    void on_hub_message(const char *event, JsonObject data, size_t length, uint32_t decode_us);
+    void on_hub_message_dropped(size_t length);
+    // For the hub's polling fallback: the subscription as URL query parameters,
+    // and how long the current schedule can go without a refresh
+    std::string get_schedule_query() const;
+    uint32_t get_poll_interval() const;
+
     void draw_schedule();
 
+    // Change-driven rendering: when the display's update_interval is set to
+    // `never`, poll needs_redraw() and only update the display when it returns
+    // true. The next draw would otherwise produce the same pixels as the last.
+    bool needs_redraw();
+    void request_redraw() { this->redraw_requested_ = true; }
+    unsigned long get_next_redraw_uptime() const { return this->next_redraw_uptime_; }
+
+    const RenderStats &get_render_stats() const { return this->render_stats_; }
+    void reset_render_stats() { this->render_stats_ = RenderStats{}; }
+    const IngestStats &get_ingest_stats() const { return this->ingest_stats_; }
+
     Localization* get_localization() { return &this->localization_; }
     bool is_rtl_mode() const { return this->rtl_mode_; }
 
@@ -40,7 +106,6 @@ class TransitTracker : public Component {
     void set_font(font::Font *font) { font_ = font; }
     void set_rtc(time::RealTimeClock *rtc) { rtc_ = rtc; }
 
-    void set_base_url(const std::string &base_url) { base_url_ = base_url; }
     void set_feed_code(const std::string &feed_code) { feed_code_ = feed_code; }
     void set_display_departure_times(bool display_departure_times) { display_departure_times_ = display_departure_times; }
     void set_schedule_string(const std::string &schedule_string) { schedule_string_ = schedule_string; }
@@ -48,12 +113,36 @@ class TransitTracker : public Component {
     void set_limit(int limit) { limit_ = limit; }
     void set_scroll_headsigns(bool scroll_headsigns) { scroll_headsigns_ = scroll_headsigns; }
     void set_rtl_mode(bool rtl_mode) { rtl_mode_ = rtl_mode; }
+    void set_schedule_patches(bool schedule_patches) { schedule_patches_ = schedule_patches; }
+    void set_message_encoding(MessageEncoding message_encoding) { message_encoding_ = message_encoding; }
+    void set_persist_schedule(bool persist_schedule) { persist_schedule_ = persist_schedule; }
+    void set_memory_placement(MemoryPlacement placement) { transit_tracker::set_memory_placement(placement); }
 
     void set_unit_display(UnitDisplay unit_display) { this->localization_.set_unit_display(unit_display); }
-    void add_abbreviation(const std::string &from, const std::string &to) { abbreviations_[from] = to; }
+    void set_abbreviation_table(const AbbreviationEntry *table, size_t size) { abbreviations_.set_table(table, size); }
+    void add_abbreviation(const std::string &from, const std::string &to) { abbreviations_.add(from, to); }
     void set_default_route_color(const Color &color) { default_route_color_ = color; }
+    void set_route_style_table(const RouteStyleEntry *table, size_t size) {
+      route_style_table_ = table;
+      route_style_table_size_ = size;
+    }
     void add_route_style(const std::string &route_id, const std::string &name, const Color &color) { route_styles_[route_id] = RouteStyle{name, color}; }
 
+    void set_telemetry_interval(uint32_t telemetry_interval) { telemetry_interval_ = telemetry_interval; }
+#ifdef USE_SENSOR
+    void set_render_time_sensor(sensor::Sensor *sensor) { render_time_sensor_ = sensor; }
+    void set_parse_time_sensor(sensor::Sensor *sensor) { parse_time_sensor_ = sensor; }
+    void set_lock_time_sensor(sensor::Sensor *sensor) { lock_time_sensor_ = sensor; }
+    void set_message_size_sensor(sensor::Sensor *sensor) { message_size_sensor_ = sensor; }
+    void set_heap_min_free_sensor(sensor::Sensor *sensor) { heap_min_free_sensor_ = sensor; }
+    void set_largest_free_block_sensor(sensor::Sensor *sensor) { largest_free_block_sensor_ = sensor; }
+    void set_alloc_failures_sensor(sensor::Sensor *sensor) { alloc_failures_sensor_ = sensor; }
+    void set_connection_rtt_sensor(sensor::Sensor *sensor) { connection_rtt_sensor_ = sensor; }
+#endif
+#ifdef USE_TEXT_SENSOR
+    void set_telemetry_summary_text_sensor(text_sensor::TextSensor *text_sensor) { telemetry_summary_text_sensor_ = text_sensor; }
+#endif
+
     void set_abbreviations_from_text(const std::string &text);
     void set_route_styles_from_text(const std::string &text);
 
@@ -61,43 +150,144 @@ class TransitTracker : public Component {
     static constexpr int scroll_speed = 10; // pixels/second
     static constexpr int idle_time_left = 5000;
     static constexpr int idle_time_right = 1000;
+    static constexpr size_t MAX_INTERNED_ROUTES = 128;
+    // Bytes across all cached headsign sprites
+    static constexpr size_t SPRITE_BUDGET_INTERNAL = 16384;
+    static constexpr size_t SPRITE_BUDGET_PSRAM = 131072;
+    // Lower bound for the adaptive headsign arena budget
+    static constexpr size_t HEADSIGN_BUDGET_MIN = 256;
+    static constexpr uint32_t SNAPSHOT_SAVE_INTERVAL = 10 * 60 * 1000;
+    // Seconds after which a restored snapshot is no longer worth showing
+    static constexpr time_t SNAPSHOT_MAX_AGE = 2 * 60 * 60;
+    // Seconds after departure that a trip stays on screen
+    static constexpr time_t TRIP_EXPIRY_GRACE = 60;
+    static constexpr uint32_t TRIP_EXPIRY_MAX_DELAY = 60000;
+    static constexpr uint32_t POLL_INTERVAL_MIN = 15000;
+    static constexpr uint32_t POLL_INTERVAL_MAX = 60000;
+    static constexpr int realtime_icon_idle_duration = 3000;
+    static constexpr int realtime_icon_frame_duration = 200;
+    static constexpr int realtime_icon_cycle_duration = realtime_icon_idle_duration + 5 * realtime_icon_frame_duration;
 
     std::string from_now_(time_t unix_timestamp, uint rtc_now) const;
+    void draw_schedule_();
+    const char *status_text_(Color *color);
+    void schedule_next_redraw_(const Schedule &schedule, unsigned long uptime, uint rtc_now, int scroll_cycle_duration);
+    unsigned long next_scroll_change_(int headsign_overflow, unsigned long uptime, int scroll_cycle_duration) const;
+    int measure_text_width_(const char *text, int *x_offset = nullptr);
+    void print_text_(int x, int y, Color color, display::TextAlign align, const char *text);
+    void log_render_stats_();
+    void log_ingest_stats_();
+    bool has_telemetry_() const;
+    void publish_telemetry_();
     void draw_text_centered_(const char *text, Color color);
     void draw_realtime_icon_(int bottom_right_x, int bottom_right_y, unsigned long now);
 
+    void layout_trip_(const Schedule &schedule, const Trip &trip, TripLayout &layout);
+    size_t sprite_budget_remaining_() const;
+    void update_layouts_(const Schedule &schedule, uint rtc_now, bool clock_valid);
+
     void draw_trip(
-      const Trip &trip, int y_offset, int font_height, unsigned long uptime, uint rtc_now,
-      bool no_draw = false, int *headsign_overflow_out = nullptr, int scroll_cycle_duration = 0
+      const Schedule &schedule, const Trip &trip, const TripLayout &layout, int y_offset, int font_height, unsigned long uptime,
+      int scroll_cycle_duration = 0
     );
 
+    const char *last_status_text_ = nullptr;
+    // Set by ingest, which may run on another task than the renderer
+    std::atomic<bool> redraw_requested_{true};
+    unsigned long next_redraw_uptime_ = 0;
+    time_t next_redraw_rtc_ = 0;
+
+    std::string centered_text_logical_;
+    std::string centered_text_visual_;
+
     Localization localization_{};
     ScheduleState schedule_state_;
+    // Interned across schedule updates; only the ingest path touches it
+    std::vector<Route> routes_;
+    // Copy of routes_ shared by published schedules, reset when routes_ changes
+    std::shared_ptr<const std::vector<Route>> published_routes_;
+    // Render side, for the schedule generation they were built from
+    std::vector<TripLayout> layouts_;
+    uint32_t layout_generation_ = 0;
+    // Without a valid clock, layouts show scheduled times rather than countdowns
+    bool layouts_clock_valid_ = false;
+    RenderStats render_stats_{};
+    IngestStats ingest_stats_{};
+
+    // Telemetry windows, independent of the periodically reset stats above
+    SampleWindow frame_us_;
+    // Time taken to publish a schedule to the renderer
+    SampleWindow lock_us_;
+    SampleWindow message_bytes_;
+    SampleWindow headsign_bytes_;
+    uint32_t telemetry_interval_ = 60000;
+#ifdef USE_SENSOR
+    sensor::Sensor *render_time_sensor_{nullptr};
+    sensor::Sensor *parse_time_sensor_{nullptr};
+    sensor::Sensor *lock_time_sensor_{nullptr};
+    sensor::Sensor *message_size_sensor_{nullptr};
+    sensor::Sensor *heap_min_free_sensor_{nullptr};
+    sensor::Sensor *largest_free_block_sensor_{nullptr};
+    sensor::Sensor *alloc_failures_sensor_{nullptr};
+    sensor::Sensor *connection_rtt_sensor_{nullptr};
+#endif
+#ifdef USE_TEXT_SENSOR
+    text_sensor::TextSensor *telemetry_summary_text_sensor_{nullptr};
+#endif
+    SpriteCanvas sprite_canvas_{};
+    GlyphMetrics glyph_metrics_{};
 
     display::Display *display_;
     font::Font *font_;
     time::RealTimeClock *rtc_;
 
-    websockets::WebsocketsClient ws_client_{};
+    ConnectionHub *hub_;
+    uint32_t subscription_id_ = 0;
 
-    void on_ws_message_(websockets::WebsocketsMessage message);
-    void on_ws_event_(websockets::WebsocketsEvent event, String data);
-    void connect_ws_();
-    int connection_attempts_ = 0;
-    unsigned long last_heartbeat_ = 0;
-    bool has_ever_connected_ = false;
-    bool fully_closed_ = false;
+    void send_subscribe_();
+    void ingest_schedule_(JsonObject data);
+    void ingest_trip_(JsonVariant json, Trip &trip, StringArena &headsigns);
+    void apply_schedule_patch_(JsonObject data);
+    void reserve_ingest_budget_(Schedule &next);
+    void publish_schedule_(Schedule &next);
+    void publish_ingested_schedule_(Schedule &next);
+    const RouteStyleEntry *find_route_style_entry_(const char *route_id) const;
+    // Fields of the same route that `trip` leaves out are kept from `current`
+    uint16_t intern_route_(JsonVariant trip, const Route *current = nullptr);
+    void compact_routes_();
+    void load_snapshot_();
+    void save_snapshot_();
+    void write_snapshot_();
+    bool is_snapshot_too_old_(time_t saved_at, time_t now) const;
+    // Once the clock is set, drops a stale snapshot that is too old or keeps it as current
+    void check_stale_snapshot_();
+    size_t prune_departed_trips_(time_t now);
+    void schedule_trip_expiry_();
+    void expire_trips_();
+    bool schedule_patches_ = false;
+    MessageEncoding message_encoding_ = MESSAGE_ENCODING_JSON;
+    bool has_schedule_seq_ = false;
+    uint32_t schedule_seq_ = 0;
+    bool persist_schedule_ = true;
+    ESPPreferenceObject snapshot_pref_;
+    bool has_saved_snapshot_ = false;
+    uint32_t last_snapshot_save_ = 0;
+    // Cleared once the server sends a schedule
+    bool showing_snapshot_ = false;
+    time_t snapshot_saved_at_ = 0;
 
-    std::string base_url_;
     std::string feed_code_;
     std::string schedule_string_;
     std::string list_mode_;
     bool display_departure_times_ = true;
     int limit_;
 
-    std::map<std::string, std::string> abbreviations_;
+    AbbreviationMatcher abbreviations_;
     Color default_route_color_ = Color(0x028e51);
-    std::map<std::string, RouteStyle> route_styles_;
+    const RouteStyleEntry *route_style_table_ = nullptr;
+    size_t route_style_table_size_ = 0;
+    // Runtime overrides; transparent comparator to look up by const char *
+    std::map<std::string, RouteStyle, std::less<>> route_styles_;
     bool scroll_headsigns_ = false;
     bool rtl_mode_ = false;
 };
@@ -0,0 +1,43 @@
+// Bytes on the wire and decode time for the same trace sent as JSON and as
+// MessagePack, replayed through the mock server and the hub's decoder.
+//
+//   encoding_bench [--quick]
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+#include "replay.h"
+
+using namespace host;
+
+int main(int argc, char **argv) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+
+  SynthesizeOptions synthesize;
+  synthesize.duration_ms = quick ? 5 * 60 * 1000 : 30 * 60 * 1000;
+  synthesize.trips = 12;
+
+  ReplayOptions options;
+  options.limit = 12;
+
+  printf("%-12s %8s %10s %10s %24s\n", "encoding", "messages", "bytes", "bytes/msg", "decode us p50/p90/p99/max");
+
+  bool healthy = true;
+  uint32_t bytes[2] = {0, 0};
+  for (bool msgpack : {false, true}) {
+    synthesize.msgpack = msgpack;
+    ReplayReport report = run_replay(synthesize_trace(synthesize), options);
+    bytes[msgpack] = report.bytes;
+
+    char decode[32];
+    snprintf(decode, sizeof(decode), "%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32, report.decode_us.p50,
+             report.decode_us.p90, report.decode_us.p99, report.decode_us.max);
+    printf("%-12s %8" PRIu32 " %10" PRIu32 " %10" PRIu32 " %24s\n", msgpack ? "MessagePack" : "JSON", report.ingested,
+           report.bytes, report.ingested > 0 ? report.bytes / report.ingested : 0, decode);
+    healthy &= !report.rebooted && report.ingested > 0 && report.dropped == 0 && report.lost == 0;
+  }
+
+  printf("MessagePack is %.0f%% of the JSON size\n", bytes[0] > 0 ? 100.0 * bytes[1] / bytes[0] : 0.0);
+  return healthy && bytes[1] < bytes[0] ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+// Frame timing with schedules decoded in loop() against on the hub's network
+// task, which FreeRTOS runs on the other core and the host on a std::thread.
+// Large schedules are replayed through the mock server while frames are drawn
+// on the main loop, and the lateness of each frame is measured in real time.
+//
+//   network_task_bench [--quick]
+
+#include <cstdio>
+#include <cstring>
+
+#include "replay.h"
+
+using namespace host;
+
+int main(int argc, char **argv) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+
+  SynthesizeOptions synthesize;
+  synthesize.duration_ms = quick ? 60000 : 600000;
+  // Large messages every few seconds, to give the main loop something to
+  // stall on
+  synthesize.schedule_interval_ms = 3000;
+  synthesize.trips = 12;
+  synthesize.long_headsigns = true;
+  Trace trace = synthesize_trace(synthesize);
+
+  ReplayOptions options;
+  options.speed = quick ? 50.0 : 10.0;
+  options.limit = 12;
+  options.drain_ms = 2000;
+
+  printf("%-12s %-8s %12s %12s %12s %12s %12s\n", "decode on", "scenario", "late p50 us", "late p99 us",
+         "late max us", "loop max us", "decode p99 us");
+
+  bool healthy = true;
+  for (ReplayScenario scenario : {SCENARIO_STEADY, SCENARIO_BURST}) {
+    for (bool network_task : {false, true}) {
+      options.scenario = scenario;
+      options.network_task = network_task;
+      ReplayReport report = run_replay(trace, options);
+      printf("%-12s %-8s %12u %12u %12u %12u %12u\n", network_task ? "task" : "loop()", report.scenario.c_str(),
+             report.frame_late_us.p50, report.frame_late_us.p99, report.frame_late_us.max, report.max_loop_us,
+             report.decode_us.p99);
+      healthy &= !report.rebooted && report.ingested > 0 && report.lost == 0;
+    }
+  }
+
+  return healthy ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Frame rendering cost across text directions, headsign scrolling and
+// schedule sizes: wall time, Font::measure/print calls, heap allocations and
+// pixel writes per frame.
+//
+//   render_bench [--quick] [--frames N]
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "host/clock.h"
+#include "host/heap.h"
+#include "host/runtime.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+using namespace host;
+
+namespace {
+
+struct Scenario {
+  bool rtl;
+  bool scroll;
+  int limit;
+  // Headsigns with a glyph the font lacks, which the metrics cache can't
+  // measure
+  bool missing_glyphs = false;
+};
+
+struct Result {
+  double ns_per_frame;
+  double measure_calls;
+  // What the tracker reports as measure calls; should match the font's count
+  double counted_measure_calls;
+  double print_calls;
+  double allocations;
+  double pixel_writes;
+};
+
+// One frame every 16 ms of device time, so scrolling headsigns move
+const uint32_t FRAME_INTERVAL_MS = 16;
+
+Result run(const Scenario &scenario, int frames) {
+  TrackerOptions options;
+  options.rtl = scenario.rtl;
+  options.scroll_headsigns = scenario.scroll;
+  options.limit = scenario.limit;
+  options.height = std::max(32, scenario.limit * 10);
+
+  TrackerFixture fixture(options);
+  fixture.setup();
+
+  ScheduleOptions schedule;
+  schedule.trips = scenario.limit;
+  schedule.rtl = scenario.rtl;
+  schedule.long_headsigns = scenario.scroll;
+  schedule.now = options.now;
+  std::string message = make_schedule_message(schedule);
+  if (scenario.missing_glyphs) {
+    for (size_t pos = 0; (pos = message.find("\"headsign\":\"", pos)) != std::string::npos; pos++) {
+      message.insert(pos + 12, "\u2192 ");
+    }
+  }
+  fixture.deliver(message);
+
+  // Warm caches, sprites and layouts before measuring
+  for (int i = 0; i < 8; i++) {
+    advance_clock(FRAME_INTERVAL_MS);
+    fixture.draw();
+  }
+
+  fixture.font.get()->host_reset_counters();
+  fixture.tracker.reset_render_stats();
+  fixture.display.reset_pixel_writes();
+  HeapCounters heap_before = heap_counters();
+  uint64_t elapsed_us = 0;
+
+  for (int i = 0; i < frames; i++) {
+    advance_clock(FRAME_INTERVAL_MS);
+    uint64_t start = real_micros();
+    fixture.draw();
+    elapsed_us += real_micros() - start;
+  }
+
+  HeapCounters heap_after = heap_counters();
+  esphome::font::Font *font = fixture.font.get();
+
+  return Result{
+      .ns_per_frame = elapsed_us * 1000.0 / frames,
+      .measure_calls = double(font->host_measure_calls()) / frames,
+      .counted_measure_calls = double(fixture.tracker.get_render_stats().measure_calls) / frames,
+      .print_calls = double(font->host_print_calls()) / frames,
+      .allocations = double(heap_after.allocations - heap_before.allocations) / frames,
+      // Less the clear before each frame
+      .pixel_writes = double(fixture.display.pixel_writes()) / frames - options.width * options.height,
+  };
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int frames = 2000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--quick") == 0) {
+      frames = 50;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      frames = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [--quick] [--frames N]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  use_manual_clock();
+  // The font warns about every glyph it lacks
+  set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+
+  if (!heap_counting_enabled()) {
+    printf("(heap counting disabled under sanitizers)\n");
+  }
+
+  printf("%-4s %-6s %5s %12s %10s %10s %10s %12s\n", "dir", "scroll", "limit", "ns/frame", "measure", "print",
+         "allocs", "pixels");
+
+  bool all_drawn = true;
+  bool counts_match = true;
+  std::vector<Scenario> scenarios;
+  for (bool rtl : {false, true}) {
+    for (bool scroll : {false, true}) {
+      for (int limit : {3, 6, 12}) {
+        scenarios.push_back({rtl, scroll, limit});
+      }
+    }
+  }
+  scenarios.push_back({false, false, 3, true});
+
+  for (const Scenario &scenario : scenarios) {
+    Result result = run(scenario, frames);
+    printf("%-4s %-6s %5d %12.0f %10.2f %10.2f %10.2f %12.0f%s\n", scenario.rtl ? "rtl" : "ltr",
+           scenario.scroll ? "on" : "off", scenario.limit, result.ns_per_frame, result.measure_calls,
+           result.print_calls, result.allocations, result.pixel_writes,
+           scenario.missing_glyphs ? "  (missing glyphs)" : "");
+    all_drawn &= result.pixel_writes > 0;
+    if (result.counted_measure_calls != result.measure_calls) {
+      fprintf(stderr, "Render stats count %.2f measure calls per frame, the font %.2f\n",
+              result.counted_measure_calls, result.measure_calls);
+      counts_match = false;
+    }
+  }
+
+  if (!all_drawn) {
+    fprintf(stderr, "A scenario drew nothing\n");
+    return EXIT_FAILURE;
+  }
+  return counts_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,112 @@
+// Loading abbreviation and route style lists the size Home Assistant text
+// entities allow, against the stringstream splitting they replaced.
+//
+//   string_utils_bench [--quick]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "host/clock.h"
+#include "host/heap.h"
+#include "string_utils.h"
+#include "transit_tracker.h"
+
+using esphome::transit_tracker::TransitTracker;
+
+namespace {
+
+// What split() did before: a vector of copies through a stringstream
+std::vector<std::string> stringstream_split(const std::string &text, char delim) {
+  std::vector<std::string> fields;
+  std::stringstream stream(text);
+  std::string field;
+  while (std::getline(stream, field, delim)) {
+    fields.push_back(field);
+  }
+  return fields;
+}
+
+std::string make_abbreviations(int lines) {
+  std::string text;
+  for (int i = 0; i < lines; i++) {
+    text += "Station Number " + std::to_string(i) + ";Stn " + std::to_string(i) + "\n";
+  }
+  return text;
+}
+
+std::string make_route_styles(int lines) {
+  std::string text;
+  char line[64];
+  for (int i = 0; i < lines; i++) {
+    snprintf(line, sizeof(line), "route-%d;R%d;%06X\n", i, i, (i * 0x10101) & 0xFFFFFF);
+    text += line;
+  }
+  return text;
+}
+
+template<typename F> void measure(const char *name, int iterations, F &&body) {
+  host::HeapCounters before = host::heap_counters();
+  uint64_t start = host::real_micros();
+  for (int i = 0; i < iterations; i++) {
+    body();
+  }
+  uint64_t elapsed = host::real_micros() - start;
+  host::HeapCounters after = host::heap_counters();
+
+  printf("%-36s %12.0f ns/op %10.1f allocs/op\n", name, elapsed * 1000.0 / iterations,
+         double(after.allocations - before.allocations) / iterations);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  int iterations = argc > 1 && strcmp(argv[1], "--quick") == 0 ? 20 : 2000;
+
+  // Text entities hold at most 255 characters each, but lists are often
+  // concatenated from several in a template
+  const std::string abbreviations = make_abbreviations(200);
+  const std::string route_styles = make_route_styles(200);
+  size_t sink = 0;
+
+  measure("split lines (stringstream)", iterations, [&] {
+    for (const std::string &line : stringstream_split(abbreviations, '\n')) {
+      sink += stringstream_split(line, ';').size();
+    }
+  });
+
+  measure("split lines (SplitIterator)", iterations, [&] {
+    SplitIterator lines(abbreviations, '\n');
+    std::string_view line;
+    while (lines.next(&line)) {
+      std::string_view parts[2];
+      sink += split(line, ';', parts, 2);
+    }
+  });
+
+  host::HeapCounters before = host::heap_counters();
+  SplitIterator lines(abbreviations, '\n');
+  std::string_view line;
+  while (lines.next(&line)) {
+    std::string_view parts[2];
+    sink += split(line, ';', parts, 2);
+  }
+  bool split_allocated = host::heap_counters().allocations != before.allocations;
+
+  TransitTracker tracker;
+  measure("set_abbreviations_from_text", iterations, [&] { tracker.set_abbreviations_from_text(abbreviations); });
+  measure("set_route_styles_from_text", iterations, [&] { tracker.set_route_styles_from_text(route_styles); });
+  measure("url_encode", iterations * 10, [&] { sink += url_encode("1_100;1_200,40_990005").size(); });
+
+  if (sink == 0) {
+    return EXIT_FAILURE;
+  }
+  if (split_allocated && host::heap_counting_enabled()) {
+    fprintf(stderr, "Splitting allocated\n");
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
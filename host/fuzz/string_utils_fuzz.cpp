@@ -0,0 +1,205 @@
+// Fuzz target for the text parsing fed from Home Assistant text entities and
+// the server: field splitting, hex colors, URL encoding, the abbreviation and
+// route style loaders, and bidi reordering.
+//
+// Built as a libFuzzer target with -DHOST_LIBFUZZER=ON under Clang. Otherwise
+// the driver at the bottom runs each file given on the command line, then
+// `--runs N` random mutations of a small seed corpus.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bidi.h"
+#include "esphome/core/log.h"
+#include "host/runtime.h"
+#include "string_utils.h"
+#include "transit_tracker.h"
+
+using esphome::transit_tracker::TransitTracker;
+
+#define FUZZ_ASSERT(condition) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+      abort(); \
+    } \
+  } while (0)
+
+static void check_split(std::string_view text, char delim) {
+  // Joining the fields back gives the input, less a trailing delimiter
+  std::string joined;
+  size_t count = 0;
+  SplitIterator it(text, delim);
+  std::string_view field;
+  while (it.next(&field)) {
+    FUZZ_ASSERT(field.data() >= text.data() && field.data() + field.size() <= text.data() + text.size());
+    FUZZ_ASSERT(field.find(delim) == std::string_view::npos);
+    if (count > 0) {
+      joined += delim;
+    }
+    joined += field;
+    count++;
+  }
+
+  std::string_view expected = text;
+  if (!expected.empty() && expected.back() == delim) {
+    expected.remove_suffix(1);
+  }
+  FUZZ_ASSERT(joined == expected);
+
+  std::string_view fields[3];
+  FUZZ_ASSERT(split(text, delim, fields, 3) == count);
+}
+
+static void check_parse_hex(std::string_view text) {
+  uint32_t value = 0;
+  bool parsed = parse_hex(text, &value);
+
+  bool hex_digits = !text.empty();
+  for (char c : text) {
+    hex_digits &= (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+  }
+
+  if (!hex_digits) {
+    FUZZ_ASSERT(!parsed);
+  } else if (text.size() <= 8) {
+    FUZZ_ASSERT(parsed);
+    FUZZ_ASSERT(value == std::stoul(std::string(text), nullptr, 16));
+  }
+}
+
+static void check_url_encode(std::string_view text) {
+  std::string encoded = url_encode(text);
+  std::string decoded;
+  for (size_t i = 0; i < encoded.size(); i++) {
+    char c = encoded[i];
+    if (c == '%') {
+      FUZZ_ASSERT(i + 2 < encoded.size());
+      decoded += static_cast<char>(std::stoi(encoded.substr(i + 1, 2), nullptr, 16));
+      i += 2;
+    } else {
+      FUZZ_ASSERT(isalnum(static_cast<unsigned char>(c)) || strchr("-_.~", c) != nullptr);
+      decoded += c;
+    }
+  }
+  FUZZ_ASSERT(decoded == text);
+}
+
+extern "C" int LLVMFuzzerInitialize(int *argc, char ***argv) {
+  // Malformed lines are expected and logged as warnings
+  host::set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  std::string text(reinterpret_cast<const char *>(data), size);
+
+  check_split(text, '\n');
+  check_split(text, ';');
+  check_url_encode(text);
+
+  SplitIterator lines(text, '\n');
+  std::string_view line;
+  while (lines.next(&line)) {
+    check_parse_hex(line);
+  }
+
+  static TransitTracker tracker;
+  tracker.set_abbreviations_from_text(text);
+  tracker.set_route_styles_from_text(text);
+
+  esphome::transit_tracker::bidi_visual_order(text, true);
+  esphome::transit_tracker::bidi_visual_order(text, false);
+
+  return 0;
+}
+
+#ifndef HOST_LIBFUZZER
+
+static const char *const SEEDS[] = {
+    "",
+    "\n",
+    ";;\n;",
+    "Street;St\nAvenue;Ave\nNorth;N\n",
+    "route-1;Red Line;FF0000\nroute-2;Blue;0000ff\nbad;line\n",
+    "1_100;1_200,40_990005",
+    "\xd7\xaa\xd7\x97\xd7\xa0\xd7\x94 \xd7\x9e\xd7\xa8\xd7\x9b\xd7\x96 12 (A)",
+    "\xf0\x9f\x9a\x8c Bus \xe2\x80\x8f\xd7\x90\xd7\x91\n",
+    "\xc0\xaf\xed\xa0\x80\xf4\x90\x80\x80\xff\xfe\x80",
+    "0000000000ff;x;00000000000000ffffff",
+};
+
+static std::string mutate(std::mt19937 &rng, std::string input) {
+  static const char DICTIONARY[] = ";\n\r\t #xX0fF-+\xd7\xc2\x80\xbf\xe2\xf0\xff";
+  int mutations = 1 + rng() % 8;
+  for (int i = 0; i < mutations; i++) {
+    size_t pos = input.empty() ? 0 : rng() % (input.size() + 1);
+    switch (rng() % 5) {
+      case 0:
+        input.insert(pos, 1, static_cast<char>(rng()));
+        break;
+      case 1:
+        input.insert(pos, 1, DICTIONARY[rng() % (sizeof(DICTIONARY) - 1)]);
+        break;
+      case 2:
+        if (!input.empty()) {
+          input.erase(pos == input.size() ? pos - 1 : pos, 1 + rng() % 4);
+        }
+        break;
+      case 3:
+        if (!input.empty()) {
+          input[pos == input.size() ? pos - 1 : pos] ^= static_cast<char>(1 << (rng() % 8));
+        }
+        break;
+      default:
+        input += SEEDS[rng() % (sizeof(SEEDS) / sizeof(SEEDS[0]))];
+        break;
+    }
+  }
+  return input;
+}
+
+int main(int argc, char **argv) {
+  LLVMFuzzerInitialize(&argc, &argv);
+
+  long runs = 100000;
+  std::vector<std::string> files;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = atol(argv[++i]);
+    } else {
+      files.push_back(argv[i]);
+    }
+  }
+
+  for (const std::string &file : files) {
+    std::ifstream in(file, std::ios::binary);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    std::string input = buffer.str();
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(input.data()), input.size());
+  }
+
+  std::mt19937 rng(19);
+  std::vector<std::string> corpus(std::begin(SEEDS), std::end(SEEDS));
+  for (long run = 0; run < runs; run++) {
+    std::string input = mutate(rng, corpus[rng() % corpus.size()]);
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(input.data()), input.size());
+    if (corpus.size() < 256 && input.size() < 512 && rng() % 16 == 0) {
+      corpus.push_back(std::move(input));
+    }
+  }
+
+  printf("%ld inputs ok\n", runs + static_cast<long>(files.size()));
+  return 0;
+}
+
+#endif  // HOST_LIBFUZZER
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal assertions for the host tests: report and keep going, so one run
+// shows every failure, then host_check_exit() sets the exit status.
+inline int &host_check_failures() {
+  static int failures = 0;
+  return failures;
+}
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      host_check_failures()++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(actual, expected) \
+  do { \
+    auto actual_value_ = (actual); \
+    auto expected_value_ = (expected); \
+    if (!(actual_value_ == expected_value_)) { \
+      fprintf(stderr, "%s:%d: CHECK_EQ failed: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #actual, #expected, \
+              (long long) actual_value_, (long long) expected_value_); \
+      host_check_failures()++; \
+    } \
+  } while (0)
+
+inline int host_check_exit() {
+  if (host_check_failures() > 0) {
+    fprintf(stderr, "%d check(s) failed\n", host_check_failures());
+    return EXIT_FAILURE;
+  }
+  printf("All checks passed\n");
+  return EXIT_SUCCESS;
+}
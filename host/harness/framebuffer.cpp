@@ -0,0 +1,47 @@
+#include "framebuffer.h"
+
+namespace host {
+
+FramebufferDisplay::FramebufferDisplay(int width, int height)
+    : width_(width), height_(height), pixels_(width * height) {}
+
+void FramebufferDisplay::draw_pixel_at(int x, int y, esphome::Color color) {
+  if (x < 0 || y < 0 || x >= this->width_ || y >= this->height_) {
+    return;
+  }
+  if (this->is_clipping() && !this->get_clipping().inside(x, y)) {
+    return;
+  }
+
+  this->pixels_[y * this->width_ + x] = color;
+  this->pixel_writes_++;
+}
+
+bool FramebufferDisplay::is_lit(int x, int y) const {
+  esphome::Color color = this->pixel(x, y);
+  return color.r != 0 || color.g != 0 || color.b != 0;
+}
+
+uint32_t FramebufferDisplay::hash() const {
+  uint32_t hash = 2166136261u;
+  for (esphome::Color color : this->pixels_) {
+    for (uint8_t byte : {color.r, color.g, color.b}) {
+      hash = (hash ^ byte) * 16777619u;
+    }
+  }
+  return hash;
+}
+
+std::string FramebufferDisplay::ascii() const {
+  std::string out;
+  out.reserve((this->width_ + 1) * this->height_);
+  for (int y = 0; y < this->height_; y++) {
+    for (int x = 0; x < this->width_; x++) {
+      out += this->is_lit(x, y) ? '#' : '.';
+    }
+    out += '\n';
+  }
+  return out;
+}
+
+}  // namespace host
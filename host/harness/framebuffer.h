@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "esphome/components/display/display.h"
+
+namespace host {
+
+// An in-memory color display the size of the LED matrix. Clipping is applied
+// per pixel, as ESPHome's buffered displays do.
+class FramebufferDisplay : public esphome::display::Display {
+  public:
+    FramebufferDisplay(int width = 128, int height = 32);
+
+    void draw_pixel_at(int x, int y, esphome::Color color) override;
+    void update() override {}
+    esphome::display::DisplayType get_display_type() override { return esphome::display::DISPLAY_TYPE_COLOR; }
+
+    esphome::Color pixel(int x, int y) const { return this->pixels_[y * this->width_ + x]; }
+    bool is_lit(int x, int y) const;
+
+    // FNV-1a over every pixel, for comparing frames
+    uint32_t hash() const;
+    // One character per pixel, '#' lit and '.' dark
+    std::string ascii() const;
+
+    uint64_t pixel_writes() const { return this->pixel_writes_; }
+    void reset_pixel_writes() { this->pixel_writes_ = 0; }
+
+  protected:
+    int get_width_internal() override { return this->width_; }
+    int get_height_internal() override { return this->height_; }
+
+    int width_;
+    int height_;
+    std::vector<esphome::Color> pixels_;
+    uint64_t pixel_writes_ = 0;
+};
+
+}  // namespace host
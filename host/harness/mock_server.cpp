@@ -0,0 +1,471 @@
+#include "mock_server.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include "esphome/core/hal.h"
+#include "host/encoding.h"
+
+namespace host {
+
+namespace {
+
+enum Opcode : uint8_t {
+  OPCODE_CONTINUATION = 0x0,
+  OPCODE_TEXT = 0x1,
+  OPCODE_BINARY = 0x2,
+  OPCODE_CLOSE = 0x8,
+  OPCODE_PING = 0x9,
+  OPCODE_PONG = 0xA,
+};
+
+const char HEARTBEAT[] = "{\"event\":\"heartbeat\"}";
+
+std::string lowercase(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+  return str;
+}
+
+}  // namespace
+
+MockServer::~MockServer() { this->stop(); }
+
+bool MockServer::start(uint16_t port) {
+  if (this->running_.load()) {
+    return true;
+  }
+
+  int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  int one = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port != 0 ? port : this->port_);
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(fd, 16) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  socklen_t length = sizeof(address);
+  getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length);
+  this->port_ = ntohs(address.sin_port);
+  this->listen_fd_ = fd;
+  this->wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  this->next_heartbeat_ = esphome::millis() + this->heartbeat_interval_;
+
+  this->running_ = true;
+  this->thread_ = std::thread([this]() { this->run_(); });
+  return true;
+}
+
+void MockServer::stop() {
+  if (!this->running_.exchange(false)) {
+    return;
+  }
+
+  this->wake_();
+  this->thread_.join();
+
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  for (auto &entry : this->connections_) {
+    ::close(entry.second.fd);
+  }
+  this->connections_.clear();
+  ::close(this->listen_fd_);
+  ::close(this->wake_fd_);
+  this->listen_fd_ = -1;
+  this->wake_fd_ = -1;
+}
+
+std::string MockServer::url() const { return "ws://127.0.0.1:" + std::to_string(this->port_) + "/"; }
+
+void MockServer::on_subscribe(SubscribeHandler handler) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  this->subscribe_handler_ = std::move(handler);
+}
+
+void MockServer::set_heartbeat_interval(uint32_t interval_ms) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  this->heartbeat_interval_ = interval_ms;
+  this->next_heartbeat_ = esphome::millis() + interval_ms;
+}
+
+void MockServer::send(int connection, const std::string &payload, bool binary) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  auto it = this->connections_.find(connection);
+  if (it == this->connections_.end() || !it->second.upgraded) {
+    return;
+  }
+  this->queue_frame_(it->second, binary ? OPCODE_BINARY : OPCODE_TEXT, payload);
+  this->messages_sent_++;
+  this->wake_();
+}
+
+uint32_t MockServer::broadcast(const std::string &payload, bool binary) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  uint32_t recipients = 0;
+  for (auto &entry : this->connections_) {
+    if (entry.second.subscribed) {
+      this->queue_frame_(entry.second, binary ? OPCODE_BINARY : OPCODE_TEXT, payload);
+      recipients++;
+    }
+  }
+  this->messages_sent_ += recipients;
+  this->wake_();
+  return recipients;
+}
+
+void MockServer::drop_connections() {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  for (auto &entry : this->connections_) {
+    // A zero linger timeout makes close() send a reset
+    linger reset{1, 0};
+    setsockopt(entry.second.fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    ::close(entry.second.fd);
+  }
+  this->connections_.clear();
+}
+
+void MockServer::set_refuse_connections(bool refuse) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  this->refuse_connections_ = refuse;
+}
+
+void MockServer::set_stall_handshakes(bool stall) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  this->stall_handshakes_ = stall;
+}
+
+void MockServer::set_answer_pings(bool answer) {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  this->answer_pings_ = answer;
+}
+
+uint32_t MockServer::open_connections() {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  return this->connections_.size();
+}
+
+std::vector<std::string> MockServer::subscribe_messages() {
+  std::lock_guard<std::recursive_mutex> guard(this->lock_);
+  return this->subscribe_messages_;
+}
+
+void MockServer::wake_() {
+  uint64_t one = 1;
+  if (this->wake_fd_ >= 0) {
+    (void) !::write(this->wake_fd_, &one, sizeof(one));
+  }
+}
+
+void MockServer::run_() {
+  std::vector<pollfd> fds;
+  std::vector<int> ids;
+
+  while (this->running_.load()) {
+    fds.clear();
+    ids.clear();
+    {
+      std::lock_guard<std::recursive_mutex> guard(this->lock_);
+      fds.push_back({this->listen_fd_, POLLIN, 0});
+      fds.push_back({this->wake_fd_, POLLIN, 0});
+      for (auto &entry : this->connections_) {
+        short events = POLLIN;
+        if (!entry.second.out.empty()) {
+          events |= POLLOUT;
+        }
+        fds.push_back({entry.second.fd, events, 0});
+        ids.push_back(entry.first);
+      }
+    }
+
+    // Wakes at least every millisecond to keep heartbeats on the host clock
+    ::poll(fds.data(), fds.size(), 1);
+
+    std::lock_guard<std::recursive_mutex> guard(this->lock_);
+    if (fds[1].revents & POLLIN) {
+      uint64_t count;
+      (void) !::read(this->wake_fd_, &count, sizeof(count));
+    }
+    if (fds[0].revents & POLLIN) {
+      this->accept_();
+    }
+
+    for (size_t i = 0; i < ids.size(); i++) {
+      auto it = this->connections_.find(ids[i]);
+      if (it == this->connections_.end()) {
+        // Dropped meanwhile
+        continue;
+      }
+      short revents = fds[i + 2].revents;
+      bool open = true;
+      if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        open = this->read_(it->second) && this->handle_input_(it->first, it->second);
+      }
+      if (open && !it->second.out.empty()) {
+        open = this->flush_(it->second);
+      }
+      if (!open) {
+        this->close_(ids[i]);
+      }
+    }
+
+    uint32_t now = esphome::millis();
+    if (this->heartbeat_interval_ > 0 && static_cast<int32_t>(now - this->next_heartbeat_) >= 0) {
+      this->next_heartbeat_ = now + this->heartbeat_interval_;
+      for (auto &entry : this->connections_) {
+        if (entry.second.upgraded) {
+          this->queue_frame_(entry.second, OPCODE_TEXT, HEARTBEAT);
+          this->flush_(entry.second);
+          this->messages_sent_++;
+        }
+      }
+    }
+
+    // Anything queued from other threads since the poll
+    for (auto &entry : this->connections_) {
+      if (!entry.second.out.empty()) {
+        this->flush_(entry.second);
+      }
+    }
+  }
+}
+
+void MockServer::accept_() {
+  for (;;) {
+    int fd = ::accept4(this->listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    this->connections_accepted_++;
+    if (this->refuse_connections_) {
+      ::close(fd);
+      continue;
+    }
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    this->connections_.emplace(this->next_id_++, Connection{fd});
+  }
+}
+
+bool MockServer::read_(Connection &connection) {
+  char buffer[16384];
+  for (;;) {
+    ssize_t received = ::recv(connection.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (received > 0) {
+      connection.in.append(buffer, received);
+      continue;
+    }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return true;
+    }
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    return false;
+  }
+}
+
+bool MockServer::handle_input_(int id, Connection &connection) {
+  if (!connection.upgraded) {
+    if (this->stall_handshakes_) {
+      connection.in.clear();
+      return true;
+    }
+    if (connection.in.find("\r\n\r\n") == std::string::npos) {
+      return true;
+    }
+    if (!this->handshake_(connection)) {
+      return false;
+    }
+  }
+
+  std::string &in = connection.in;
+  for (;;) {
+    if (in.size() < 2) {
+      return true;
+    }
+
+    auto byte = [&in](size_t i) { return static_cast<uint8_t>(in[i]); };
+    bool fin = byte(0) & 0x80;
+    uint8_t opcode = byte(0) & 0x0F;
+    bool masked = byte(1) & 0x80;
+    uint64_t length = byte(1) & 0x7F;
+    size_t header = 2;
+    if (length == 126) {
+      if (in.size() < 4) {
+        return true;
+      }
+      length = (uint64_t(byte(2)) << 8) | byte(3);
+      header = 4;
+    } else if (length == 127) {
+      if (in.size() < 10) {
+        return true;
+      }
+      length = 0;
+      for (int i = 0; i < 8; i++) {
+        length = (length << 8) | byte(2 + i);
+      }
+      header = 10;
+    }
+
+    // Clients must mask every frame (RFC 6455 section 5.1)
+    if (!masked) {
+      return false;
+    }
+    if (in.size() < header + 4 + length) {
+      return true;
+    }
+
+    const uint8_t *mask = reinterpret_cast<const uint8_t *>(in.data() + header);
+    std::string payload = in.substr(header + 4, length);
+    for (size_t i = 0; i < payload.size(); i++) {
+      payload[i] ^= mask[i % 4];
+    }
+    in.erase(0, header + 4 + length);
+
+    if (opcode == OPCODE_CLOSE) {
+      this->queue_frame_(connection, OPCODE_CLOSE, payload.substr(0, 2));
+      this->flush_(connection);
+      return false;
+    }
+    if (opcode == OPCODE_PING) {
+      this->pings_++;
+      if (this->answer_pings_) {
+        this->queue_frame_(connection, OPCODE_PONG, payload);
+      }
+      continue;
+    }
+    if (opcode == OPCODE_PONG) {
+      continue;
+    }
+
+    if (opcode != OPCODE_CONTINUATION) {
+      connection.fragment_opcode = opcode;
+      connection.fragments.clear();
+    }
+    connection.fragments += payload;
+    if (fin) {
+      this->handle_message_(id, connection, connection.fragment_opcode, connection.fragments);
+      connection.fragments.clear();
+    }
+  }
+}
+
+bool MockServer::handshake_(Connection &connection) {
+  size_t end = connection.in.find("\r\n\r\n");
+  std::string request = connection.in.substr(0, end);
+  connection.in.erase(0, end + 4);
+
+  std::string key;
+  size_t line_start = request.find("\r\n");
+  while (line_start != std::string::npos) {
+    line_start += 2;
+    size_t line_end = request.find("\r\n", line_start);
+    std::string line = request.substr(line_start, line_end == std::string::npos ? std::string::npos
+                                                                                : line_end - line_start);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos && lowercase(line.substr(0, colon)) == "sec-websocket-key") {
+      key = line.substr(colon + 1);
+      key.erase(0, key.find_first_not_of(' '));
+    }
+    line_start = line_end;
+  }
+
+  if (request.compare(0, 4, "GET ") != 0 || key.empty()) {
+    connection.out += "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+    this->flush_(connection);
+    return false;
+  }
+
+  connection.out += "HTTP/1.1 101 Switching Protocols\r\n"
+                    "Upgrade: websocket\r\n"
+                    "Connection: Upgrade\r\n"
+                    "Sec-WebSocket-Accept: " +
+                    websocket_accept_key(key) + "\r\n\r\n";
+  connection.upgraded = true;
+  return true;
+}
+
+void MockServer::handle_message_(int id, Connection &connection, uint8_t opcode, const std::string &payload) {
+  // Subscribes are recognized without parsing, so replays only time the
+  // tracker's own parsing
+  if (opcode != OPCODE_TEXT || payload.find("\"schedule:subscribe\"") == std::string::npos) {
+    return;
+  }
+
+  connection.subscribed = true;
+  this->subscribe_messages_.push_back(payload);
+  this->subscribes_++;
+  if (this->subscribe_handler_) {
+    this->subscribe_handler_(id, payload);
+  }
+}
+
+void MockServer::queue_frame_(Connection &connection, uint8_t opcode, const std::string &payload) {
+  std::string &out = connection.out;
+  out += static_cast<char>(0x80 | opcode);
+  if (payload.size() < 126) {
+    out += static_cast<char>(payload.size());
+  } else if (payload.size() <= 0xFFFF) {
+    out += static_cast<char>(126);
+    out += static_cast<char>(payload.size() >> 8);
+    out += static_cast<char>(payload.size() & 0xFF);
+  } else {
+    out += static_cast<char>(127);
+    for (int i = 7; i >= 0; i--) {
+      out += static_cast<char>((uint64_t(payload.size()) >> (8 * i)) & 0xFF);
+    }
+  }
+  out += payload;
+}
+
+bool MockServer::flush_(Connection &connection) {
+  while (!connection.out.empty()) {
+    ssize_t sent = ::send(connection.fd, connection.out.data(), connection.out.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent > 0) {
+      connection.out.erase(0, sent);
+      continue;
+    }
+    return sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+  }
+  return true;
+}
+
+void MockServer::close_(int id) {
+  auto it = this->connections_.find(id);
+  if (it != this->connections_.end()) {
+    ::close(it->second.fd);
+    this->connections_.erase(it);
+  }
+}
+
+bool wait_until(const std::function<bool()> &predicate, uint32_t timeout_ms) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (!predicate()) {
+    if (std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  return true;
+}
+
+}  // namespace host
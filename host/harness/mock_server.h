@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace host {
+
+// A local stand-in for the Transit Tracker server's websocket endpoint. It
+// answers the upgrade, records schedule:subscribe messages, sends heartbeats
+// on the host clock and whatever the test or replay sends, and can misbehave
+// the ways servers and networks do in the field. Everything runs on one
+// thread; the methods may be called from any other.
+class MockServer {
+  public:
+    // Runs on the server thread for every schedule:subscribe message
+    using SubscribeHandler = std::function<void(int connection, const std::string &message)>;
+
+    MockServer() = default;
+    ~MockServer();
+    MockServer(const MockServer &) = delete;
+    MockServer &operator=(const MockServer &) = delete;
+
+    // Listens on 127.0.0.1; port 0 picks a free one. A stopped server can be
+    // started again on the same port, as after a restart.
+    bool start(uint16_t port = 0);
+    void stop();
+    uint16_t port() const { return this->port_; }
+    std::string url() const;
+
+    void on_subscribe(SubscribeHandler handler);
+    // Sends {"event":"heartbeat"} every `interval_ms` of host clock time;
+    // 0 stops them
+    void set_heartbeat_interval(uint32_t interval_ms);
+
+    void send(int connection, const std::string &payload, bool binary = false);
+    // To every connection that has subscribed; returns how many that was
+    uint32_t broadcast(const std::string &payload, bool binary = false);
+
+    // Faults
+    // Resets every connection without a close frame, as a crashed server
+    void drop_connections();
+    // Closes new connections as soon as they are accepted
+    void set_refuse_connections(bool refuse);
+    // Accepts connections but never answers the upgrade request
+    void set_stall_handshakes(bool stall);
+    // Leaves pings unanswered
+    void set_answer_pings(bool answer);
+
+    uint32_t connections_accepted() const { return this->connections_accepted_.load(); }
+    uint32_t open_connections();
+    uint32_t subscribes() const { return this->subscribes_.load(); }
+    uint32_t pings() const { return this->pings_.load(); }
+    uint64_t messages_sent() const { return this->messages_sent_.load(); }
+    // Every schedule:subscribe message received, oldest first
+    std::vector<std::string> subscribe_messages();
+
+  protected:
+    struct Connection {
+      int fd;
+      bool upgraded = false;
+      bool subscribed = false;
+      std::string in;
+      std::string out;
+      // Payload and opcode of a fragmented message in progress
+      std::string fragments;
+      uint8_t fragment_opcode = 0;
+    };
+
+    void run_();
+    void wake_();
+    void accept_();
+    // False once the connection should be closed
+    bool read_(Connection &connection);
+    bool handle_input_(int id, Connection &connection);
+    bool handshake_(Connection &connection);
+    void handle_message_(int id, Connection &connection, uint8_t opcode, const std::string &payload);
+    void queue_frame_(Connection &connection, uint8_t opcode, const std::string &payload);
+    bool flush_(Connection &connection);
+    void close_(int id);
+
+    // Recursive so the subscribe handler can send
+    std::recursive_mutex lock_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+    int listen_fd_ = -1;
+    int wake_fd_ = -1;
+    uint16_t port_ = 0;
+
+    std::map<int, Connection> connections_;
+    int next_id_ = 0;
+    SubscribeHandler subscribe_handler_;
+    std::vector<std::string> subscribe_messages_;
+    uint32_t heartbeat_interval_ = 0;
+    uint32_t next_heartbeat_ = 0;
+    bool refuse_connections_ = false;
+    bool stall_handshakes_ = false;
+    bool answer_pings_ = true;
+
+    std::atomic<uint32_t> connections_accepted_{0};
+    std::atomic<uint32_t> subscribes_{0};
+    std::atomic<uint32_t> pings_{0};
+    std::atomic<uint64_t> messages_sent_{0};
+};
+
+// Polls `predicate` until it holds or `timeout_ms` of real time passes
+bool wait_until(const std::function<bool()> &predicate, uint32_t timeout_ms = 5000);
+
+}  // namespace host
@@ -0,0 +1,353 @@
+#include "replay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <thread>
+
+#include "esphome/core/application.h"
+#include "esphome/core/hal.h"
+#include "host/clock.h"
+#include "host/heap.h"
+#include "mock_server.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+namespace host {
+
+static const char *const SCENARIO_NAMES[SCENARIO_COUNT] = {"steady", "burst", "heartbeat-gap", "server-restart"};
+
+const char *scenario_name(ReplayScenario scenario) { return SCENARIO_NAMES[scenario]; }
+
+bool parse_scenario(const std::string &name, ReplayScenario *scenario) {
+  for (int i = 0; i < SCENARIO_COUNT; i++) {
+    if (name == SCENARIO_NAMES[i]) {
+      *scenario = ReplayScenario(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+Percentiles percentiles(std::vector<uint32_t> samples) {
+  Percentiles result;
+  result.count = samples.size();
+  if (samples.empty()) {
+    return result;
+  }
+
+  std::sort(samples.begin(), samples.end());
+  auto at = [&samples](double quantile) { return samples[size_t(quantile * (samples.size() - 1))]; };
+  result.p50 = at(0.50);
+  result.p90 = at(0.90);
+  result.p99 = at(0.99);
+  result.max = samples.back();
+  return result;
+}
+
+namespace {
+
+constexpr int BURST_MESSAGES = 32;
+constexpr uint32_t HEARTBEAT_GAP_MIN = 150000;
+constexpr uint32_t RESTART_REFUSAL = 10000;
+
+enum ActionType : uint8_t { ACTION_SEND, ACTION_BURST, ACTION_DROP, ACTION_ACCEPT };
+
+struct Action {
+  uint32_t at_ms;
+  ActionType type;
+  const TraceEvent *event;
+};
+
+// Feeds the server from the trace on the host clock, applying the scenario
+class Player {
+  public:
+    Player(const Trace &trace, const ReplayOptions &options, MockServer &server)
+        : trace_(trace), options_(options), server_(server) {}
+
+    void start(TrackerFixture &fixture) {
+      this->fixture_ = &fixture;
+      this->build_actions_();
+      this->server_.on_subscribe([this](int connection, const std::string &) {
+        // A (re)subscribed tracker starts from the latest schedule, as the
+        // server would send. This runs under the server's lock, so it must
+        // not wait on anything held around a broadcast.
+        const TraceEvent *latest = this->latest_.load();
+        if (latest != nullptr) {
+          this->server_.send(connection, latest->payload, latest->binary);
+          this->sent_++;
+        }
+      });
+      this->thread_ = std::thread([this]() { this->run_(); });
+    }
+
+    void join() {
+      if (this->thread_.joinable()) {
+        this->thread_.join();
+      }
+    }
+
+    bool done() const { return this->done_.load(); }
+    uint32_t sent() const { return this->sent_.load(); }
+    // Tracker messages at the time of the fault; UINT32_MAX until then
+    uint32_t ingested_at_fault() const { return this->ingested_at_fault_.load(); }
+
+  protected:
+    void build_actions_() {
+      uint32_t duration = this->trace_.duration_ms();
+      uint32_t gap_start = duration / 4;
+      uint32_t gap_end = gap_start + std::max(HEARTBEAT_GAP_MIN, duration / 5);
+
+      const TraceEvent *largest = nullptr;
+      for (const TraceEvent &event : this->trace_.events) {
+        std::string name = event_name(event);
+        if (name == "heartbeat" && this->options_.scenario == SCENARIO_HEARTBEAT_GAP && event.at_ms >= gap_start &&
+            event.at_ms < gap_end) {
+          continue;
+        }
+        if (name == "schedule" && (largest == nullptr || event.payload.size() > largest->payload.size())) {
+          largest = &event;
+        }
+        this->actions_.push_back({event.at_ms, ACTION_SEND, &event});
+      }
+
+      switch (this->options_.scenario) {
+        case SCENARIO_BURST:
+          if (largest != nullptr) {
+            this->actions_.push_back({duration / 4, ACTION_BURST, largest});
+          }
+          this->fault_at_ = duration / 4;
+          break;
+        case SCENARIO_HEARTBEAT_GAP:
+          this->fault_at_ = gap_start;
+          break;
+        case SCENARIO_SERVER_RESTART:
+          this->actions_.push_back({duration / 2, ACTION_DROP, nullptr});
+          this->actions_.push_back({duration / 2 + RESTART_REFUSAL, ACTION_ACCEPT, nullptr});
+          this->fault_at_ = duration / 2;
+          break;
+        default:
+          this->fault_at_ = 0;
+          break;
+      }
+
+      std::stable_sort(this->actions_.begin(), this->actions_.end(),
+                       [](const Action &a, const Action &b) { return a.at_ms < b.at_ms; });
+    }
+
+    void run_() {
+      uint32_t start = esphome::millis();
+      bool fault_seen = false;
+
+      for (const Action &action : this->actions_) {
+        while (static_cast<int32_t>(esphome::millis() - start - action.at_ms) < 0) {
+          sleep_clock(std::min<uint32_t>(action.at_ms - (esphome::millis() - start), 50));
+        }
+
+        if (!fault_seen && action.at_ms >= this->fault_at_) {
+          fault_seen = true;
+          this->ingested_at_fault_ = this->fixture_->tracker.get_ingest_stats().messages;
+        }
+
+        switch (action.type) {
+          case ACTION_SEND:
+            this->send_(*action.event);
+            break;
+          case ACTION_BURST:
+            for (int i = 0; i < BURST_MESSAGES; i++) {
+              this->send_(*action.event);
+            }
+            break;
+          case ACTION_DROP:
+            this->server_.set_refuse_connections(true);
+            this->server_.drop_connections();
+            break;
+          case ACTION_ACCEPT:
+            this->server_.set_refuse_connections(false);
+            break;
+        }
+      }
+
+      if (!fault_seen) {
+        this->ingested_at_fault_ = this->fixture_->tracker.get_ingest_stats().messages;
+      }
+      this->done_ = true;
+    }
+
+    void send_(const TraceEvent &event) {
+      std::string name = event_name(event);
+      bool schedule = name.compare(0, 8, "schedule") == 0;
+      if (name == "schedule") {
+        this->latest_ = &event;
+      }
+      uint32_t recipients = this->server_.broadcast(event.payload, event.binary);
+      if (schedule) {
+        this->sent_ += recipients;
+      }
+    }
+
+    const Trace &trace_;
+    const ReplayOptions &options_;
+    MockServer &server_;
+    TrackerFixture *fixture_ = nullptr;
+    std::vector<Action> actions_;
+    uint32_t fault_at_ = 0;
+
+    std::thread thread_;
+    std::atomic<const TraceEvent *> latest_{nullptr};
+    std::atomic<bool> done_{false};
+    std::atomic<uint32_t> sent_{0};
+    std::atomic<uint32_t> ingested_at_fault_{UINT32_MAX};
+};
+
+}  // namespace
+
+ReplayReport run_replay(const Trace &trace, const ReplayOptions &options) {
+  ReplayReport report;
+  report.scenario = scenario_name(options.scenario);
+
+  MockServer server;
+  if (!server.start()) {
+    fprintf(stderr, "Failed to start the mock server\n");
+    return report;
+  }
+
+  set_clock_speed(options.speed);
+
+  TrackerOptions tracker_options;
+  tracker_options.base_url = server.url();
+  tracker_options.start_hub = true;
+  tracker_options.limit = options.limit;
+  tracker_options.rtl = options.rtl;
+  tracker_options.scroll_headsigns = true;
+  tracker_options.now = trace.epoch != 0 ? trace.epoch : time(nullptr);
+
+  HeapCounters heap_start = heap_counters();
+  reset_heap_peak();
+
+  std::vector<uint32_t> frame_late_us;
+  {
+    TrackerFixture fixture(tracker_options);
+    fixture.hub.set_network_task(options.network_task);
+    fixture.setup();
+
+    Player player(trace, options, server);
+    player.start(fixture);
+
+    double frame_interval_us = options.frame_interval_ms * 1000.0 / options.speed;
+    double next_frame_us = real_micros();
+    uint32_t drain_until = 0;
+    bool draining = false;
+
+    for (;;) {
+      uint64_t loop_start = real_micros();
+      esphome::App.loop();
+      report.max_loop_us = std::max<uint32_t>(report.max_loop_us, real_micros() - loop_start);
+      if (esphome::App.is_reboot_requested()) {
+        report.rebooted = true;
+        break;
+      }
+
+      uint64_t now_us = real_micros();
+      if (now_us >= next_frame_us) {
+        frame_late_us.push_back(now_us - next_frame_us);
+        fixture.draw();
+        report.frames++;
+        next_frame_us += frame_interval_us;
+        // Frames that can't be drawn in time are skipped, as on the device
+        if (next_frame_us < real_micros()) {
+          next_frame_us = real_micros() + frame_interval_us;
+        }
+      }
+
+      if (player.done() && !draining) {
+        draining = true;
+        drain_until = esphome::millis() + options.drain_ms;
+      }
+      if (draining && static_cast<int32_t>(esphome::millis() - drain_until) >= 0) {
+        break;
+      }
+
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+    }
+
+    player.join();
+
+    const auto &ingest = fixture.tracker.get_ingest_stats();
+    report.sent = player.sent();
+    report.ingested = ingest.messages;
+    report.dropped = ingest.dropped;
+    report.bytes = ingest.bytes;
+    report.decode_us.count = ingest.decode_us.count();
+    report.decode_us.p50 = ingest.decode_us.percentile(50);
+    report.decode_us.p90 = ingest.decode_us.percentile(90);
+    report.decode_us.p99 = ingest.decode_us.percentile(99);
+    report.decode_us.max = ingest.decode_us.max();
+    report.lost = report.sent > report.ingested ? report.sent - report.ingested : 0;
+    report.reconnects = ingest.reconnects;
+    report.subscribes = server.subscribes();
+    uint32_t at_fault = player.ingested_at_fault();
+    report.ingested_after_fault = at_fault == UINT32_MAX || at_fault > ingest.messages ? 0 : ingest.messages - at_fault;
+
+    server.stop();
+  }
+
+  report.frame_late_us = percentiles(std::move(frame_late_us));
+  HeapCounters heap_end = heap_counters();
+  report.peak_heap_bytes = heap_end.peak_bytes > heap_start.bytes_in_use ? heap_end.peak_bytes - heap_start.bytes_in_use : 0;
+
+  set_clock_speed(1.0);
+  return report;
+}
+
+void print_report_header() {
+  printf("%-15s %6s %6s %6s %5s %5s %5s %9s | %-23s | %-17s %7s %9s\n", "scenario", "sent", "ingest", "dropped",
+         "lost", "recon", "after", "bytes", "decode us p50/p90/p99/max", "frame late p50/p99", "loop us", "peak heap");
+}
+
+void print_report(const ReplayReport &report) {
+  char decode[32];
+  snprintf(decode, sizeof(decode), "%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32, report.decode_us.p50,
+           report.decode_us.p90, report.decode_us.p99, report.decode_us.max);
+  char frames[32];
+  snprintf(frames, sizeof(frames), "%" PRIu32 "/%" PRIu32, report.frame_late_us.p50, report.frame_late_us.p99);
+
+  printf("%-15s %6" PRIu32 " %6" PRIu32 " %6" PRIu32 " %5" PRIu32 " %5" PRIu32 " %5" PRIu32 " %9" PRIu32
+         " | %-23s | %-17s %7" PRIu32 " %9zu%s\n",
+         report.scenario.c_str(), report.sent, report.ingested, report.dropped, report.lost, report.reconnects,
+         report.ingested_after_fault, report.bytes, decode, frames, report.max_loop_us, report.peak_heap_bytes,
+         report.rebooted ? "  REBOOTED" : "");
+}
+
+Trace synthesize_trace(const SynthesizeOptions &options) {
+  Trace trace;
+  trace.epoch = options.epoch;
+
+  uint32_t next_schedule = 0;
+  uint32_t next_heartbeat = options.heartbeat_interval_ms;
+  uint32_t variant = 0;
+
+  while (next_schedule <= options.duration_ms || next_heartbeat <= options.duration_ms) {
+    if (next_schedule <= next_heartbeat) {
+      ScheduleOptions schedule;
+      schedule.trips = options.trips;
+      schedule.rtl = options.rtl;
+      schedule.long_headsigns = options.long_headsigns;
+      schedule.now = options.epoch + next_schedule / 1000;
+      schedule.first_in = 60 + variant % 5 * 20;
+      schedule.variant = variant++;
+
+      TraceEvent event{next_schedule, false, make_schedule_message(schedule)};
+      trace.events.push_back(encode_event(event, options.msgpack));
+      next_schedule += options.schedule_interval_ms;
+    } else {
+      trace.events.push_back(encode_event({next_heartbeat, false, "{\"event\":\"heartbeat\"}"}, options.msgpack));
+      next_heartbeat += options.heartbeat_interval_ms;
+    }
+  }
+
+  return trace;
+}
+
+}  // namespace host
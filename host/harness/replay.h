@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace host {
+
+// Faults layered over a trace, after the field failures they reproduce
+enum ReplayScenario : uint8_t {
+  // The trace as recorded
+  SCENARIO_STEADY,
+  // The largest schedule in the trace sent 32 times back to back, a quarter
+  // of the way in
+  SCENARIO_BURST,
+  // No heartbeats for a stretch from a quarter of the way in, long enough
+  // for the hub to give up on the connection
+  SCENARIO_HEARTBEAT_GAP,
+  // Halfway in the server resets every connection and refuses new ones for
+  // 10 s, as during a deploy
+  SCENARIO_SERVER_RESTART,
+  SCENARIO_COUNT,
+};
+
+const char *scenario_name(ReplayScenario scenario);
+bool parse_scenario(const std::string &name, ReplayScenario *scenario);
+
+struct ReplayOptions {
+  // Host clock speed; 1000 plays 15 minutes of trace in about a second
+  double speed = 1000.0;
+  ReplayScenario scenario = SCENARIO_STEADY;
+  // Decode on the hub's network task rather than in loop()
+  bool network_task = false;
+  bool rtl = false;
+  int limit = 6;
+  // Host clock time to keep running after the last event
+  uint32_t drain_ms = 10000;
+  uint32_t frame_interval_ms = 16;
+};
+
+struct Percentiles {
+  size_t count = 0;
+  uint32_t p50 = 0;
+  uint32_t p90 = 0;
+  uint32_t p99 = 0;
+  uint32_t max = 0;
+};
+
+Percentiles percentiles(std::vector<uint32_t> samples);
+
+struct ReplayReport {
+  std::string scenario;
+  // Schedule messages the server sent to a subscribed tracker
+  uint32_t sent = 0;
+  // Messages the tracker took in, and how many of those it dropped as
+  // unparseable or out of sequence
+  uint32_t ingested = 0;
+  uint32_t dropped = 0;
+  // Size of those messages as they came over the wire
+  uint32_t bytes = 0;
+  // Sent but never ingested, e.g. lost with a connection
+  uint32_t lost = 0;
+  uint32_t reconnects = 0;
+  uint32_t subscribes = 0;
+  // Ingested after the scenario's fault, to show the tracker recovered
+  uint32_t ingested_after_fault = 0;
+  bool rebooted = false;
+
+  // The hub's decode time for the last messages the tracker took in, as the
+  // device measures it: schedules only, with the message filter applied
+  Percentiles decode_us;
+  // How late each frame started, in real time, and the longest main loop
+  // iteration: what a stall in scrolling would look like
+  Percentiles frame_late_us;
+  uint32_t frames = 0;
+  uint32_t max_loop_us = 0;
+  // Heap growth over the run, operator new and heap_caps together
+  size_t peak_heap_bytes = 0;
+};
+
+// Plays `trace` from a MockServer to a tracker connected through its hub
+ReplayReport run_replay(const Trace &trace, const ReplayOptions &options);
+
+void print_report_header();
+void print_report(const ReplayReport &report);
+
+struct SynthesizeOptions {
+  uint32_t duration_ms = 15 * 60 * 1000;
+  uint32_t schedule_interval_ms = 30000;
+  uint32_t heartbeat_interval_ms = 15000;
+  int trips = 6;
+  bool rtl = false;
+  bool long_headsigns = true;
+  // Schedules and heartbeats as MessagePack, as sent to a subscriber that asked for it
+  bool msgpack = false;
+  time_t epoch = 1700000000;
+};
+
+// A trace of full schedules and heartbeats, like the server's, for when no
+// recording is at hand
+Trace synthesize_trace(const SynthesizeOptions &options);
+
+}  // namespace host
@@ -0,0 +1,105 @@
+#include "schedules.h"
+
+#include <cinttypes>
+#include <cstdio>
+
+#include "synthetic_font.h"
+
+namespace host {
+
+static const char *const LTR_HEADSIGNS[] = {
+    "Downtown", "University District", "Northgate Station", "Capitol Hill", "Airport",
+    "Ballard via Fremont", "Rainier Beach", "West Seattle Junction",
+};
+
+static const char *const LTR_SUFFIXES[] = {
+    " via 3rd Avenue and the Waterfront Streetcar Extension",
+    " Express, Limited Stops During Peak Hours Only",
+};
+
+// Hebrew words as code points, so the source stays ASCII
+static const uint32_t RTL_WORDS[][6] = {
+    {0x05EA, 0x05D7, 0x05E0, 0x05D4, 0, 0},       // station
+    {0x05DE, 0x05E8, 0x05DB, 0x05D6, 0, 0},       // center
+    {0x05D0, 0x05D5, 0x05E0, 0x05D9, 0x05D1, 0},  // university
+    {0x05D7, 0x05D5, 0x05E3, 0, 0, 0},            // beach
+    {0x05E6, 0x05E4, 0x05D5, 0x05DF, 0, 0},       // north
+    {0x05D3, 0x05E8, 0x05D5, 0x05DD, 0, 0},       // south
+    {0x05E2, 0x05D9, 0x05E8, 0, 0, 0},            // city
+    {0x05E8, 0x05DB, 0x05D1, 0x05EA, 0, 0},       // rail
+};
+
+static std::string hebrew_word(uint32_t index) {
+  std::string out;
+  for (uint32_t codepoint : RTL_WORDS[index % 8]) {
+    if (codepoint == 0) {
+      break;
+    }
+    out += utf8(codepoint);
+  }
+  return out;
+}
+
+std::string make_headsign(uint32_t index, bool rtl, bool long_headsign) {
+  std::string headsign;
+  if (!rtl) {
+    headsign = LTR_HEADSIGNS[index % 8];
+    if (long_headsign) {
+      headsign += LTR_SUFFIXES[index % 2];
+    }
+    return headsign;
+  }
+
+  int words = long_headsign ? 9 : 2;
+  for (int i = 0; i < words; i++) {
+    if (i > 0) {
+      // A maqaf now and then, and a number, as real Israeli headsigns have
+      headsign += i % 4 == 3 ? utf8(0x05BE) : " ";
+    }
+    headsign += hebrew_word(index + i * 3);
+  }
+  if (long_headsign) {
+    headsign += " " + std::to_string(index % 40 + 1);
+  }
+  return headsign;
+}
+
+std::string make_schedule_data(const ScheduleOptions &options) {
+  std::string json = "{";
+  if (options.seq >= 0) {
+    json += "\"seq\":" + std::to_string(options.seq) + ",";
+  }
+  json += "\"trips\":[";
+
+  for (int i = 0; i < options.trips; i++) {
+    uint32_t index = options.variant + i;
+    int route = index % options.routes;
+    time_t arrival = options.now + options.first_in + i * options.spacing + options.variant % 7 * 10;
+
+    char route_name[16];
+    if (options.rtl) {
+      snprintf(route_name, sizeof(route_name), "%d", 100 + route * 7);
+    } else {
+      snprintf(route_name, sizeof(route_name), "%c%d", 'A' + route, route + 1);
+    }
+
+    char trip[512];
+    snprintf(trip, sizeof(trip),
+             "%s{\"tripId\":\"trip-%" PRIu32 "\",\"headsign\":\"%s\",\"routeId\":\"route-%d\","
+             "\"routeName\":\"%s\",\"routeColor\":\"%06X\",\"arrivalTime\":%lld,\"departureTime\":%lld,"
+             "\"isRealtime\":%s}",
+             i > 0 ? "," : "", index, make_headsign(index, options.rtl, options.long_headsigns).c_str(), route,
+             route_name, (0x3366CC * (route + 1)) & 0xFFFFFF, (long long) arrival, (long long) arrival + 30,
+             index % 3 == 0 ? "false" : "true");
+    json += trip;
+  }
+
+  json += "]}";
+  return json;
+}
+
+std::string make_schedule_message(const ScheduleOptions &options) {
+  return "{\"event\":\"schedule\",\"data\":" + make_schedule_data(options) + "}";
+}
+
+}  // namespace host
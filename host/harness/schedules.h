@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace host {
+
+struct ScheduleOptions {
+  int trips = 3;
+  // Hebrew headsigns and route names instead of English ones
+  bool rtl = false;
+  // Headsigns several times wider than the panel, so they scroll
+  bool long_headsigns = false;
+  // Departures start this many seconds after `now`, one every `spacing`
+  time_t now = 1700000000;
+  int first_in = 120;
+  int spacing = 240;
+  int routes = 4;
+  // Varies headsigns and times between otherwise identical schedules
+  uint32_t variant = 0;
+  // Adds a seq field, for servers that send patches after it
+  int64_t seq = -1;
+};
+
+// The data object of a "schedule" event
+std::string make_schedule_data(const ScheduleOptions &options);
+// A whole {"event":"schedule","data":...} message
+std::string make_schedule_message(const ScheduleOptions &options);
+
+std::string make_headsign(uint32_t index, bool rtl, bool long_headsign);
+
+}  // namespace host
@@ -0,0 +1,136 @@
+#include "synthetic_font.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace host {
+
+std::string utf8(uint32_t codepoint) {
+  std::string out;
+  if (codepoint < 0x80) {
+    out += char(codepoint);
+  } else if (codepoint < 0x800) {
+    out += char(0xC0 | (codepoint >> 6));
+    out += char(0x80 | (codepoint & 0x3F));
+  } else if (codepoint < 0x10000) {
+    out += char(0xE0 | (codepoint >> 12));
+    out += char(0x80 | ((codepoint >> 6) & 0x3F));
+    out += char(0x80 | (codepoint & 0x3F));
+  } else {
+    out += char(0xF0 | (codepoint >> 18));
+    out += char(0x80 | ((codepoint >> 12) & 0x3F));
+    out += char(0x80 | ((codepoint >> 6) & 0x3F));
+    out += char(0x80 | (codepoint & 0x3F));
+  }
+  return out;
+}
+
+static uint32_t mix(uint32_t value) {
+  value ^= value >> 16;
+  value *= 0x7feb352d;
+  value ^= value >> 15;
+  value *= 0x846ca68b;
+  value ^= value >> 16;
+  return value;
+}
+
+static bool has_descender(uint32_t codepoint) {
+  switch (codepoint) {
+    case 'g':
+    case 'j':
+    case 'p':
+    case 'q':
+    case 'y':
+    case ',':
+    case 0x05DA:  // final kaf
+    case 0x05DF:  // final nun
+    case 0x05E3:  // final pe
+    case 0x05E5:  // final tsadi
+    case 0x05E7:  // qof
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Narrow glyphs sit right of the pen position, like most proportional fonts
+static int glyph_offset_x(uint32_t codepoint) {
+  switch (codepoint) {
+    case 'i':
+    case 'l':
+    case '1':
+    case '!':
+    case '\'':
+    case 0x05D5:  // vav
+    case 0x05D9:  // yod
+      return 1;
+    case 'j':
+      return -1;
+    default:
+      return 0;
+  }
+}
+
+SyntheticFont::SyntheticFont(int size, uint8_t bpp) : size_(size), bpp_(bpp) {
+  std::vector<uint32_t> codepoints;
+  for (uint32_t codepoint = 0x20; codepoint <= 0x7E; codepoint++) {
+    codepoints.push_back(codepoint);
+  }
+  codepoints.push_back(0x05BE);  // maqaf
+  for (uint32_t codepoint = 0x05D0; codepoint <= 0x05EA; codepoint++) {
+    codepoints.push_back(codepoint);
+  }
+
+  // Code point order is UTF-8 byte order, which the glyph search relies on
+  this->chars_.reserve(codepoints.size());
+  this->bitmaps_.reserve(codepoints.size());
+  this->glyphs_.reserve(codepoints.size());
+  for (uint32_t codepoint : codepoints) {
+    this->add_glyph_(codepoint);
+  }
+
+  int descender = (size + 3) / 4;
+  int height = size + descender;
+  this->font_ = std::make_unique<esphome::font::Font>(this->glyphs_.data(), this->glyphs_.size(), size, height,
+                                                      descender, size * 5 / 8, size, bpp);
+}
+
+void SyntheticFont::add_glyph_(uint32_t codepoint) {
+  int descender = (this->size_ + 3) / 4;
+  bool narrow = glyph_offset_x(codepoint) != 0;
+  int width = codepoint == ' ' ? 0 : (narrow ? 1 : 3 + mix(codepoint) % 3) * this->size_ / 8;
+  if (codepoint != ' ' && width == 0) {
+    width = 1;
+  }
+
+  int top = codepoint < 0x80 && islower(codepoint) ? this->size_ * 3 / 8 : 0;
+  int height = codepoint == ' ' ? 0 : this->size_ - top + (has_descender(codepoint) ? descender : 0);
+  int advance = std::max(width + glyph_offset_x(codepoint), 0) + 1;
+  if (codepoint == ' ') {
+    advance = this->size_ * 3 / 8;
+  }
+
+  size_t bits = size_t(width) * height * this->bpp_;
+  std::vector<uint8_t> bitmap((bits + 7) / 8);
+  uint32_t max_value = (1u << this->bpp_) - 1;
+  size_t bit = 0;
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      uint32_t value = mix(codepoint * 7919 + y * 131 + x) % (max_value + 2);
+      value = std::min(value, max_value);
+      // Pixels packed MSB first, rows back to back
+      for (int b = this->bpp_ - 1; b >= 0; b--, bit++) {
+        if ((value >> b) & 1) {
+          bitmap[bit / 8] |= 0x80 >> (bit % 8);
+        }
+      }
+    }
+  }
+
+  this->chars_.push_back(utf8(codepoint));
+  this->bitmaps_.push_back(std::move(bitmap));
+  this->glyphs_.emplace_back(this->chars_.back().c_str(), this->bitmaps_.back().data(), advance,
+                             glyph_offset_x(codepoint), top, width, height);
+}
+
+}  // namespace host
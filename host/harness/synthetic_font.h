@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "esphome/components/font/font.h"
+
+namespace host {
+
+// A generated bitmap font covering printable ASCII and the Hebrew letters, in
+// the layout ESPHome's font codegen emits. Glyph pixels are pseudo-random but
+// fixed, and a few glyphs have a non-zero offset_x, so the rendering paths
+// that honour the font's x_offset are exercised.
+class SyntheticFont {
+  public:
+    // `size` is the ascender in pixels; 8 matches the 5x8-ish fonts the panel
+    // usually runs, larger sizes give proportionally larger glyphs
+    explicit SyntheticFont(int size = 8, uint8_t bpp = 1);
+    SyntheticFont(const SyntheticFont &) = delete;
+    SyntheticFont &operator=(const SyntheticFont &) = delete;
+
+    esphome::font::Font *get() { return this->font_.get(); }
+    size_t glyph_count() const { return this->glyphs_.size(); }
+
+  protected:
+    void add_glyph_(uint32_t codepoint);
+
+    int size_;
+    uint8_t bpp_;
+    // Glyphs point into these, so they are filled before the font is built
+    std::vector<std::string> chars_;
+    std::vector<std::vector<uint8_t>> bitmaps_;
+    std::vector<esphome::font::Glyph> glyphs_;
+    std::unique_ptr<esphome::font::Font> font_;
+};
+
+// Encodes a code point as UTF-8
+std::string utf8(uint32_t codepoint);
+
+}  // namespace host
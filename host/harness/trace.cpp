@@ -0,0 +1,164 @@
+#include "trace.h"
+
+#include <fstream>
+
+#include <ArduinoJson.h>
+
+#include "host/encoding.h"
+
+namespace host {
+
+static std::string format_event(const TraceEvent &event) {
+  char kind = 't';
+  std::string payload = event.payload;
+  if (event.binary) {
+    kind = 'b';
+    payload = base64_encode(payload);
+  } else if (payload.find_first_of("\r\n") != std::string::npos) {
+    kind = 'T';
+    payload = base64_encode(payload);
+  }
+  return std::to_string(event.at_ms) + "\t" + kind + "\t" + payload + "\n";
+}
+
+bool load_trace(const std::string &path, Trace *trace, std::string *error) {
+  std::ifstream in(path);
+  if (!in) {
+    *error = "cannot open " + path;
+    return false;
+  }
+
+  trace->epoch = 0;
+  trace->events.clear();
+
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    line_number++;
+    if (line.empty()) {
+      continue;
+    }
+    if (line[0] == '#') {
+      if (line.compare(0, 8, "# epoch ") == 0) {
+        trace->epoch = std::stoll(line.substr(8));
+      }
+      continue;
+    }
+
+    size_t first_tab = line.find('\t');
+    size_t second_tab = first_tab == std::string::npos ? first_tab : line.find('\t', first_tab + 1);
+    if (second_tab != first_tab + 2) {
+      *error = path + ":" + std::to_string(line_number) + ": expected <ms>\\t<kind>\\t<payload>";
+      return false;
+    }
+
+    TraceEvent event;
+    event.at_ms = std::stoul(line.substr(0, first_tab));
+    char kind = line[first_tab + 1];
+    std::string payload = line.substr(second_tab + 1);
+    event.binary = kind == 'b';
+    bool valid = kind == 't' || kind == 'T' || kind == 'b';
+    if (kind == 't') {
+      event.payload = std::move(payload);
+    } else if (valid) {
+      valid = base64_decode(payload, &event.payload);
+    }
+    if (!valid) {
+      *error = path + ":" + std::to_string(line_number) + ": bad payload";
+      return false;
+    }
+
+    if (!trace->events.empty() && event.at_ms < trace->events.back().at_ms) {
+      *error = path + ":" + std::to_string(line_number) + ": events out of order";
+      return false;
+    }
+    trace->events.push_back(std::move(event));
+  }
+
+  return true;
+}
+
+bool save_trace(const std::string &path, const Trace &trace) {
+  TraceWriter writer;
+  if (!writer.open(path, trace.epoch)) {
+    return false;
+  }
+  for (const TraceEvent &event : trace.events) {
+    writer.write(event);
+  }
+  return true;
+}
+
+TraceWriter::~TraceWriter() { this->close(); }
+
+bool TraceWriter::open(const std::string &path, time_t epoch) {
+  this->close();
+  this->file_ = fopen(path.c_str(), "w");
+  if (this->file_ == nullptr) {
+    return false;
+  }
+  fprintf(this->file_, "# transit-tracker trace v1\n# epoch %lld\n", static_cast<long long>(epoch));
+  return true;
+}
+
+void TraceWriter::write(const TraceEvent &event) {
+  std::string line = format_event(event);
+  fwrite(line.data(), 1, line.size(), this->file_);
+  fflush(this->file_);
+}
+
+void TraceWriter::close() {
+  if (this->file_ != nullptr) {
+    fclose(this->file_);
+    this->file_ = nullptr;
+  }
+}
+
+TraceEvent encode_event(const TraceEvent &event, bool msgpack) {
+  if (event.binary == msgpack) {
+    return event;
+  }
+
+  JsonDocument doc;
+  DeserializationError error =
+      event.binary ? deserializeMsgPack(doc, event.payload) : deserializeJson(doc, event.payload);
+  if (error) {
+    return event;
+  }
+
+  TraceEvent encoded{event.at_ms, msgpack, ""};
+  if (msgpack) {
+    serializeMsgPack(doc, encoded.payload);
+  } else {
+    serializeJson(doc, encoded.payload);
+  }
+  return encoded;
+}
+
+std::string event_name(const TraceEvent &event) {
+  if (event.binary) {
+    // MessagePack maps spell out their keys too
+    size_t key = event.payload.find("event");
+    if (key == std::string::npos || key + 6 >= event.payload.size()) {
+      return "";
+    }
+    uint8_t header = static_cast<uint8_t>(event.payload[key + 5]);
+    if ((header & 0xE0) != 0xA0) {
+      return "";
+    }
+    return event.payload.substr(key + 6, header & 0x1F);
+  }
+
+  size_t key = event.payload.find("\"event\"");
+  if (key == std::string::npos) {
+    return "";
+  }
+  size_t start = event.payload.find('"', event.payload.find(':', key) + 1);
+  size_t end = start == std::string::npos ? start : event.payload.find('"', start + 1);
+  if (end == std::string::npos) {
+    return "";
+  }
+  return event.payload.substr(start + 1, end - start - 1);
+}
+
+}  // namespace host
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace host {
+
+// Messages a server sent, with their arrival times. On disk, one message per
+// line:
+//
+//   # transit-tracker trace v1
+//   # epoch 1700000000
+//   <ms since start>\t<kind>\t<payload>
+//
+// where kind is `t` for a text message stored as is, `T` for a text message
+// stored in base64 because it spans lines, and `b` for a binary (MessagePack)
+// message in base64. The epoch is the wall clock at the start, which replays
+// set the RTC to so that trip times stay in the future.
+struct TraceEvent {
+  uint32_t at_ms;
+  bool binary;
+  std::string payload;
+};
+
+struct Trace {
+  time_t epoch = 0;
+  std::vector<TraceEvent> events;
+
+  uint32_t duration_ms() const { return this->events.empty() ? 0 : this->events.back().at_ms; }
+};
+
+bool load_trace(const std::string &path, Trace *trace, std::string *error);
+bool save_trace(const std::string &path, const Trace &trace);
+
+// Appends events as they arrive, flushing each, so a recording that is cut
+// short still leaves a usable trace
+class TraceWriter {
+  public:
+    ~TraceWriter();
+    bool open(const std::string &path, time_t epoch);
+    void write(const TraceEvent &event);
+    void close();
+
+  protected:
+    FILE *file_ = nullptr;
+};
+
+// The event name of a JSON message, found without parsing it
+std::string event_name(const TraceEvent &event);
+
+// The event as MessagePack (binary) or JSON (text), as a server sends it to a
+// subscriber that asked for that encoding. Payloads that don't parse are
+// passed through as they are.
+TraceEvent encode_event(const TraceEvent &event, bool msgpack);
+
+}  // namespace host
@@ -0,0 +1,67 @@
+#include "tracker_fixture.h"
+
+#include "esphome/core/application.h"
+#include "host/runtime.h"
+
+namespace host {
+
+using esphome::App;
+
+TrackerFixture::TrackerFixture(const TrackerOptions &options)
+    : options(options), display(options.width, options.height), font(options.font_size, options.font_bpp) {
+  this->rtc.set_timezone("UTC0");
+
+  this->hub.set_base_url(options.base_url);
+
+  this->tracker.set_display(&this->display);
+  this->tracker.set_font(this->font.get());
+  this->tracker.set_rtc(&this->rtc);
+  this->tracker.set_hub(&this->hub);
+  this->tracker.set_schedule_string("1_100;1_200");
+  this->tracker.set_limit(options.limit);
+  this->tracker.set_rtl_mode(options.rtl);
+  this->tracker.set_scroll_headsigns(options.scroll_headsigns);
+  this->tracker.set_display_departure_times(options.display_departure_times);
+  this->tracker.set_persist_schedule(options.persist_schedule);
+  this->tracker.set_list_mode("sequential");
+
+  App.register_component(&this->rtc);
+  if (options.start_hub) {
+    App.register_component(&this->hub);
+  }
+  App.register_component(&this->tracker);
+}
+
+TrackerFixture::~TrackerFixture() {
+  // Already run by a reboot
+  if (!App.is_reboot_requested()) {
+    App.run_safe_shutdown_hooks();
+  }
+  stop_tasks();
+  App.reset();
+}
+
+void TrackerFixture::setup() {
+  if (this->options.now != 0) {
+    this->rtc.host_synchronize(this->options.now);
+  }
+  App.setup();
+}
+
+bool TrackerFixture::deliver(const std::string &message) {
+  JsonDocument doc;
+  if (deserializeJson(doc, message)) {
+    return false;
+  }
+
+  const char *event = doc["event"] | "";
+  this->tracker.on_hub_message(event, doc["data"].as<JsonObject>(), message.size(), 0);
+  return true;
+}
+
+void TrackerFixture::draw() {
+  this->display.clear();
+  this->tracker.draw_schedule();
+}
+
+}  // namespace host
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <ctime>
+#include <memory>
+#include <string>
+
+#include "connection_hub.h"
+#include "transit_tracker.h"
+#include "framebuffer.h"
+#include "synthetic_font.h"
+
+namespace host {
+
+struct TrackerOptions {
+  int width = 128;
+  int height = 32;
+  int font_size = 8;
+  uint8_t font_bpp = 1;
+  int limit = 3;
+  bool rtl = false;
+  bool scroll_headsigns = false;
+  bool display_departure_times = false;
+  bool persist_schedule = false;
+  // Empty keeps the hub idle; render benchmarks feed messages directly
+  std::string base_url = "ws://127.0.0.1:9/";
+  // Registers the hub with App, so App.setup() starts connecting
+  bool start_hub = false;
+  // Synchronizes the RTC to this time at setup; 0 leaves it unsynchronized
+  time_t now = 1700000000;
+};
+
+// One tracker wired to a framebuffer, a synthetic font, an RTC and a hub, as
+// the generated main.cpp does on the device. The destructor stops the hub's
+// tasks and resets App, so fixtures can be created one after another.
+class TrackerFixture {
+  public:
+    explicit TrackerFixture(const TrackerOptions &options = {});
+    ~TrackerFixture();
+    TrackerFixture(const TrackerFixture &) = delete;
+    TrackerFixture &operator=(const TrackerFixture &) = delete;
+
+    // Runs App.setup()
+    void setup();
+
+    // Parses a whole {"event":...,"data":...} message and hands it to the
+    // tracker, as the hub does once a message is decoded
+    bool deliver(const std::string &message);
+
+    // Draws a frame into a cleared framebuffer
+    void draw();
+
+    TrackerOptions options;
+    FramebufferDisplay display;
+    SyntheticFont font;
+    esphome::time::RealTimeClock rtc;
+    esphome::transit_tracker::ConnectionHub hub;
+    esphome::transit_tracker::TransitTracker tracker;
+};
+
+}  // namespace host
@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for the Arduino core: only the String class, which
+// ArduinoWebsockets exposes in its event callbacks.
+
+#include <cstddef>
+#include <string>
+
+class String {
+  public:
+    String() = default;
+    String(const char *str) : value_(str == nullptr ? "" : str) {}
+    String(const std::string &str) : value_(str) {}
+
+    const char *c_str() const { return this->value_.c_str(); }
+    unsigned int length() const { return this->value_.length(); }
+    bool isEmpty() const { return this->value_.empty(); }
+
+    bool operator==(const String &other) const { return this->value_ == other.value_; }
+    bool operator!=(const String &other) const { return this->value_ != other.value_; }
+    String &operator+=(const String &other) {
+      this->value_ += other.value_;
+      return *this;
+    }
+
+  protected:
+    std::string value_;
+};
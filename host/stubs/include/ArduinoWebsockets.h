@@ -0,0 +1,111 @@
+#pragma once
+
+// Host stand-in for ArduinoWebsockets over plain TCP sockets (ws:// only).
+// Like the library, connect() blocks through the TCP connect and upgrade,
+// poll() reads whatever has arrived and dispatches it, pings are answered with
+// pongs automatically, and close() reports ConnectionClosed.
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+
+#include "Arduino.h"
+
+namespace websockets {
+
+using WSString = std::string;
+using WSInterfaceString = String;
+
+enum class MessageType { Empty, Text, Binary, Ping, Pong, Close };
+
+enum class WebsocketsEvent { ConnectionOpened, ConnectionClosed, GotPing, GotPong };
+
+class WebsocketsMessage {
+  public:
+    WebsocketsMessage() = default;
+    WebsocketsMessage(MessageType type, WSString data) : type_(type), data_(std::move(data)) {}
+
+    bool isText() const { return this->type_ == MessageType::Text; }
+    bool isBinary() const { return this->type_ == MessageType::Binary; }
+    bool isEmpty() const { return this->type_ == MessageType::Empty; }
+    MessageType type() const { return this->type_; }
+
+    WSInterfaceString data() const { return WSInterfaceString(this->data_); }
+    const WSString &rawData() const { return this->data_; }
+    size_t length() const { return this->data_.length(); }
+    const char *c_str() const { return this->data_.c_str(); }
+
+  protected:
+    MessageType type_ = MessageType::Empty;
+    WSString data_;
+};
+
+class WebsocketsClient;
+
+using MessageCallback = std::function<void(WebsocketsClient &, WebsocketsMessage)>;
+using PartialMessageCallback = std::function<void(WebsocketsMessage)>;
+using EventCallback = std::function<void(WebsocketsClient &, WebsocketsEvent, WSInterfaceString)>;
+using PartialEventCallback = std::function<void(WebsocketsEvent, WSInterfaceString)>;
+
+class WebsocketsClient {
+  public:
+    WebsocketsClient() = default;
+    WebsocketsClient(const WebsocketsClient &) = delete;
+    WebsocketsClient &operator=(const WebsocketsClient &) = delete;
+    ~WebsocketsClient();
+
+    bool connect(const WSInterfaceString &url);
+    bool connect(const char *url) { return this->connect(WSInterfaceString(url)); }
+
+    void onMessage(const MessageCallback &callback) { this->message_callback_ = callback; }
+    void onMessage(const PartialMessageCallback &callback) {
+      this->message_callback_ = [callback](WebsocketsClient &, WebsocketsMessage message) {
+        callback(std::move(message));
+      };
+    }
+    void onEvent(const EventCallback &callback) { this->event_callback_ = callback; }
+    void onEvent(const PartialEventCallback &callback) {
+      this->event_callback_ = [callback](WebsocketsClient &, WebsocketsEvent event, WSInterfaceString data) {
+        callback(event, std::move(data));
+      };
+    }
+
+    // Returns whether anything was processed
+    bool poll();
+    bool available() const { return this->connected_; }
+
+    bool send(const WSString &data) { return this->send_frame_(0x1, data); }
+    bool send(const char *data) { return this->send_frame_(0x1, data); }
+    bool sendBinary(const WSString &data) { return this->send_frame_(0x2, data); }
+    bool ping(const WSString &data = "") { return this->send_frame_(0x9, data); }
+    void close();
+
+    // Bytes buffered but not yet dispatched, for tests
+    size_t host_buffered() const { return this->buffer_.size(); }
+
+  protected:
+    bool handshake_(const std::string &host, const std::string &path);
+    bool send_frame_(uint8_t opcode, const WSString &data);
+    bool send_raw_(const std::string &data);
+    // Parses one frame from buffer_; false when it is incomplete
+    bool dispatch_frame_();
+    void closed_();
+    void emit_(WebsocketsEvent event, const WSString &data = "");
+
+    MessageCallback message_callback_;
+    EventCallback event_callback_;
+
+    // Guards fd_ against close() racing a blocked connect() on another task
+    std::mutex socket_mutex_;
+    std::mutex send_mutex_;
+    std::atomic<int> fd_{-1};
+    std::atomic<bool> connected_{false};
+    std::string buffer_;
+    // Fragments of a message split across continuation frames
+    std::string fragments_;
+    MessageType fragments_type_ = MessageType::Empty;
+};
+
+}  // namespace websockets
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "esphome/core/color.h"
+#include "esphome/core/component.h"
+
+namespace esphome {
+namespace display {
+
+enum class TextAlign {
+  TOP = 0x00,
+  CENTER_VERTICAL = 0x01,
+  BASELINE = 0x02,
+  BOTTOM = 0x04,
+
+  LEFT = 0x00,
+  CENTER_HORIZONTAL = 0x08,
+  RIGHT = 0x10,
+
+  TOP_LEFT = TOP | LEFT,
+  TOP_CENTER = TOP | CENTER_HORIZONTAL,
+  TOP_RIGHT = TOP | RIGHT,
+
+  CENTER_LEFT = CENTER_VERTICAL | LEFT,
+  CENTER = CENTER_VERTICAL | CENTER_HORIZONTAL,
+  CENTER_RIGHT = CENTER_VERTICAL | RIGHT,
+
+  BASELINE_LEFT = BASELINE | LEFT,
+  BASELINE_CENTER = BASELINE | CENTER_HORIZONTAL,
+  BASELINE_RIGHT = BASELINE | RIGHT,
+
+  BOTTOM_LEFT = BOTTOM | LEFT,
+  BOTTOM_CENTER = BOTTOM | CENTER_HORIZONTAL,
+  BOTTOM_RIGHT = BOTTOM | RIGHT,
+};
+
+enum DisplayType {
+  DISPLAY_TYPE_BINARY = 1,
+  DISPLAY_TYPE_GRAYSCALE = 2,
+  DISPLAY_TYPE_COLOR = 3,
+};
+
+/// Turn the pixel OFF.
+extern const Color COLOR_OFF;
+/// Turn the pixel ON.
+extern const Color COLOR_ON;
+
+static const int16_t VALUE_NO_SET = 32766;
+
+class Rect {
+  public:
+    int16_t x;
+    int16_t y;
+    int16_t w;
+    int16_t h;
+
+    Rect() : x(VALUE_NO_SET), y(VALUE_NO_SET), w(VALUE_NO_SET), h(VALUE_NO_SET) {}
+    Rect(int16_t x, int16_t y, int16_t w, int16_t h) : x(x), y(y), w(w), h(h) {}
+
+    int16_t x2() const { return this->x + this->w; }
+    int16_t y2() const { return this->y + this->h; }
+    bool is_set() const { return this->h != VALUE_NO_SET && this->w != VALUE_NO_SET; }
+
+    void shrink(Rect rect);
+    bool inside(int16_t test_x, int16_t test_y) const;
+};
+
+class Display;
+
+class BaseFont {
+  public:
+    virtual ~BaseFont() = default;
+    virtual void print(int x, int y, Display *display, Color color, const char *text, Color background) = 0;
+    virtual void measure(const char *str, int *width, int *x_offset, int *baseline, int *height) = 0;
+};
+
+// The subset of ESPHome's Display used by the tracker. Text placement
+// follows get_text_bounds() exactly; clipping is tracked here but, as on the
+// device, applied by the buffer implementation in draw_pixel_at().
+class Display : public PollingComponent {
+  public:
+    void fill(Color color);
+    void clear() { this->fill(COLOR_OFF); }
+
+    virtual void draw_pixel_at(int x, int y, Color color) = 0;
+    void filled_rectangle(int x1, int y1, int width, int height, Color color = COLOR_ON);
+
+    int get_width() { return this->get_width_internal(); }
+    int get_height() { return this->get_height_internal(); }
+
+    void print(int x, int y, BaseFont *font, Color color, TextAlign align, const char *text,
+               Color background = COLOR_OFF);
+    void print(int x, int y, BaseFont *font, Color color, const char *text, Color background = COLOR_OFF);
+    void print(int x, int y, BaseFont *font, TextAlign align, const char *text);
+    void print(int x, int y, BaseFont *font, const char *text);
+
+    void get_text_bounds(int x, int y, const char *text, BaseFont *font, TextAlign align, int *x1, int *y1,
+                         int *width, int *height);
+
+    void start_clipping(Rect rect);
+    void start_clipping(int16_t left, int16_t top, int16_t right, int16_t bottom) {
+      this->start_clipping(Rect(left, top, right - left, bottom - top));
+    }
+    void end_clipping();
+    Rect get_clipping() const;
+    bool is_clipping() const { return !this->clipping_rectangle_.empty(); }
+
+    virtual DisplayType get_display_type() = 0;
+
+  protected:
+    virtual int get_height_internal() = 0;
+    virtual int get_width_internal() = 0;
+
+    std::vector<Rect> clipping_rectangle_;
+};
+
+}  // namespace display
+}  // namespace esphome
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "esphome/components/display/display.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+namespace font {
+
+class Glyph {
+  public:
+    constexpr Glyph(const char *a_char, const uint8_t *data, int advance, int offset_x, int offset_y, int width,
+                    int height)
+        : a_char(a_char), data(data), advance(advance), offset_x(offset_x), offset_y(offset_y), width(width),
+          height(height) {}
+
+    const uint8_t *get_char() const { return reinterpret_cast<const uint8_t *>(this->a_char); }
+    bool compare_to(const uint8_t *str) const;
+    int match_length(const uint8_t *str) const;
+    void scan_area(int *x1, int *y1, int *width, int *height) const;
+
+    const char *a_char;
+    const uint8_t *data;
+    int advance;
+    int offset_x;
+    int offset_y;
+    int width;
+    int height;
+};
+
+// ESPHome's bitmap font: glyphs sorted by their UTF-8 string, pixels packed
+// MSB first at `bpp` bits each. measure() and print() follow the device
+// implementation, and count their calls for the benchmarks.
+class Font : public display::BaseFont {
+  public:
+    Font(const Glyph *data, int data_nr, int baseline, int height, int descender, int xheight, int capheight,
+         uint8_t bpp = 1);
+
+    int match_next_glyph(const uint8_t *str, int *match_length);
+
+    void print(int x_start, int y_start, display::Display *display, Color color, const char *text,
+               Color background) override;
+    void measure(const char *str, int *width, int *x_offset, int *baseline, int *height) override;
+
+    int get_baseline() { return this->baseline_; }
+    int get_height() { return this->height_; }
+    int get_ascender() { return this->baseline_; }
+    int get_descender() { return this->descender_; }
+    int get_linegap() { return this->linegap_; }
+    int get_xheight() { return this->xheight_; }
+    int get_capheight() { return this->capheight_; }
+    int get_bpp() { return this->bpp_; }
+
+    const std::vector<Glyph, RAMAllocator<Glyph>> &get_glyphs() const { return glyphs_; }
+
+    uint32_t host_measure_calls() const { return this->measure_calls_; }
+    uint32_t host_print_calls() const { return this->print_calls_; }
+    void host_reset_counters() {
+      this->measure_calls_ = 0;
+      this->print_calls_ = 0;
+    }
+
+  protected:
+    std::vector<Glyph, RAMAllocator<Glyph>> glyphs_;
+    int baseline_;
+    int height_;
+    int descender_;
+    int linegap_;
+    int xheight_;
+    int capheight_;
+    uint8_t bpp_;
+
+    uint32_t measure_calls_ = 0;
+    uint32_t print_calls_ = 0;
+};
+
+}  // namespace font
+}  // namespace esphome
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+namespace http_request {
+
+struct Header {
+  std::string name;
+  std::string value;
+};
+
+class HttpRequestComponent;
+
+class HttpContainer : public Parented<HttpRequestComponent> {
+  public:
+    virtual ~HttpContainer() = default;
+    size_t content_length;
+    int status_code;
+    uint32_t duration_ms;
+
+    virtual int read(uint8_t *buf, size_t max_len) = 0;
+    virtual void end() = 0;
+
+    void set_secure(bool secure) { this->secure_ = secure; }
+    size_t get_bytes_read() const { return this->bytes_read_; }
+
+    std::map<std::string, std::list<std::string>> get_response_headers() { return this->response_headers_; }
+    std::string get_response_header(const std::string &header_name);
+
+  protected:
+    size_t bytes_read_{0};
+    bool secure_{false};
+    std::map<std::string, std::list<std::string>> response_headers_{};
+};
+
+// Requests go to perform(), which tests implement to serve canned responses
+class HttpRequestComponent : public Component {
+  public:
+    std::shared_ptr<HttpContainer> get(const std::string &url) { return this->start(url, "GET", "", {}, {}); }
+    std::shared_ptr<HttpContainer> get(const std::string &url, const std::list<Header> &request_headers) {
+      return this->start(url, "GET", "", request_headers, {});
+    }
+    std::shared_ptr<HttpContainer> get(const std::string &url, const std::list<Header> &request_headers,
+                                       const std::set<std::string> &collect_headers) {
+      return this->start(url, "GET", "", request_headers, collect_headers);
+    }
+
+    std::shared_ptr<HttpContainer> start(const std::string &url, const std::string &method, const std::string &body,
+                                         const std::list<Header> &request_headers,
+                                         const std::set<std::string> &collect_headers) {
+      return this->perform(url, method, body, request_headers, collect_headers);
+    }
+
+  protected:
+    virtual std::shared_ptr<HttpContainer> perform(std::string url, std::string method, std::string body,
+                                                   std::list<Header> request_headers,
+                                                   std::set<std::string> collect_headers) = 0;
+};
+
+}  // namespace http_request
+}  // namespace esphome
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <ArduinoJson.h>
+
+namespace esphome {
+namespace json {
+
+using json_parse_t = std::function<bool(JsonObject)>;
+using json_build_t = std::function<void(JsonObject)>;
+
+std::string build_json(const json_build_t &f);
+bool parse_json(const std::string &data, const json_parse_t &f);
+
+}  // namespace json
+}  // namespace esphome
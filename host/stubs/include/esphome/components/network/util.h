@@ -0,0 +1,10 @@
+#pragma once
+
+namespace esphome {
+namespace network {
+
+// Set with host::set_network_connected(); connected by default
+bool is_connected();
+
+}  // namespace network
+}  // namespace esphome
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/time.h"
+
+namespace esphome {
+namespace time {
+
+// Counts from 1970 like an unsynchronized device clock until
+// host_synchronize() sets it, as SNTP would; from then on it advances with
+// the host clock. Sync callbacks run inside host_synchronize(), where SNTP
+// would run them from its loop().
+class RealTimeClock : public PollingComponent {
+  public:
+    explicit RealTimeClock() = default;
+
+    void set_timezone(const std::string &tz);
+
+    ESPTime now() { return ESPTime::from_epoch_local(this->timestamp_now()); }
+    ESPTime utcnow() { return ESPTime::from_epoch_utc(this->timestamp_now()); }
+
+    void update() override {}
+
+    void add_on_time_sync_callback(std::function<void()> callback) { this->time_sync_callbacks_.push_back(std::move(callback)); }
+
+    void host_synchronize(time_t epoch);
+    // Back to unsynchronized, as after a reboot
+    void host_reset();
+
+  protected:
+    time_t timestamp_now();
+
+    bool synchronized_ = false;
+    time_t epoch_ = 0;
+    uint32_t synchronized_at_ = 0;
+    std::vector<std::function<void()>> time_sync_callbacks_;
+};
+
+}  // namespace time
+}  // namespace esphome
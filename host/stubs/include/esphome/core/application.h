@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "esphome/core/component.h"
+
+namespace esphome {
+
+// Timers for every component. Items may be added from any thread; callbacks
+// run on whichever thread calls call(), without the lock held.
+class Scheduler {
+  public:
+    void set_timeout(Component *component, const std::string &name, uint32_t timeout, std::function<void()> func);
+    bool cancel_timeout(Component *component, const std::string &name);
+    void set_interval(Component *component, const std::string &name, uint32_t interval, std::function<void()> func);
+    bool cancel_interval(Component *component, const std::string &name);
+
+    // Runs everything that is due
+    void call();
+    // Milliseconds until the next item is due, or SCHEDULER_DONT_RUN
+    uint32_t next_schedule_in();
+    void clear();
+
+  protected:
+    enum Type : uint8_t { TIMEOUT, INTERVAL };
+
+    struct Item {
+      Component *component;
+      std::string name;
+      Type type;
+      uint32_t next;
+      uint32_t interval;
+      std::function<void()> func;
+      bool removed = false;
+    };
+
+    bool cancel_(Component *component, const std::string &name, Type type);
+
+    std::mutex lock_;
+    std::list<Item> items_;
+};
+
+namespace host {
+// Thrown by App.reboot(); App.loop() catches it and stops running components
+struct RebootRequested {};
+}  // namespace host
+
+class Application {
+  public:
+    void register_component(Component *component);
+    void setup();
+    void loop();
+
+    // Never returns on the device. On the host it unwinds to App.loop(), which
+    // records the request, so tests can assert on it.
+    [[noreturn]] void reboot();
+    [[noreturn]] void safe_reboot() { this->reboot(); }
+    // Calls on_shutdown() on every component, in reverse order of setup
+    void run_safe_shutdown_hooks();
+    void feed_wdt() {}
+
+    const std::string &get_name() const { return this->name_; }
+
+    bool is_reboot_requested() const { return this->reboot_requested_; }
+    // Forgets every component, timer and reboot request, as on boot
+    void reset();
+
+    Scheduler scheduler;
+
+  protected:
+    std::string name_ = "transit-tracker-host";
+    std::vector<Component *> components_;
+    bool reboot_requested_ = false;
+};
+
+extern Application App;
+
+}  // namespace esphome
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace esphome {
+
+struct Color {
+  union {
+    struct {
+      union {
+        uint8_t r;
+        uint8_t red;
+      };
+      union {
+        uint8_t g;
+        uint8_t green;
+      };
+      union {
+        uint8_t b;
+        uint8_t blue;
+      };
+      union {
+        uint8_t w;
+        uint8_t white;
+      };
+    };
+    uint8_t raw[4];
+    uint32_t raw_32;
+  };
+
+  constexpr Color() : r(0), g(0), b(0), w(0) {}
+  constexpr Color(uint8_t red, uint8_t green, uint8_t blue) : r(red), g(green), b(blue), w(0) {}
+  constexpr Color(uint8_t red, uint8_t green, uint8_t blue, uint8_t white) : r(red), g(green), b(blue), w(white) {}
+  constexpr Color(uint32_t colorcode)
+      : r((colorcode >> 16) & 0xFF), g((colorcode >> 8) & 0xFF), b(colorcode & 0xFF), w((colorcode >> 24) & 0xFF) {}
+
+  bool operator==(const Color &rhs) const { return this->raw_32 == rhs.raw_32; }
+  bool operator!=(const Color &rhs) const { return this->raw_32 != rhs.raw_32; }
+
+  Color gradient(const Color &to_color, uint8_t amnt) const {
+    Color new_color;
+    float amnt_f = float(amnt) / 255.0f;
+    new_color.r = amnt_f * (to_color.r - this->r) + this->r;
+    new_color.g = amnt_f * (to_color.g - this->g) + this->g;
+    new_color.b = amnt_f * (to_color.b - this->b) + this->b;
+    new_color.w = amnt_f * (to_color.w - this->w) + this->w;
+    return new_color;
+  }
+};
+
+static const Color COLOR_BLACK(0, 0, 0, 0);
+static const Color COLOR_WHITE(255, 255, 255, 255);
+
+}  // namespace esphome
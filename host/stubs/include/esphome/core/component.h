@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome {
+
+namespace setup_priority {
+
+extern const float BUS;
+extern const float IO;
+extern const float HARDWARE;
+extern const float DATA;
+extern const float PROCESSOR;
+extern const float BLUETOOTH;
+extern const float AFTER_BLUETOOTH;
+extern const float WIFI;
+extern const float ETHERNET;
+extern const float BEFORE_CONNECTION;
+extern const float AFTER_WIFI;
+extern const float AFTER_CONNECTION;
+extern const float LATE;
+
+}  // namespace setup_priority
+
+static const uint32_t SCHEDULER_DONT_RUN = 4294967295UL;
+
+// Timers run from App.loop() on the host scheduler, which like the device's
+// accepts them from any thread.
+class Component {
+  public:
+    virtual ~Component() = default;
+
+    virtual void setup() {}
+    virtual void loop() {}
+    virtual void dump_config() {}
+    virtual void on_shutdown() {}
+    virtual float get_setup_priority() const { return setup_priority::DATA; }
+    virtual float get_loop_priority() const { return 0.0f; }
+    // Application::setup() waits for this before setting up the next
+    // component, as Wi-Fi does until it connects
+    virtual bool can_proceed() { return true; }
+
+    void mark_failed() { this->failed_ = true; }
+    bool is_failed() const { return this->failed_; }
+
+    void status_set_warning(const char *message = "unspecified") { this->warning_ = true; }
+    void status_clear_warning() { this->warning_ = false; }
+    void status_set_error(const char *message = "unspecified") { this->error_ = true; }
+    void status_clear_error() { this->error_ = false; }
+    bool status_has_warning() const { return this->warning_; }
+    bool status_has_error() const { return this->error_; }
+
+  protected:
+    void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f);
+    void set_interval(uint32_t interval, std::function<void()> &&f);
+    bool cancel_interval(const std::string &name);
+    void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f);
+    void set_timeout(uint32_t timeout, std::function<void()> &&f);
+    bool cancel_timeout(const std::string &name);
+    void defer(const std::string &name, std::function<void()> &&f);
+    void defer(std::function<void()> &&f);
+    bool cancel_defer(const std::string &name);
+
+    bool failed_ = false;
+    bool warning_ = false;
+    bool error_ = false;
+};
+
+class PollingComponent : public Component {
+  public:
+    PollingComponent() : PollingComponent(0) {}
+    explicit PollingComponent(uint32_t update_interval) : update_interval_(update_interval) {}
+
+    virtual void update() = 0;
+
+    virtual void set_update_interval(uint32_t update_interval) { this->update_interval_ = update_interval; }
+    virtual uint32_t get_update_interval() const { return this->update_interval_; }
+
+    // Called by App.setup(); update() then runs every update_interval
+    void call_setup();
+
+  protected:
+    uint32_t update_interval_;
+};
+
+}  // namespace esphome
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <sys/types.h>
+
+#define HOT
+#define ICACHE_RAM_ATTR
+#define IRAM_ATTR
+
+// Arduino.h brings these into the global namespace on the device
+using std::max;
+using std::min;
+
+namespace esphome {
+
+// Uptime on the host clock (see host/clock.h). millis() follows the clock's
+// speed, so timeouts scale with replays; micros() is always real time, so
+// measured durations stay honest.
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void arch_feed_wdt();
+
+}  // namespace esphome
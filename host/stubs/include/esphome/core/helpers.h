@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+#include "esphome/core/hal.h"
+
+namespace esphome {
+
+std::string str_sprintf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+bool str_startswith(const std::string &str, const std::string &start);
+
+uint32_t fnv1_hash(const std::string &str);
+uint32_t random_uint32();
+float random_float();
+
+template<typename T> class Parented {
+  public:
+    Parented() = default;
+    Parented(T *parent) : parent_(parent) {}
+
+    T *get_parent() const { return parent_; }
+    void set_parent(T *parent) { parent_ = parent; }
+
+  protected:
+    T *parent_{nullptr};
+};
+
+// The device picks PSRAM or internal RAM from the flags; the host has one heap
+template<class T> class RAMAllocator {
+  public:
+    using value_type = T;
+
+    enum Flags {
+      NONE = 0,
+      ALLOC_EXTERNAL = 1 << 0,
+      ALLOC_INTERNAL = 1 << 1,
+      ALLOW_FAILURE = 1 << 2,
+    };
+
+    RAMAllocator(uint8_t flags = 0) : flags_(flags) {}
+    template<class U> constexpr RAMAllocator(const RAMAllocator<U> &other) : flags_(other.get_flags()) {}
+
+    T *allocate(size_t n) {
+      auto *ptr = static_cast<T *>(malloc(n * sizeof(T)));
+      if (ptr == nullptr && (this->flags_ & ALLOW_FAILURE) == 0) {
+        abort();
+      }
+      return ptr;
+    }
+    void deallocate(T *p, size_t n) { free(p); }
+
+    uint8_t get_flags() const { return flags_; }
+
+    template<class U> bool operator==(const RAMAllocator<U> &) const { return true; }
+    template<class U> bool operator!=(const RAMAllocator<U> &) const { return false; }
+
+  protected:
+    uint8_t flags_;
+};
+
+template<class T> using ExternalRAMAllocator = RAMAllocator<T>;
+
+}  // namespace esphome
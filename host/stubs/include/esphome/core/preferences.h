@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace esphome {
+
+class ESPPreferenceBackend {
+  public:
+    virtual ~ESPPreferenceBackend() = default;
+    virtual bool save(const uint8_t *data, size_t len) = 0;
+    virtual bool load(uint8_t *data, size_t len) = 0;
+};
+
+class ESPPreferenceObject {
+  public:
+    ESPPreferenceObject() = default;
+    ESPPreferenceObject(ESPPreferenceBackend *backend) : backend_(backend) {}
+
+    template<typename T> bool save(const T *src) {
+      if (this->backend_ == nullptr) {
+        return false;
+      }
+      return this->backend_->save(reinterpret_cast<const uint8_t *>(src), sizeof(T));
+    }
+
+    template<typename T> bool load(T *dest) {
+      if (this->backend_ == nullptr) {
+        return false;
+      }
+      return this->backend_->load(reinterpret_cast<uint8_t *>(dest), sizeof(T));
+    }
+
+  protected:
+    ESPPreferenceBackend *backend_{nullptr};
+};
+
+class ESPPreferences {
+  public:
+    virtual ~ESPPreferences() = default;
+    virtual ESPPreferenceObject make_preference(size_t length, uint32_t type, bool in_flash) = 0;
+    virtual ESPPreferenceObject make_preference(size_t length, uint32_t type) = 0;
+    virtual bool sync() = 0;
+    virtual bool reset() = 0;
+
+    template<typename T, typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type = true>
+    ESPPreferenceObject make_preference(uint32_t type, bool in_flash) {
+      return this->make_preference(sizeof(T), type, in_flash);
+    }
+
+    template<typename T, typename std::enable_if<std::is_trivially_copyable<T>::value, bool>::type = true>
+    ESPPreferenceObject make_preference(uint32_t type) {
+      return this->make_preference(sizeof(T), type);
+    }
+};
+
+// Kept in memory on the host; reset() wipes it, App.reset() doesn't, so a
+// "reboot" sees what was saved before it.
+extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
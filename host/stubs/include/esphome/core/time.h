@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+namespace esphome {
+
+struct ESPTime {
+  uint8_t second;
+  uint8_t minute;
+  uint8_t hour;
+  uint8_t day_of_week;
+  uint8_t day_of_month;
+  uint16_t day_of_year;
+  uint8_t month;
+  uint16_t year;
+  bool is_dst;
+  time_t timestamp;
+
+  size_t strftime(char *buffer, size_t buffer_len, const char *format);
+  std::string strftime(const std::string &format);
+
+  // Clocks that haven't been set count from 1970
+  bool is_valid() const { return this->year >= 2019 && this->fields_in_range(); }
+  bool fields_in_range() const {
+    return this->second < 61 && this->minute < 60 && this->hour < 24 && this->day_of_week > 0 &&
+           this->day_of_week < 8 && this->day_of_month > 0 && this->day_of_month < 32 && this->day_of_year > 0 &&
+           this->day_of_year < 367 && this->month > 0 && this->month < 13;
+  }
+
+  static ESPTime from_c_tm(struct tm *c_tm, time_t c_time);
+  static ESPTime from_epoch_local(time_t epoch);
+  static ESPTime from_epoch_utc(time_t epoch);
+};
+
+}  // namespace esphome
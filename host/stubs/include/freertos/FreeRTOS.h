@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+// FreeRTOS on top of std::thread: tasks are threads, ticks are milliseconds
+// of real time, and there are two "cores" that pinning ignores.
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef struct QueueDefinition *QueueHandle_t;
+
+#define pdFALSE ((BaseType_t) 0)
+#define pdTRUE ((BaseType_t) 1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+#define errQUEUE_FULL ((BaseType_t) 0)
+
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define portTICK_PERIOD_MS ((TickType_t) 1)
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+
+#define portNUM_PROCESSORS 2
+#define tskNO_AFFINITY ((BaseType_t) 0x7FFFFFFF)
+
+BaseType_t xPortGetCoreID();
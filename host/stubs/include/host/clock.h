@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+namespace host {
+
+// Runs millis() at `speed` times real time from now on, e.g. 1000 to replay a
+// 15 minute trace in under a second. Leaves manual mode.
+void set_clock_speed(double speed);
+double get_clock_speed();
+bool is_manual_clock();
+
+// Freezes millis() at its current value; only advance_clock() moves it.
+// Deterministic tests use this to step through timeouts.
+void use_manual_clock();
+void advance_clock(uint32_t ms);
+
+// Sleeps for `ms` of host clock time (real time divided by the speed)
+void sleep_clock(uint32_t ms);
+
+// Real monotonic time, for measurements
+uint64_t real_micros();
+
+}  // namespace host
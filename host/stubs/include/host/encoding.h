@@ -0,0 +1,17 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace host {
+
+std::array<uint8_t, 20> sha1(const std::string &data);
+std::string base64_encode(const std::string &data);
+// False on characters outside the alphabet
+bool base64_decode(const std::string &encoded, std::string *decoded);
+
+// Sec-WebSocket-Accept for a Sec-WebSocket-Key (RFC 6455 section 4.2.2)
+std::string websocket_accept_key(const std::string &key);
+
+}  // namespace host
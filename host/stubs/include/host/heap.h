@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace host {
+
+// Counts every operator new and heap_caps_* allocation in the process, so
+// benchmarks can report allocations per frame and replays the peak heap.
+struct HeapCounters {
+  uint64_t allocations;
+  uint64_t frees;
+  size_t bytes_in_use;
+  size_t peak_bytes;
+};
+
+HeapCounters heap_counters();
+// Starts a new peak from the current usage
+void reset_heap_peak();
+
+// False when built with a sanitizer, which owns operator new
+bool heap_counting_enabled();
+
+// Capacity of the simulated internal RAM and PSRAM; a zero PSRAM size means
+// the board has none. heap_caps_malloc fails once a region is full.
+void set_heap_sizes(size_t internal, size_t psram);
+// Makes the next `count` heap_caps allocations fail
+void fail_next_allocations(uint32_t count);
+
+}  // namespace host
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+namespace host {
+
+// ESPHOME_LOG_LEVEL_*; starts from $TT_LOG_LEVEL, or warnings only
+void set_log_level(int level);
+int get_log_level();
+uint32_t error_log_count();
+uint32_t warning_log_count();
+
+void set_network_connected(bool connected);
+
+// Forgets everything saved to preferences, as a flash erase would
+void wipe_preferences();
+
+// FreeRTOS tasks are threads that, as on the device, usually never return.
+// This ends each one at its next vTaskDelay() or blocking queue call and
+// waits for them; false if some were still running after `timeout_ms`, e.g.
+// blocked in a socket call. Tasks can be started again afterwards.
+bool stop_tasks(uint32_t timeout_ms = 5000);
+uint32_t running_tasks();
+
+}  // namespace host
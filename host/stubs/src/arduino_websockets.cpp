@@ -0,0 +1,427 @@
+#include <ArduinoWebsockets.h>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <random>
+
+#include "host/encoding.h"
+
+namespace websockets {
+
+namespace {
+
+struct Url {
+  std::string host;
+  std::string port;
+  std::string path;
+};
+
+bool parse_url(const std::string &url, Url *parsed) {
+  static const std::string SCHEME = "ws://";
+  if (url.compare(0, SCHEME.size(), SCHEME) != 0) {
+    // No TLS on the host
+    return false;
+  }
+
+  size_t host_start = SCHEME.size();
+  size_t path_start = url.find('/', host_start);
+  std::string authority = url.substr(host_start, path_start == std::string::npos ? std::string::npos
+                                                                                  : path_start - host_start);
+  parsed->path = path_start == std::string::npos ? "/" : url.substr(path_start);
+
+  size_t colon = authority.rfind(':');
+  if (colon != std::string::npos && authority.find(']') == std::string::npos) {
+    parsed->host = authority.substr(0, colon);
+    parsed->port = authority.substr(colon + 1);
+  } else {
+    parsed->host = authority;
+    parsed->port = "80";
+  }
+  if (parsed->host.size() > 2 && parsed->host.front() == '[' && parsed->host.back() == ']') {
+    parsed->host = parsed->host.substr(1, parsed->host.size() - 2);
+  }
+  return !parsed->host.empty();
+}
+
+std::string lowercase(std::string str) {
+  std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+  return str;
+}
+
+uint32_t random_mask() {
+  static thread_local std::mt19937 engine(std::random_device{}());
+  return engine();
+}
+
+}  // namespace
+
+WebsocketsClient::~WebsocketsClient() {
+  int fd = this->fd_.exchange(-1);
+  if (fd >= 0) {
+    ::close(fd);
+  }
+}
+
+bool WebsocketsClient::connect(const WSInterfaceString &url) {
+  Url parsed;
+  if (!parse_url(url.c_str(), &parsed)) {
+    return false;
+  }
+
+  if (this->connected_.load()) {
+    this->close();
+  }
+  this->buffer_.clear();
+  this->fragments_.clear();
+
+  struct addrinfo hints {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *result = nullptr;
+  if (getaddrinfo(parsed.host.c_str(), parsed.port.c_str(), &hints, &result) != 0) {
+    return false;
+  }
+
+  int fd = -1;
+  for (struct addrinfo *address = result; address != nullptr; address = address->ai_next) {
+    fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> guard(this->socket_mutex_);
+      this->fd_.store(fd);
+    }
+    if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+      break;
+    }
+    std::lock_guard<std::mutex> guard(this->socket_mutex_);
+    this->fd_.store(-1);
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+  if (fd < 0) {
+    return false;
+  }
+
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  bool upgraded = this->handshake_(parsed.host + ":" + parsed.port, parsed.path);
+
+  {
+    std::lock_guard<std::mutex> guard(this->socket_mutex_);
+    if (!upgraded || this->fd_.load() != fd) {
+      // Failed, or close() gave up on the attempt while it blocked
+      if (this->fd_.load() == fd) {
+        this->fd_.store(-1);
+      }
+      ::close(fd);
+      return false;
+    }
+    this->connected_.store(true);
+  }
+
+  this->emit_(WebsocketsEvent::ConnectionOpened);
+  return true;
+}
+
+bool WebsocketsClient::handshake_(const std::string &host, const std::string &path) {
+  std::string nonce;
+  for (int i = 0; i < 4; i++) {
+    uint32_t random = random_mask();
+    nonce.append(reinterpret_cast<const char *>(&random), sizeof(random));
+  }
+  std::string key = host::base64_encode(nonce);
+
+  std::string request = "GET " + path + " HTTP/1.1\r\n" + "Host: " + host + "\r\n" +
+                        "Upgrade: websocket\r\n"
+                        "Connection: Upgrade\r\n"
+                        "Sec-WebSocket-Key: " +
+                        key +
+                        "\r\n"
+                        "Sec-WebSocket-Version: 13\r\n"
+                        "User-Agent: TinyWebsockets Client\r\n"
+                        "\r\n";
+  if (!this->send_raw_(request)) {
+    return false;
+  }
+
+  std::string response;
+  size_t header_end;
+  for (;;) {
+    header_end = response.find("\r\n\r\n");
+    if (header_end != std::string::npos) {
+      break;
+    }
+    if (response.size() > 8192) {
+      return false;
+    }
+    char chunk[512];
+    ssize_t received = ::recv(this->fd_.load(), chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+      return false;
+    }
+    response.append(chunk, received);
+  }
+
+  // Frames that arrived with the upgrade response
+  this->buffer_ = response.substr(header_end + 4);
+  response.resize(header_end);
+
+  if (response.compare(0, 12, "HTTP/1.1 101") != 0) {
+    return false;
+  }
+
+  std::string expected = host::websocket_accept_key(key);
+  size_t line_start = response.find("\r\n");
+  while (line_start != std::string::npos) {
+    line_start += 2;
+    size_t line_end = response.find("\r\n", line_start);
+    std::string line = response.substr(line_start, line_end == std::string::npos ? std::string::npos
+                                                                                  : line_end - line_start);
+    size_t colon = line.find(':');
+    if (colon != std::string::npos && lowercase(line.substr(0, colon)) == "sec-websocket-accept") {
+      size_t value_start = line.find_first_not_of(' ', colon + 1);
+      return value_start != std::string::npos && line.substr(value_start) == expected;
+    }
+    line_start = line_end;
+  }
+  return false;
+}
+
+bool WebsocketsClient::poll() {
+  if (!this->connected_.load()) {
+    return false;
+  }
+
+  bool processed = false;
+  char chunk[4096];
+  for (;;) {
+    ssize_t received = ::recv(this->fd_.load(), chunk, sizeof(chunk), MSG_DONTWAIT);
+    if (received > 0) {
+      this->buffer_.append(chunk, received);
+      continue;
+    }
+    if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+      // Dispatch what arrived before the connection went away
+      while (this->connected_.load() && this->dispatch_frame_()) {
+      }
+      if (this->connected_.load()) {
+        this->closed_();
+      }
+      return true;
+    }
+    break;
+  }
+
+  while (this->connected_.load() && this->dispatch_frame_()) {
+    processed = true;
+  }
+  return processed;
+}
+
+bool WebsocketsClient::dispatch_frame_() {
+  const auto *bytes = reinterpret_cast<const uint8_t *>(this->buffer_.data());
+  size_t available = this->buffer_.size();
+  if (available < 2) {
+    return false;
+  }
+
+  bool fin = (bytes[0] & 0x80) != 0;
+  uint8_t opcode = bytes[0] & 0x0F;
+  bool masked = (bytes[1] & 0x80) != 0;
+  uint64_t length = bytes[1] & 0x7F;
+  size_t header = 2;
+
+  if (length == 126) {
+    if (available < 4) {
+      return false;
+    }
+    length = (uint64_t(bytes[2]) << 8) | bytes[3];
+    header = 4;
+  } else if (length == 127) {
+    if (available < 10) {
+      return false;
+    }
+    length = 0;
+    for (int i = 0; i < 8; i++) {
+      length = (length << 8) | bytes[2 + i];
+    }
+    header = 10;
+  }
+
+  uint8_t mask[4] = {};
+  if (masked) {
+    if (available < header + 4) {
+      return false;
+    }
+    memcpy(mask, bytes + header, 4);
+    header += 4;
+  }
+  if (available - header < length) {
+    return false;
+  }
+
+  std::string payload = this->buffer_.substr(header, length);
+  if (masked) {
+    for (size_t i = 0; i < payload.size(); i++) {
+      payload[i] ^= mask[i % 4];
+    }
+  }
+  this->buffer_.erase(0, header + length);
+
+  switch (opcode) {
+    case 0x0:
+      this->fragments_ += payload;
+      if (fin && this->fragments_type_ != MessageType::Empty) {
+        WebsocketsMessage message(this->fragments_type_, std::move(this->fragments_));
+        this->fragments_.clear();
+        this->fragments_type_ = MessageType::Empty;
+        if (this->message_callback_) {
+          this->message_callback_(*this, std::move(message));
+        }
+      }
+      break;
+    case 0x1:
+    case 0x2: {
+      MessageType type = opcode == 0x1 ? MessageType::Text : MessageType::Binary;
+      if (!fin) {
+        this->fragments_ = std::move(payload);
+        this->fragments_type_ = type;
+        break;
+      }
+      if (this->message_callback_) {
+        this->message_callback_(*this, WebsocketsMessage(type, std::move(payload)));
+      }
+      break;
+    }
+    case 0x8:
+      // Echo the status code back before closing, as the protocol asks
+      this->send_frame_(0x8, payload.substr(0, 2));
+      this->closed_();
+      break;
+    case 0x9:
+      this->send_frame_(0xA, payload);
+      this->emit_(WebsocketsEvent::GotPing, payload);
+      break;
+    case 0xA:
+      this->emit_(WebsocketsEvent::GotPong, payload);
+      break;
+    default:
+      break;
+  }
+  return true;
+}
+
+bool WebsocketsClient::send_frame_(uint8_t opcode, const WSString &data) {
+  if (!this->connected_.load()) {
+    return false;
+  }
+
+  std::string frame;
+  frame.reserve(data.size() + 14);
+  frame += static_cast<char>(0x80 | opcode);
+  if (data.size() < 126) {
+    frame += static_cast<char>(0x80 | data.size());
+  } else if (data.size() < 0x10000) {
+    frame += static_cast<char>(0x80 | 126);
+    frame += static_cast<char>((data.size() >> 8) & 0xFF);
+    frame += static_cast<char>(data.size() & 0xFF);
+  } else {
+    frame += static_cast<char>(0x80 | 127);
+    for (int i = 7; i >= 0; i--) {
+      frame += static_cast<char>((uint64_t(data.size()) >> (8 * i)) & 0xFF);
+    }
+  }
+
+  uint32_t mask = random_mask();
+  const auto *mask_bytes = reinterpret_cast<const uint8_t *>(&mask);
+  frame.append(reinterpret_cast<const char *>(mask_bytes), 4);
+  for (size_t i = 0; i < data.size(); i++) {
+    frame += static_cast<char>(data[i] ^ mask_bytes[i % 4]);
+  }
+
+  return this->send_raw_(frame);
+}
+
+bool WebsocketsClient::send_raw_(const std::string &data) {
+  std::lock_guard<std::mutex> guard(this->send_mutex_);
+  int fd = this->fd_.load();
+  if (fd < 0) {
+    return false;
+  }
+
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t written = ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    sent += written;
+  }
+  return true;
+}
+
+void WebsocketsClient::close() {
+  bool was_connected;
+  {
+    std::lock_guard<std::mutex> guard(this->socket_mutex_);
+    int fd = this->fd_.load();
+    if (fd < 0) {
+      return;
+    }
+
+    was_connected = this->connected_.load();
+    if (was_connected) {
+      // Normal closure
+      this->send_frame_(0x8, std::string("\x03\xe8", 2));
+      this->connected_.store(false);
+      ::shutdown(fd, SHUT_RDWR);
+      ::close(fd);
+    } else {
+      // A connect() is blocked on the socket; waking it makes it fail, and it
+      // closes the socket itself
+      ::shutdown(fd, SHUT_RDWR);
+    }
+    this->fd_.store(-1);
+    this->buffer_.clear();
+    this->fragments_.clear();
+    this->fragments_type_ = MessageType::Empty;
+  }
+
+  if (was_connected) {
+    this->emit_(WebsocketsEvent::ConnectionClosed);
+  }
+}
+
+void WebsocketsClient::closed_() {
+  {
+    std::lock_guard<std::mutex> guard(this->socket_mutex_);
+    int fd = this->fd_.exchange(-1);
+    this->connected_.store(false);
+    if (fd >= 0) {
+      ::close(fd);
+    }
+  }
+  this->emit_(WebsocketsEvent::ConnectionClosed);
+}
+
+void WebsocketsClient::emit_(WebsocketsEvent event, const WSString &data) {
+  if (this->event_callback_) {
+    this->event_callback_(*this, event, WSInterfaceString(data));
+  }
+}
+
+}  // namespace websockets
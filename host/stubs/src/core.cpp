@@ -0,0 +1,562 @@
+// Host implementations of the ESPHome core: clock, logging, scheduler,
+// application and preferences.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "esphome/core/application.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include "esphome/core/time.h"
+#include "esphome/components/network/util.h"
+#include "host/clock.h"
+#include "host/runtime.h"
+
+namespace host {
+
+namespace {
+
+struct ClockState {
+  std::mutex lock;
+  bool manual = false;
+  double speed = 1.0;
+  // millis() = base_ms + (real time since base_real_us) * speed
+  double base_ms = 0.0;
+  uint64_t base_real_us = 0;
+};
+
+ClockState &clock_state() {
+  static ClockState state;
+  return state;
+}
+
+double clock_ms_locked(ClockState &state) {
+  if (state.manual) {
+    return state.base_ms;
+  }
+  return state.base_ms + double(real_micros() - state.base_real_us) * state.speed / 1000.0;
+}
+
+void rebase_locked(ClockState &state) {
+  state.base_ms = clock_ms_locked(state);
+  state.base_real_us = real_micros();
+}
+
+}  // namespace
+
+uint64_t real_micros() {
+  static const auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+void set_clock_speed(double speed) {
+  ClockState &state = clock_state();
+  std::lock_guard<std::mutex> guard(state.lock);
+  rebase_locked(state);
+  state.manual = false;
+  state.speed = speed;
+}
+
+double get_clock_speed() {
+  ClockState &state = clock_state();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return state.speed;
+}
+
+bool is_manual_clock() {
+  ClockState &state = clock_state();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return state.manual;
+}
+
+void use_manual_clock() {
+  ClockState &state = clock_state();
+  std::lock_guard<std::mutex> guard(state.lock);
+  rebase_locked(state);
+  state.manual = true;
+}
+
+void advance_clock(uint32_t ms) {
+  ClockState &state = clock_state();
+  std::lock_guard<std::mutex> guard(state.lock);
+  state.base_ms += ms;
+}
+
+void sleep_clock(uint32_t ms) {
+  ClockState &state = clock_state();
+  double speed;
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    if (state.manual) {
+      state.base_ms += ms;
+      return;
+    }
+    speed = state.speed;
+  }
+  std::this_thread::sleep_for(std::chrono::microseconds(uint64_t(ms * 1000.0 / speed)));
+}
+
+namespace {
+
+std::atomic<int> log_level{-1};
+std::atomic<uint32_t> error_logs{0};
+std::atomic<uint32_t> warning_logs{0};
+std::atomic<bool> network_connected{true};
+
+}  // namespace
+
+void set_log_level(int level) { log_level.store(level); }
+
+int get_log_level() {
+  int level = log_level.load();
+  if (level < 0) {
+    const char *env = getenv("TT_LOG_LEVEL");
+    level = env != nullptr ? atoi(env) : ESPHOME_LOG_LEVEL_WARN;
+    log_level.store(level);
+  }
+  return level;
+}
+
+uint32_t error_log_count() { return error_logs.load(); }
+uint32_t warning_log_count() { return warning_logs.load(); }
+
+void set_network_connected(bool connected) { network_connected.store(connected); }
+
+void wipe_preferences() { esphome::global_preferences->reset(); }
+
+}  // namespace host
+
+namespace esphome {
+
+namespace setup_priority {
+
+const float BUS = 1000.0f;
+const float IO = 900.0f;
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float PROCESSOR = 400.0f;
+const float BLUETOOTH = 350.0f;
+const float AFTER_BLUETOOTH = 300.0f;
+const float WIFI = 250.0f;
+const float ETHERNET = 250.0f;
+const float BEFORE_CONNECTION = 220.0f;
+const float AFTER_WIFI = 200.0f;
+const float AFTER_CONNECTION = 100.0f;
+const float LATE = -100.0f;
+
+}  // namespace setup_priority
+
+uint32_t millis() {
+  auto &state = ::host::clock_state();
+  std::lock_guard<std::mutex> guard(state.lock);
+  return uint32_t(uint64_t(::host::clock_ms_locked(state)));
+}
+
+uint32_t micros() { return uint32_t(::host::real_micros()); }
+
+void delay(uint32_t ms) { ::host::sleep_clock(ms); }
+
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+void arch_feed_wdt() {}
+
+void esp_log_printf_(int level, const char *tag, int line, const char *format, ...) {
+  if (level == ESPHOME_LOG_LEVEL_ERROR) {
+    ::host::error_logs++;
+  } else if (level == ESPHOME_LOG_LEVEL_WARN) {
+    ::host::warning_logs++;
+  }
+
+  if (level > ::host::get_log_level()) {
+    return;
+  }
+
+  static const char *const LETTERS[] = {"", "E", "W", "I", "C", "D", "V", "VV"};
+  static std::mutex lock;
+
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+
+  std::lock_guard<std::mutex> guard(lock);
+  fprintf(stderr, "[%8.3f][%s][%s:%d]: %s\n", millis() / 1000.0, LETTERS[level], tag, line, message);
+}
+
+std::string str_sprintf(const char *fmt, ...) {
+  std::string str;
+  va_list args;
+
+  va_start(args, fmt);
+  size_t length = vsnprintf(nullptr, 0, fmt, args);
+  va_end(args);
+
+  str.resize(length);
+  va_start(args, fmt);
+  vsnprintf(&str[0], length + 1, fmt, args);
+  va_end(args);
+
+  return str;
+}
+
+bool str_startswith(const std::string &str, const std::string &start) { return str.rfind(start, 0) == 0; }
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+namespace {
+
+// Seeded, so benchmarks and replays are repeatable
+std::mt19937 &random_engine() {
+  static std::mt19937 engine(0x7472616e);
+  return engine;
+}
+std::mutex random_lock;
+
+}  // namespace
+
+uint32_t random_uint32() {
+  std::lock_guard<std::mutex> guard(random_lock);
+  return random_engine()();
+}
+
+float random_float() { return float(random_uint32()) / float(UINT32_MAX); }
+
+namespace network {
+
+bool is_connected() { return ::host::network_connected.load(); }
+
+}  // namespace network
+
+void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+  App.scheduler.set_interval(this, name, interval, std::move(f));
+}
+
+void Component::set_interval(uint32_t interval, std::function<void()> &&f) {
+  App.scheduler.set_interval(this, "", interval, std::move(f));
+}
+
+bool Component::cancel_interval(const std::string &name) { return App.scheduler.cancel_interval(this, name); }
+
+void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+  App.scheduler.set_timeout(this, name, timeout, std::move(f));
+}
+
+void Component::set_timeout(uint32_t timeout, std::function<void()> &&f) {
+  App.scheduler.set_timeout(this, "", timeout, std::move(f));
+}
+
+bool Component::cancel_timeout(const std::string &name) { return App.scheduler.cancel_timeout(this, name); }
+
+void Component::defer(const std::string &name, std::function<void()> &&f) {
+  App.scheduler.set_timeout(this, name, 0, std::move(f));
+}
+
+void Component::defer(std::function<void()> &&f) { App.scheduler.set_timeout(this, "", 0, std::move(f)); }
+
+bool Component::cancel_defer(const std::string &name) { return App.scheduler.cancel_timeout(this, name); }
+
+void PollingComponent::call_setup() {
+  this->setup();
+  if (this->update_interval_ != SCHEDULER_DONT_RUN && this->update_interval_ != 0) {
+    this->set_interval("update", this->update_interval_, [this]() { this->update(); });
+  }
+}
+
+void Scheduler::set_timeout(Component *component, const std::string &name, uint32_t timeout,
+                            std::function<void()> func) {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  if (!name.empty()) {
+    this->cancel_(component, name, TIMEOUT);
+  }
+  this->items_.push_back(Item{component, name, TIMEOUT, millis() + timeout, 0, std::move(func)});
+}
+
+bool Scheduler::cancel_timeout(Component *component, const std::string &name) {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  return this->cancel_(component, name, TIMEOUT);
+}
+
+void Scheduler::set_interval(Component *component, const std::string &name, uint32_t interval,
+                             std::function<void()> func) {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  if (!name.empty()) {
+    this->cancel_(component, name, INTERVAL);
+  }
+  this->items_.push_back(Item{component, name, INTERVAL, millis() + interval, interval, std::move(func)});
+}
+
+bool Scheduler::cancel_interval(Component *component, const std::string &name) {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  return this->cancel_(component, name, INTERVAL);
+}
+
+bool Scheduler::cancel_(Component *component, const std::string &name, Type type) {
+  if (name.empty()) {
+    return false;
+  }
+
+  bool cancelled = false;
+  for (auto &item : this->items_) {
+    if (!item.removed && item.component == component && item.type == type && item.name == name) {
+      item.removed = true;
+      cancelled = true;
+    }
+  }
+  return cancelled;
+}
+
+void Scheduler::call() {
+  uint32_t now = millis();
+
+  // Items added by the callbacks wait for the next call, as on the device
+  std::vector<std::list<Item>::iterator> due;
+  {
+    std::lock_guard<std::mutex> guard(this->lock_);
+    this->items_.remove_if([](const Item &item) { return item.removed; });
+    for (auto it = this->items_.begin(); it != this->items_.end(); ++it) {
+      if (int32_t(now - it->next) >= 0) {
+        due.push_back(it);
+      }
+    }
+    std::stable_sort(due.begin(), due.end(), [now](const auto &a, const auto &b) {
+      return int32_t(a->next - now) < int32_t(b->next - now);
+    });
+  }
+
+  for (auto it : due) {
+    std::function<void()> func;
+    {
+      std::lock_guard<std::mutex> guard(this->lock_);
+      if (it->removed) {
+        continue;
+      }
+      func = it->func;
+      if (it->type == TIMEOUT) {
+        it->removed = true;
+      } else {
+        it->next = now + std::max<uint32_t>(it->interval, 1);
+      }
+    }
+    func();
+  }
+}
+
+uint32_t Scheduler::next_schedule_in() {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  uint32_t now = millis();
+  uint32_t next = SCHEDULER_DONT_RUN;
+  for (const auto &item : this->items_) {
+    if (item.removed) {
+      continue;
+    }
+    int32_t remaining = int32_t(item.next - now);
+    next = std::min(next, uint32_t(std::max(remaining, 0)));
+  }
+  return next;
+}
+
+void Scheduler::clear() {
+  std::lock_guard<std::mutex> guard(this->lock_);
+  this->items_.clear();
+}
+
+Application App;
+
+void Application::register_component(Component *component) { this->components_.push_back(component); }
+
+void Application::setup() {
+  std::stable_sort(this->components_.begin(), this->components_.end(), [](Component *a, Component *b) {
+    return a->get_setup_priority() > b->get_setup_priority();
+  });
+
+  for (size_t i = 0; i < this->components_.size(); i++) {
+    Component *component = this->components_[i];
+    if (auto *polling = dynamic_cast<PollingComponent *>(component)) {
+      polling->call_setup();
+    } else {
+      component->setup();
+    }
+
+    // Like the device, keeps the scheduler and the components already set up
+    // running while one isn't ready to proceed
+    while (!component->can_proceed()) {
+      try {
+        this->scheduler.call();
+        for (size_t j = 0; j <= i; j++) {
+          this->components_[j]->loop();
+        }
+      } catch (const host::RebootRequested &) {
+        this->reboot_requested_ = true;
+        return;
+      }
+      ::host::sleep_clock(1);
+    }
+  }
+
+  if (::host::get_log_level() >= ESPHOME_LOG_LEVEL_CONFIG) {
+    for (auto *component : this->components_) {
+      component->dump_config();
+    }
+  }
+}
+
+void Application::loop() {
+  if (this->reboot_requested_) {
+    return;
+  }
+
+  try {
+    for (auto *component : this->components_) {
+      component->loop();
+    }
+    this->scheduler.call();
+  } catch (const host::RebootRequested &) {
+    this->reboot_requested_ = true;
+  }
+}
+
+void Application::reboot() {
+  this->run_safe_shutdown_hooks();
+  throw host::RebootRequested{};
+}
+
+void Application::run_safe_shutdown_hooks() {
+  for (auto it = this->components_.rbegin(); it != this->components_.rend(); ++it) {
+    (*it)->on_shutdown();
+  }
+}
+
+void Application::reset() {
+  this->components_.clear();
+  this->scheduler.clear();
+  this->reboot_requested_ = false;
+}
+
+namespace {
+
+class HostPreferenceBackend : public ESPPreferenceBackend {
+  public:
+    HostPreferenceBackend(std::map<uint32_t, std::vector<uint8_t>> *storage, uint32_t type)
+        : storage_(storage), type_(type) {}
+
+    bool save(const uint8_t *data, size_t len) override {
+      (*this->storage_)[this->type_].assign(data, data + len);
+      return true;
+    }
+
+    bool load(uint8_t *data, size_t len) override {
+      auto it = this->storage_->find(this->type_);
+      if (it == this->storage_->end() || it->second.size() != len) {
+        return false;
+      }
+      memcpy(data, it->second.data(), len);
+      return true;
+    }
+
+  protected:
+    std::map<uint32_t, std::vector<uint8_t>> *storage_;
+    uint32_t type_;
+};
+
+class HostPreferences : public ESPPreferences {
+  public:
+    ESPPreferenceObject make_preference(size_t length, uint32_t type, bool in_flash) override {
+      return this->make_preference(length, type);
+    }
+
+    ESPPreferenceObject make_preference(size_t length, uint32_t type) override {
+      this->backends_.push_back(std::make_unique<HostPreferenceBackend>(&this->storage_, type));
+      return ESPPreferenceObject(this->backends_.back().get());
+    }
+
+    bool sync() override { return true; }
+
+    bool reset() override {
+      this->storage_.clear();
+      return true;
+    }
+
+  protected:
+    std::map<uint32_t, std::vector<uint8_t>> storage_;
+    std::vector<std::unique_ptr<HostPreferenceBackend>> backends_;
+};
+
+HostPreferences host_preferences;
+
+}  // namespace
+
+ESPPreferences *global_preferences = &host_preferences;
+
+size_t ESPTime::strftime(char *buffer, size_t buffer_len, const char *format) {
+  struct tm c_tm = {};
+  c_tm.tm_sec = this->second;
+  c_tm.tm_min = this->minute;
+  c_tm.tm_hour = this->hour;
+  c_tm.tm_wday = this->day_of_week - 1;
+  c_tm.tm_mday = this->day_of_month;
+  c_tm.tm_yday = this->day_of_year - 1;
+  c_tm.tm_mon = this->month - 1;
+  c_tm.tm_year = this->year - 1900;
+  c_tm.tm_isdst = this->is_dst;
+  return ::strftime(buffer, buffer_len, format, &c_tm);
+}
+
+std::string ESPTime::strftime(const std::string &format) {
+  char buffer[128];
+  size_t length = this->strftime(buffer, sizeof(buffer), format.c_str());
+  if (length == 0 && !format.empty()) {
+    return "ERROR";
+  }
+  return std::string(buffer, length);
+}
+
+ESPTime ESPTime::from_c_tm(struct tm *c_tm, time_t c_time) {
+  ESPTime res{};
+  res.second = uint8_t(c_tm->tm_sec);
+  res.minute = uint8_t(c_tm->tm_min);
+  res.hour = uint8_t(c_tm->tm_hour);
+  res.day_of_week = uint8_t(c_tm->tm_wday + 1);
+  res.day_of_month = uint8_t(c_tm->tm_mday);
+  res.day_of_year = uint16_t(c_tm->tm_yday + 1);
+  res.month = uint8_t(c_tm->tm_mon + 1);
+  res.year = uint16_t(c_tm->tm_year + 1900);
+  res.is_dst = bool(c_tm->tm_isdst);
+  res.timestamp = c_time;
+  return res;
+}
+
+ESPTime ESPTime::from_epoch_local(time_t epoch) {
+  struct tm c_tm;
+  localtime_r(&epoch, &c_tm);
+  return ESPTime::from_c_tm(&c_tm, epoch);
+}
+
+ESPTime ESPTime::from_epoch_utc(time_t epoch) {
+  struct tm c_tm;
+  gmtime_r(&epoch, &c_tm);
+  return ESPTime::from_c_tm(&c_tm, epoch);
+}
+
+}  // namespace esphome
@@ -0,0 +1,129 @@
+#include "esphome/components/display/display.h"
+
+#include <algorithm>
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace display {
+
+static const char *const TAG = "display";
+
+const Color COLOR_OFF(0, 0, 0, 0);
+const Color COLOR_ON(255, 255, 255, 255);
+
+void Rect::shrink(Rect rect) {
+  if (!this->is_set()) {
+    *this = rect;
+    return;
+  }
+  if (!rect.is_set()) {
+    return;
+  }
+
+  int16_t left = std::max(this->x, rect.x);
+  int16_t top = std::max(this->y, rect.y);
+  int16_t right = std::min(this->x2(), rect.x2());
+  int16_t bottom = std::min(this->y2(), rect.y2());
+  // Disjoint rectangles leave nothing visible
+  *this = Rect(left, top, std::max<int16_t>(0, right - left), std::max<int16_t>(0, bottom - top));
+}
+
+bool Rect::inside(int16_t test_x, int16_t test_y) const {
+  if (!this->is_set()) {
+    return true;
+  }
+  return test_x >= this->x && test_x < this->x2() && test_y >= this->y && test_y < this->y2();
+}
+
+void Display::fill(Color color) { this->filled_rectangle(0, 0, this->get_width(), this->get_height(), color); }
+
+void Display::filled_rectangle(int x1, int y1, int width, int height, Color color) {
+  for (int y = y1; y < y1 + height; y++) {
+    for (int x = x1; x < x1 + width; x++) {
+      this->draw_pixel_at(x, y, color);
+    }
+  }
+}
+
+void Display::print(int x, int y, BaseFont *font, Color color, TextAlign align, const char *text, Color background) {
+  int x_start, y_start;
+  int width, height;
+  this->get_text_bounds(x, y, text, font, align, &x_start, &y_start, &width, &height);
+  font->print(x_start, y_start, this, color, text, background);
+}
+
+void Display::print(int x, int y, BaseFont *font, Color color, const char *text, Color background) {
+  this->print(x, y, font, color, TextAlign::TOP_LEFT, text, background);
+}
+
+void Display::print(int x, int y, BaseFont *font, TextAlign align, const char *text) {
+  this->print(x, y, font, COLOR_ON, align, text);
+}
+
+void Display::print(int x, int y, BaseFont *font, const char *text) {
+  this->print(x, y, font, COLOR_ON, TextAlign::TOP_LEFT, text);
+}
+
+void Display::get_text_bounds(int x, int y, const char *text, BaseFont *font, TextAlign align, int *x1, int *y1,
+                              int *width, int *height) {
+  int x_offset, baseline;
+  font->measure(text, width, &x_offset, &baseline, height);
+
+  auto x_align = TextAlign(int(align) & 0x18);
+  auto y_align = TextAlign(int(align) & 0x07);
+
+  switch (x_align) {
+    case TextAlign::RIGHT:
+      *x1 = x - *width - x_offset;
+      break;
+    case TextAlign::CENTER_HORIZONTAL:
+      *x1 = x - (*width + x_offset) / 2;
+      break;
+    case TextAlign::LEFT:
+    default:
+      *x1 = x;
+      break;
+  }
+
+  switch (y_align) {
+    case TextAlign::BOTTOM:
+      *y1 = y - *height;
+      break;
+    case TextAlign::BASELINE:
+      *y1 = y - baseline;
+      break;
+    case TextAlign::CENTER_VERTICAL:
+      *y1 = y - (*height) / 2;
+      break;
+    case TextAlign::TOP:
+    default:
+      *y1 = y;
+      break;
+  }
+}
+
+void Display::start_clipping(Rect rect) {
+  if (!this->clipping_rectangle_.empty()) {
+    rect.shrink(this->clipping_rectangle_.back());
+  }
+  this->clipping_rectangle_.push_back(rect);
+}
+
+void Display::end_clipping() {
+  if (this->clipping_rectangle_.empty()) {
+    ESP_LOGE(TAG, "clear: Clipping is not set.");
+    return;
+  }
+  this->clipping_rectangle_.pop_back();
+}
+
+Rect Display::get_clipping() const {
+  if (this->clipping_rectangle_.empty()) {
+    return Rect();
+  }
+  return this->clipping_rectangle_.back();
+}
+
+}  // namespace display
+}  // namespace esphome
@@ -0,0 +1,126 @@
+#include "host/encoding.h"
+
+namespace host {
+
+static uint32_t rotate_left(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+std::array<uint8_t, 20> sha1(const std::string &data) {
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+  std::string message = data;
+  uint64_t bit_length = uint64_t(data.size()) * 8;
+  message += static_cast<char>(0x80);
+  while (message.size() % 64 != 56) {
+    message += '\0';
+  }
+  for (int i = 7; i >= 0; i--) {
+    message += static_cast<char>((bit_length >> (8 * i)) & 0xFF);
+  }
+
+  for (size_t chunk = 0; chunk < message.size(); chunk += 64) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+      const auto *bytes = reinterpret_cast<const uint8_t *>(message.data() + chunk + 4 * i);
+      w[i] = (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+    }
+    for (int i = 16; i < 80; i++) {
+      w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+      uint32_t f, k;
+      if (i < 20) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999;
+      } else if (i < 40) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1;
+      } else if (i < 60) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDC;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6;
+      }
+      uint32_t temp = rotate_left(a, 5) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotate_left(b, 30);
+      b = a;
+      a = temp;
+    }
+
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+  }
+
+  std::array<uint8_t, 20> digest;
+  for (int i = 0; i < 20; i++) {
+    digest[i] = (h[i / 4] >> (24 - 8 * (i % 4))) & 0xFF;
+  }
+  return digest;
+}
+
+static const char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string base64_encode(const std::string &data) {
+  std::string encoded;
+  encoded.reserve((data.size() + 2) / 3 * 4);
+
+  for (size_t i = 0; i < data.size(); i += 3) {
+    uint32_t group = uint32_t(uint8_t(data[i])) << 16;
+    if (i + 1 < data.size()) {
+      group |= uint32_t(uint8_t(data[i + 1])) << 8;
+    }
+    if (i + 2 < data.size()) {
+      group |= uint8_t(data[i + 2]);
+    }
+
+    encoded += BASE64_ALPHABET[(group >> 18) & 0x3F];
+    encoded += BASE64_ALPHABET[(group >> 12) & 0x3F];
+    encoded += i + 1 < data.size() ? BASE64_ALPHABET[(group >> 6) & 0x3F] : '=';
+    encoded += i + 2 < data.size() ? BASE64_ALPHABET[group & 0x3F] : '=';
+  }
+  return encoded;
+}
+
+bool base64_decode(const std::string &encoded, std::string *decoded) {
+  decoded->clear();
+  uint32_t group = 0;
+  int bits = 0;
+
+  for (char c : encoded) {
+    if (c == '=') {
+      break;
+    }
+    const char *found = nullptr;
+    for (const char *p = BASE64_ALPHABET; *p != '\0'; p++) {
+      if (*p == c) {
+        found = p;
+        break;
+      }
+    }
+    if (found == nullptr) {
+      return false;
+    }
+
+    group = (group << 6) | uint32_t(found - BASE64_ALPHABET);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      *decoded += static_cast<char>((group >> bits) & 0xFF);
+    }
+  }
+  return true;
+}
+
+std::string websocket_accept_key(const std::string &key) {
+  auto digest = sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+  return base64_encode(std::string(digest.begin(), digest.end()));
+}
+
+}  // namespace host
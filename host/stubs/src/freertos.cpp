@@ -0,0 +1,216 @@
+// FreeRTOS tasks and queues on std::thread
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "host/clock.h"
+#include "host/runtime.h"
+
+namespace {
+
+// Unwinds a task's thread, for vTaskDelete(nullptr) and host::stop_tasks()
+struct TaskExit {};
+
+struct TaskRegistry {
+  std::mutex lock;
+  std::condition_variable finished;
+  uint32_t running = 0;
+  std::atomic<bool> stopping{false};
+};
+
+TaskRegistry &registry() {
+  static TaskRegistry registry;
+  return registry;
+}
+
+thread_local bool is_task = false;
+thread_local BaseType_t current_core = 0;
+thread_local uint32_t current_stack = 8192;
+
+// Blocking calls check for host::stop_tasks() at least this often
+constexpr auto STOP_CHECK_INTERVAL = std::chrono::milliseconds(10);
+
+void check_stopping() {
+  if (is_task && registry().stopping.load()) {
+    throw TaskExit{};
+  }
+}
+
+}  // namespace
+
+struct QueueDefinition {
+  std::mutex lock;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+  std::deque<std::vector<uint8_t>> items;
+  UBaseType_t length;
+  UBaseType_t item_size;
+};
+
+namespace host {
+
+bool stop_tasks(uint32_t timeout_ms) {
+  TaskRegistry &tasks = registry();
+  tasks.stopping.store(true);
+
+  bool stopped;
+  {
+    std::unique_lock<std::mutex> guard(tasks.lock);
+    stopped = tasks.finished.wait_for(guard, std::chrono::milliseconds(timeout_ms),
+                                      [&tasks]() { return tasks.running == 0; });
+  }
+
+  tasks.stopping.store(false);
+  return stopped;
+}
+
+uint32_t running_tasks() {
+  std::lock_guard<std::mutex> guard(registry().lock);
+  return registry().running;
+}
+
+}  // namespace host
+
+BaseType_t xPortGetCoreID() { return current_core; }
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task_code, const char *name, uint32_t stack_depth,
+                                   void *parameters, UBaseType_t priority, TaskHandle_t *created_task,
+                                   BaseType_t core_id) {
+  TaskRegistry &tasks = registry();
+  {
+    std::lock_guard<std::mutex> guard(tasks.lock);
+    tasks.running++;
+  }
+
+  std::thread([task_code, parameters, stack_depth, core_id, &tasks]() {
+    is_task = true;
+    current_core = core_id == tskNO_AFFINITY ? 0 : core_id;
+    current_stack = stack_depth;
+    try {
+      task_code(parameters);
+    } catch (const TaskExit &) {
+    }
+
+    std::lock_guard<std::mutex> guard(tasks.lock);
+    tasks.running--;
+    tasks.finished.notify_all();
+  }).detach();
+
+  if (created_task != nullptr) {
+    *created_task = nullptr;
+  }
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t task_code, const char *name, uint32_t stack_depth, void *parameters,
+                       UBaseType_t priority, TaskHandle_t *created_task) {
+  return xTaskCreatePinnedToCore(task_code, name, stack_depth, parameters, priority, created_task, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task) {
+  if (task == nullptr && is_task) {
+    throw TaskExit{};
+  }
+}
+
+void vTaskDelay(TickType_t ticks) {
+  // Ticks follow a sped-up host clock, so replays keep the device's ratio of
+  // polling to traffic. A manual clock only moves when told, so there they
+  // are real milliseconds.
+  double speed = host::is_manual_clock() ? 1.0 : host::get_clock_speed();
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(uint64_t(ticks * 1000.0 / speed));
+  do {
+    check_stopping();
+    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+        STOP_CHECK_INTERVAL, deadline - std::chrono::steady_clock::now()));
+  } while (std::chrono::steady_clock::now() < deadline);
+  check_stopping();
+}
+
+TickType_t xTaskGetTickCount() {
+  static const auto start = std::chrono::steady_clock::now();
+  return TickType_t(
+      std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { return current_stack; }
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+  auto *queue = new QueueDefinition();
+  queue->length = length;
+  queue->item_size = item_size;
+  return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) { delete queue; }
+
+// Waits on `condition` until `ready` holds or the ticks run out, checking
+// for host::stop_tasks() in between
+template<typename Ready>
+static bool wait_for(std::unique_lock<std::mutex> &guard, std::condition_variable &condition, TickType_t ticks,
+                     Ready ready) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(ticks);
+  while (!ready()) {
+    if (ticks != portMAX_DELAY && std::chrono::steady_clock::now() >= deadline) {
+      return false;
+    }
+    if (is_task && registry().stopping.load()) {
+      guard.unlock();
+      throw TaskExit{};
+    }
+    auto wait = STOP_CHECK_INTERVAL;
+    if (ticks != portMAX_DELAY) {
+      wait = std::min(wait, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                deadline - std::chrono::steady_clock::now() + std::chrono::milliseconds(1)));
+    }
+    condition.wait_for(guard, wait);
+  }
+  return true;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!wait_for(guard, queue->not_full, ticks_to_wait, [queue]() { return queue->items.size() < queue->length; })) {
+    return errQUEUE_FULL;
+  }
+
+  auto *bytes = static_cast<const uint8_t *>(item);
+  queue->items.emplace_back(bytes, bytes + queue->item_size);
+  queue->not_empty.notify_one();
+  return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+  return xQueueSendToBack(queue, item, ticks_to_wait);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait) {
+  std::unique_lock<std::mutex> guard(queue->lock);
+  if (!wait_for(guard, queue->not_empty, ticks_to_wait, [queue]() { return !queue->items.empty(); })) {
+    return pdFALSE;
+  }
+
+  memcpy(buffer, queue->items.front().data(), queue->item_size);
+  queue->items.pop_front();
+  queue->not_full.notify_one();
+  return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->items.size();
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+  std::lock_guard<std::mutex> guard(queue->lock);
+  return queue->length - queue->items.size();
+}
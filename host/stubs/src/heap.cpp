@@ -0,0 +1,252 @@
+// Heap accounting: a counting global operator new and heap_caps_* regions
+// with a fixed capacity, so PSRAM placement and allocation failures can be
+// exercised on the host.
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+
+#include "esp_heap_caps.h"
+#include "host/heap.h"
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define HOST_NO_COUNTING_NEW
+#endif
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer)
+#define HOST_NO_COUNTING_NEW
+#endif
+#endif
+
+namespace {
+
+std::atomic<uint64_t> allocations{0};
+std::atomic<uint64_t> frees{0};
+std::atomic<size_t> bytes_in_use{0};
+std::atomic<size_t> peak_bytes{0};
+
+void count_allocation(size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  size_t in_use = bytes_in_use.fetch_add(size, std::memory_order_relaxed) + size;
+  size_t peak = peak_bytes.load(std::memory_order_relaxed);
+  while (in_use > peak && !peak_bytes.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {
+  }
+}
+
+void count_free(size_t size) {
+  frees.fetch_add(1, std::memory_order_relaxed);
+  bytes_in_use.fetch_sub(size, std::memory_order_relaxed);
+}
+
+// heap_caps blocks carry their size and region in a header
+struct alignas(std::max_align_t) BlockHeader {
+  size_t size;
+  bool psram;
+};
+
+struct Region {
+  size_t capacity;
+  size_t used = 0;
+  size_t minimum_free;
+};
+
+struct HeapCaps {
+  std::mutex lock;
+  // Roughly what an ESP32 has left for the application once Wi-Fi and TLS
+  // are up
+  Region internal{160 * 1024, 0, 160 * 1024};
+  Region psram{0, 0, 0};
+  uint32_t fail_next = 0;
+};
+
+HeapCaps &heap_caps() {
+  static HeapCaps caps;
+  return caps;
+}
+
+BlockHeader *header_of(void *ptr) { return static_cast<BlockHeader *>(ptr) - 1; }
+
+}  // namespace
+
+namespace host {
+
+HeapCounters heap_counters() {
+  return HeapCounters{allocations.load(), frees.load(), bytes_in_use.load(), peak_bytes.load()};
+}
+
+void reset_heap_peak() { peak_bytes.store(bytes_in_use.load()); }
+
+bool heap_counting_enabled() {
+#ifdef HOST_NO_COUNTING_NEW
+  return false;
+#else
+  return true;
+#endif
+}
+
+void set_heap_sizes(size_t internal, size_t psram) {
+  HeapCaps &caps = heap_caps();
+  std::lock_guard<std::mutex> guard(caps.lock);
+  caps.internal.capacity = internal;
+  caps.internal.minimum_free = internal > caps.internal.used ? internal - caps.internal.used : 0;
+  caps.psram.capacity = psram;
+  caps.psram.minimum_free = psram > caps.psram.used ? psram - caps.psram.used : 0;
+}
+
+void fail_next_allocations(uint32_t count) {
+  HeapCaps &caps = heap_caps();
+  std::lock_guard<std::mutex> guard(caps.lock);
+  caps.fail_next = count;
+}
+
+}  // namespace host
+
+extern "C" {
+
+void *heap_caps_malloc(size_t size, uint32_t caps) {
+  HeapCaps &heap = heap_caps();
+  bool psram = (caps & MALLOC_CAP_SPIRAM) != 0;
+  {
+    std::lock_guard<std::mutex> guard(heap.lock);
+    Region &region = psram ? heap.psram : heap.internal;
+    if (heap.fail_next > 0) {
+      heap.fail_next--;
+      return nullptr;
+    }
+    if (region.used + size > region.capacity) {
+      return nullptr;
+    }
+    region.used += size;
+    region.minimum_free = std::min(region.minimum_free, region.capacity - region.used);
+  }
+
+  auto *header = static_cast<BlockHeader *>(malloc(sizeof(BlockHeader) + size));
+  header->size = size;
+  header->psram = psram;
+  count_allocation(size);
+  return header + 1;
+}
+
+void heap_caps_free(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+
+  BlockHeader *header = header_of(ptr);
+  {
+    HeapCaps &heap = heap_caps();
+    std::lock_guard<std::mutex> guard(heap.lock);
+    (header->psram ? heap.psram : heap.internal).used -= header->size;
+  }
+  count_free(header->size);
+  free(header);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+  if (ptr == nullptr) {
+    return heap_caps_malloc(size, caps);
+  }
+  if (size == 0) {
+    heap_caps_free(ptr);
+    return nullptr;
+  }
+
+  // Always moves, which is what the device does when the block changes region
+  void *moved = heap_caps_malloc(size, caps);
+  if (moved == nullptr) {
+    return nullptr;
+  }
+  memcpy(moved, ptr, std::min(size, header_of(ptr)->size));
+  heap_caps_free(ptr);
+  return moved;
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+  HeapCaps &heap = heap_caps();
+  std::lock_guard<std::mutex> guard(heap.lock);
+  return (caps & MALLOC_CAP_SPIRAM) != 0 ? heap.psram.capacity : heap.internal.capacity;
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+  HeapCaps &heap = heap_caps();
+  std::lock_guard<std::mutex> guard(heap.lock);
+  const Region &region = (caps & MALLOC_CAP_SPIRAM) != 0 ? heap.psram : heap.internal;
+  return region.capacity - region.used;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+  HeapCaps &heap = heap_caps();
+  std::lock_guard<std::mutex> guard(heap.lock);
+  return (caps & MALLOC_CAP_SPIRAM) != 0 ? heap.psram.minimum_free : heap.internal.minimum_free;
+}
+
+// There's no fragmentation on the host
+size_t heap_caps_get_largest_free_block(uint32_t caps) { return heap_caps_get_free_size(caps); }
+
+}  // extern "C"
+
+#ifndef HOST_NO_COUNTING_NEW
+
+namespace {
+
+void *counted_new(size_t size, std::align_val_t alignment = std::align_val_t(0)) {
+  void *ptr;
+  if (size_t(alignment) > alignof(std::max_align_t)) {
+    ptr = aligned_alloc(size_t(alignment), (size + size_t(alignment) - 1) / size_t(alignment) * size_t(alignment));
+  } else {
+    ptr = malloc(size == 0 ? 1 : size);
+  }
+  if (ptr != nullptr) {
+    count_allocation(malloc_usable_size(ptr));
+  }
+  return ptr;
+}
+
+void counted_delete(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  count_free(malloc_usable_size(ptr));
+  free(ptr);
+}
+
+void *counted_new_or_throw(size_t size, std::align_val_t alignment = std::align_val_t(0)) {
+  void *ptr = counted_new(size, alignment);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+}  // namespace
+
+void *operator new(size_t size) { return counted_new_or_throw(size); }
+void *operator new[](size_t size) { return counted_new_or_throw(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return counted_new(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return counted_new(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return counted_new_or_throw(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return counted_new_or_throw(size, alignment); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return counted_new(size, alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return counted_new(size, alignment);
+}
+
+void operator delete(void *ptr) noexcept { counted_delete(ptr); }
+void operator delete[](void *ptr) noexcept { counted_delete(ptr); }
+void operator delete(void *ptr, size_t) noexcept { counted_delete(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { counted_delete(ptr); }
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { counted_delete(ptr); }
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { counted_delete(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { counted_delete(ptr); }
+void operator delete[](void *ptr, std::align_val_t) noexcept { counted_delete(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { counted_delete(ptr); }
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept { counted_delete(ptr); }
+
+#endif  // HOST_NO_COUNTING_NEW
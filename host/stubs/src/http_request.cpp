@@ -0,0 +1,21 @@
+#include "esphome/components/http_request/http_request.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace esphome {
+namespace http_request {
+
+std::string HttpContainer::get_response_header(const std::string &header_name) {
+  std::string lower(header_name);
+  std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+
+  auto it = this->response_headers_.find(lower);
+  if (it == this->response_headers_.end() || it->second.empty()) {
+    return "";
+  }
+  return it->second.front();
+}
+
+}  // namespace http_request
+}  // namespace esphome
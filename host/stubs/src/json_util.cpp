@@ -0,0 +1,35 @@
+#include "esphome/components/json/json_util.h"
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace json {
+
+static const char *const TAG = "json";
+
+std::string build_json(const json_build_t &f) {
+  JsonDocument json_document;
+  JsonObject root = json_document.to<JsonObject>();
+  f(root);
+  if (json_document.overflowed()) {
+    ESP_LOGE(TAG, "Could not allocate memory for JSON document!");
+    return "{}";
+  }
+  std::string output;
+  serializeJson(json_document, output);
+  return output;
+}
+
+bool parse_json(const std::string &data, const json_parse_t &f) {
+  JsonDocument json_document;
+  DeserializationError err = deserializeJson(json_document, data);
+  if (err) {
+    ESP_LOGE(TAG, "Parse error: %s", err.c_str());
+    return false;
+  }
+  JsonObject root = json_document.as<JsonObject>();
+  return f(root);
+}
+
+}  // namespace json
+}  // namespace esphome
@@ -0,0 +1,34 @@
+#include "esphome/components/time/real_time_clock.h"
+
+#include <cstdlib>
+
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace time {
+
+void RealTimeClock::set_timezone(const std::string &tz) {
+  setenv("TZ", tz.c_str(), 1);
+  tzset();
+}
+
+void RealTimeClock::host_synchronize(time_t epoch) {
+  this->epoch_ = epoch;
+  this->synchronized_at_ = millis();
+  this->synchronized_ = true;
+  for (auto &callback : this->time_sync_callbacks_) {
+    callback();
+  }
+}
+
+void RealTimeClock::host_reset() { this->synchronized_ = false; }
+
+time_t RealTimeClock::timestamp_now() {
+  if (!this->synchronized_) {
+    return millis() / 1000;
+  }
+  return this->epoch_ + time_t((millis() - this->synchronized_at_) / 1000);
+}
+
+}  // namespace time
+}  // namespace esphome
@@ -0,0 +1,55 @@
+// A handshake that never returns must not leave the hub connecting forever:
+// the attempt is abandoned after HANDSHAKE_TIMEOUT, and the device reboots
+// once it has hung for CONNECT_HANG_TIMEOUT.
+
+#include "check.h"
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+#include "host/clock.h"
+#include "host/runtime.h"
+#include "mock_server.h"
+#include "tracker_fixture.h"
+
+using esphome::App;
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+
+  host::MockServer server;
+  CHECK(server.start());
+  // Accepts the connection and never answers the upgrade
+  server.set_stall_handshakes(true);
+
+  host::TrackerOptions options;
+  options.base_url = server.url();
+  options.start_hub = true;
+  host::TrackerFixture fixture(options);
+
+  host::use_manual_clock();
+  fixture.setup();
+  CHECK(host::wait_until([&]() {
+    host::advance_clock(100);
+    App.loop();
+    return server.connections_accepted() > 0;
+  }));
+
+  // Abandoned after HANDSHAKE_TIMEOUT (20 s), hung at CONNECT_HANG_TIMEOUT (60 s)
+  uint32_t elapsed = 0;
+  for (; elapsed < 59000; elapsed += 1000) {
+    host::advance_clock(1000);
+    App.loop();
+    CHECK(!App.is_reboot_requested());
+  }
+  CHECK(!fixture.hub.is_connected());
+
+  for (; elapsed < 62000 && !App.is_reboot_requested(); elapsed += 1000) {
+    host::advance_clock(1000);
+    App.loop();
+  }
+  CHECK(App.is_reboot_requested());
+
+  // Closing the connections lets the stuck attempt return, and its task end
+  server.stop();
+  CHECK(host::stop_tasks());
+  return host_check_exit();
+}
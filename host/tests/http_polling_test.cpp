@@ -0,0 +1,183 @@
+// The HTTP polling fallback reads schedule responses whether or not they
+// carry a Content-Length, and rejects bodies over MAX_POLL_RESPONSE_SIZE.
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "check.h"
+#include "esphome/components/http_request/http_request.h"
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+#include "host/clock.h"
+#include "host/runtime.h"
+#include "mock_server.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+using esphome::App;
+using esphome::http_request::HttpContainer;
+using esphome::http_request::HttpRequestComponent;
+using esphome::http_request::Header;
+
+namespace {
+
+const size_t UNKNOWN_LENGTH = static_cast<size_t>(-1);
+const size_t MAX_POLL_RESPONSE_SIZE = 16384;
+
+// Hands the body out a few hundred bytes per read(), as a socket would
+class CannedContainer : public HttpContainer {
+  public:
+    explicit CannedContainer(std::string body) : body_(std::move(body)) {}
+
+    int read(uint8_t *buf, size_t max_len) override {
+      size_t count = std::min({max_len, this->body_.size() - this->bytes_read_, size_t(300)});
+      memcpy(buf, this->body_.data() + this->bytes_read_, count);
+      this->bytes_read_ += count;
+      return count;
+    }
+    void end() override {}
+
+  protected:
+    std::string body_;
+};
+
+class CannedHttp : public HttpRequestComponent {
+  public:
+    std::string response;
+    size_t content_length = 0;
+    int requests = 0;
+
+  protected:
+    std::shared_ptr<HttpContainer> perform(std::string url, std::string method, std::string body,
+                                           std::list<Header> request_headers,
+                                           std::set<std::string> collect_headers) override {
+      this->requests++;
+      auto container = std::make_shared<CannedContainer>(this->response);
+      container->status_code = 200;
+      container->content_length = this->content_length;
+      return container;
+    }
+};
+
+// Ingested schedules from the first poll, once the websocket has failed often
+// enough for the hub to fall back to polling
+int poll_once(const std::string &body, size_t content_length) {
+  host::MockServer server;
+  CHECK(server.start());
+  server.set_refuse_connections(true);
+
+  CannedHttp http;
+  http.response = body;
+  http.content_length = content_length;
+
+  host::TrackerOptions options;
+  options.base_url = server.url();
+  options.start_hub = true;
+  host::TrackerFixture fixture(options);
+  fixture.hub.set_http_request(&http);
+
+  host::use_manual_clock();
+  fixture.setup();
+  CHECK(host::wait_until([&]() {
+    host::advance_clock(100);
+    App.loop();
+    return http.requests > 0;
+  }, 10000));
+
+  server.stop();
+  const auto &stats = fixture.tracker.get_ingest_stats();
+  return stats.messages - stats.dropped;
+}
+
+// A response that doesn't parse marks the tracker as failed until a later
+// poll brings a schedule that does
+bool error_clears_after_good_poll(const std::string &data) {
+  host::MockServer server;
+  CHECK(server.start());
+  server.set_refuse_connections(true);
+
+  CannedHttp http;
+  http.response = "{\"departures\": [";
+  http.content_length = http.response.size();
+
+  host::TrackerOptions options;
+  options.base_url = server.url();
+  options.start_hub = true;
+  host::TrackerFixture fixture(options);
+  fixture.hub.set_http_request(&http);
+
+  host::use_manual_clock();
+  fixture.setup();
+  CHECK(host::wait_until([&]() {
+    host::advance_clock(100);
+    App.loop();
+    return http.requests > 0;
+  }, 10000));
+  CHECK(fixture.tracker.status_has_error());
+
+  http.response = data;
+  http.content_length = data.size();
+  CHECK(host::wait_until([&]() {
+    host::advance_clock(1000);
+    App.loop();
+    return http.requests > 1;
+  }, 10000));
+
+  server.stop();
+  return !fixture.tracker.status_has_error();
+}
+
+// Without a ws:// or wss:// base_url there's nothing to derive the schedule
+// URL from, so the hub keeps to the websocket rather than polling
+int polls_without_base_url() {
+  CannedHttp http;
+
+  host::TrackerOptions options;
+  options.base_url = "";
+  options.start_hub = true;
+  host::TrackerFixture fixture(options);
+  fixture.hub.set_http_request(&http);
+
+  host::use_manual_clock();
+  fixture.setup();
+  for (int i = 0; i < 1000; i++) {
+    host::advance_clock(100);
+    App.loop();
+  }
+
+  return http.requests;
+}
+
+}  // namespace
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+
+  host::ScheduleOptions schedule;
+  std::string data = host::make_schedule_data(schedule);
+
+  CHECK_EQ(poll_once(data, data.size()), 1);
+  // Chunked, as reported by the ESP-IDF and Arduino backends respectively
+  CHECK_EQ(poll_once(data, 0), 1);
+  CHECK_EQ(poll_once(data, UNKNOWN_LENGTH), 1);
+
+  // Truncated
+  CHECK_EQ(poll_once(data.substr(0, data.size() / 2), data.size()), 0);
+  CHECK_EQ(poll_once("", 0), 0);
+
+  // A schedule padded to the limit is read; one byte over is not
+  std::string largest = data;
+  largest.insert(largest.size() - 1, ",\"padding\":\"\"");
+  largest.insert(largest.size() - 2, std::string(MAX_POLL_RESPONSE_SIZE - largest.size(), 'x'));
+  CHECK_EQ(largest.size(), MAX_POLL_RESPONSE_SIZE);
+  CHECK_EQ(poll_once(largest, 0), 1);
+  CHECK_EQ(poll_once(largest + " ", 0), 0);
+  CHECK_EQ(poll_once(largest + " ", largest.size() + 1), 0);
+
+  CHECK(error_clears_after_good_poll(data));
+  CHECK_EQ(polls_without_base_url(), 0);
+
+  return host_check_exit();
+}
@@ -0,0 +1,119 @@
+// Countdown formatting writes into the caller's buffer, so time strings cost
+// the render loop no heap allocations. Checked with the host's counting
+// operator new.
+
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host/clock.h"
+#include "host/heap.h"
+#include "host/runtime.h"
+#include "localization.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+using esphome::transit_tracker::Localization;
+using esphome::transit_tracker::UNIT_DISPLAY_LONG;
+using esphome::transit_tracker::UNIT_DISPLAY_NONE;
+using esphome::transit_tracker::UNIT_DISPLAY_SHORT;
+
+namespace {
+
+const time_t NOW = 1700000000;
+
+// Its templates point into its own strings
+static_assert(!std::is_copy_constructible_v<Localization> && !std::is_move_constructible_v<Localization>);
+static_assert(!std::is_copy_assignable_v<Localization> && !std::is_move_assignable_v<Localization>);
+
+std::string format(const Localization &localization, int seconds, bool rtl = false) {
+  char buffer[32];
+  localization.fmt_duration_from_now(buffer, sizeof(buffer), NOW + seconds, NOW, rtl);
+  return buffer;
+}
+
+}  // namespace
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+
+  Localization localization;
+  localization.set_hours_short_string("h");
+  CHECK(format(localization, 10) == "Now");
+  CHECK(format(localization, 45) == "0min");
+  CHECK(format(localization, 5 * 60) == "5min");
+  CHECK(format(localization, 5 * 60, true) == "min5");
+  CHECK(format(localization, 65 * 60) == "1h5m");
+
+  // Each setter writes its own string
+  localization.set_unit_display(UNIT_DISPLAY_SHORT);
+  localization.set_minutes_long_string("minutes");
+  localization.set_minutes_short_string("'");
+  CHECK(format(localization, 5 * 60) == "5'");
+  localization.set_unit_display(UNIT_DISPLAY_NONE);
+  CHECK(format(localization, 65 * 60) == "1:05");
+
+  // The text stays the same up to valid_until and changes right after it
+  localization.set_unit_display(UNIT_DISPLAY_LONG);
+  for (int seconds : {45, 5 * 60 + 20, 65 * 60 + 59}) {
+    char before[32];
+    char at[32];
+    char after[32];
+    time_t valid_until;
+    localization.fmt_duration_from_now(before, sizeof(before), NOW + seconds, NOW, false, &valid_until);
+    localization.fmt_duration_from_now(at, sizeof(at), NOW + seconds, valid_until, false);
+    localization.fmt_duration_from_now(after, sizeof(after), NOW + seconds, valid_until + 1, false);
+    CHECK(strcmp(before, at) == 0);
+    CHECK(strcmp(before, after) != 0);
+  }
+
+  // Truncated to the buffer, and always terminated
+  char small[3];
+  CHECK_EQ(localization.fmt_duration_from_now(small, sizeof(small), NOW + 65 * 60, NOW), 2u);
+  CHECK(strcmp(small, "1h") == 0);
+
+  if (!host::heap_counting_enabled()) {
+    printf("Allocation checks skipped: operator new belongs to the sanitizer\n");
+    return host_check_exit();
+  }
+
+  char buffer[32];
+  // The first localtime call may load the time zone
+  localization.fmt_time_of_day(buffer, sizeof(buffer), NOW);
+
+  uint64_t allocations = host::heap_counters().allocations;
+  for (bool rtl : {false, true}) {
+    for (int seconds = -120; seconds < 3 * 3600; seconds += 7) {
+      time_t valid_until;
+      localization.fmt_duration_from_now(buffer, sizeof(buffer), NOW + seconds, NOW, rtl, &valid_until);
+      localization.fmt_time_of_day(buffer, sizeof(buffer), NOW + seconds);
+    }
+  }
+  CHECK_EQ(host::heap_counters().allocations - allocations, 0u);
+
+  // Nor does the tracker allocate while countdowns tick over, once the
+  // schedule is laid out
+  host::use_manual_clock();
+  host::TrackerOptions options;
+  options.base_url = "";
+  options.limit = 6;
+  host::TrackerFixture fixture(options);
+  fixture.setup();
+  host::ScheduleOptions schedule;
+  schedule.now = NOW;
+  schedule.trips = 6;
+  schedule.spacing = 60;
+  CHECK(fixture.deliver(host::make_schedule_message(schedule)));
+  fixture.draw();
+
+  allocations = host::heap_counters().allocations;
+  for (int frame = 0; frame < 300; frame++) {
+    host::advance_clock(1000);
+    fixture.draw();
+  }
+  CHECK_EQ(host::heap_counters().allocations - allocations, 0u);
+
+  return host_check_exit();
+}
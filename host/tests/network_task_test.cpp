@@ -0,0 +1,80 @@
+// The hub's network task must never block on the full message queue while
+// holding the client lock: the main loop takes that lock to send and ping
+// while it drains the queue. On shutdown it stops on its own.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "check.h"
+#include "esphome/core/application.h"
+#include "host/runtime.h"
+#include "mock_server.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+using esphome::App;
+
+int main() {
+  host::MockServer server;
+  CHECK(server.start());
+
+  host::TrackerOptions options;
+  options.base_url = server.url();
+  options.start_hub = true;
+  host::TrackerFixture fixture(options);
+  fixture.hub.set_network_task(true);
+  fixture.setup();
+
+  CHECK(host::wait_until([&]() {
+    App.loop();
+    return server.subscribes() > 0;
+  }));
+
+  // With loop() not running, the network task fills the queue and then
+  // waits for room
+  // Several times the queue length
+  const uint32_t burst = 12;
+  host::ScheduleOptions schedule;
+  schedule.now = options.now;
+  for (uint32_t i = 0; i < burst; i++) {
+    schedule.variant = i;
+    server.broadcast(host::make_schedule_message(schedule));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // Sending from the main loop meanwhile must not wait on the network task
+  std::atomic<bool> sent{false};
+  std::thread sender([&]() {
+    fixture.hub.send("{\"event\":\"ping\"}");
+    sent = true;
+  });
+  if (!host::wait_until([&]() { return sent.load(); }, 2000)) {
+    fprintf(stderr, "send() blocked behind the network task\n");
+    fflush(stderr);
+    // The threads can't be unwound from here
+    _exit(1);
+  }
+  sender.join();
+
+  CHECK(host::wait_until([&]() {
+    App.loop();
+    return fixture.tracker.get_ingest_stats().messages >= burst;
+  }));
+  CHECK_EQ(fixture.tracker.get_ingest_stats().messages, burst);
+  CHECK_EQ(fixture.tracker.get_ingest_stats().dropped, 0u);
+
+  // Shutting down with the queue full again stops the task while it waits
+  // for room, and frees what it had queued
+  for (uint32_t i = 0; i < burst; i++) {
+    schedule.variant = i;
+    server.broadcast(host::make_schedule_message(schedule));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  App.run_safe_shutdown_hooks();
+  CHECK(host::wait_until([]() { return host::running_tasks() == 0; }, 1000));
+
+  server.stop();
+  return host_check_exit();
+}
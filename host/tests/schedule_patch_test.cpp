@@ -0,0 +1,65 @@
+// A schedule:patch update may change a trip's route name or color without
+// repeating its routeId, and fields it leaves out keep their values. Checked
+// by drawing the patched schedule next to the full schedule it amounts to.
+
+#include <string>
+#include <vector>
+
+#include "check.h"
+#include "esphome/core/log.h"
+#include "host/runtime.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+namespace {
+
+std::string replace(std::string str, const std::string &from, const std::string &to) {
+  size_t pos = str.find(from);
+  CHECK(pos != std::string::npos);
+  return pos == std::string::npos ? str : str.replace(pos, from.size(), to);
+}
+
+std::string make_patch(const std::string &updates) {
+  return "{\"event\":\"schedule:patch\",\"data\":{\"seq\":2,\"update\":[" + updates + "]}}";
+}
+
+uint32_t frame_after(const std::vector<std::string> &messages) {
+  host::TrackerFixture fixture;
+  fixture.tracker.set_schedule_patches(true);
+  fixture.setup();
+  for (const std::string &message : messages) {
+    CHECK(fixture.deliver(message));
+  }
+  fixture.draw();
+  return fixture.display.hash();
+}
+
+}  // namespace
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+
+  host::ScheduleOptions schedule;
+  schedule.seq = 1;
+  std::string base = host::make_schedule_data(schedule);
+  std::string base_message = "{\"event\":\"schedule\",\"data\":" + base + "}";
+  uint32_t base_frame = frame_after({base_message});
+
+  // trip-0 is on route-0 (A1, 3366CC) and trip-1 on route-1 (B2)
+  std::string recolored = replace(base, "\"routeColor\":\"3366CC\"", "\"routeColor\":\"FF0000\"");
+  uint32_t recolored_frame = frame_after({"{\"event\":\"schedule\",\"data\":" + recolored + "}"});
+  CHECK(recolored_frame != base_frame);
+  CHECK_EQ(frame_after({base_message, make_patch("{\"tripId\":\"trip-0\",\"routeColor\":\"FF0000\"}")}),
+           recolored_frame);
+
+  std::string renamed = replace(base, "\"routeName\":\"B2\"", "\"routeName\":\"Z9\"");
+  uint32_t renamed_frame = frame_after({"{\"event\":\"schedule\",\"data\":" + renamed + "}"});
+  CHECK(renamed_frame != base_frame);
+  CHECK_EQ(frame_after({base_message, make_patch("{\"tripId\":\"trip-1\",\"routeName\":\"Z9\"}")}), renamed_frame);
+
+  // An update without route fields leaves the route alone; trip-2 is already
+  // realtime
+  CHECK_EQ(frame_after({base_message, make_patch("{\"tripId\":\"trip-2\",\"isRealtime\":true}")}), base_frame);
+
+  return host_check_exit();
+}
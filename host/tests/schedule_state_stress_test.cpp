@@ -0,0 +1,166 @@
+// Ingest and render on separate threads: readers must only ever see whole,
+// published schedules, and the tracker must draw while schedules arrive.
+//
+//   schedule_state_stress_test [--quick]
+
+#include <atomic>
+#include <cinttypes>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "host/clock.h"
+#include "schedule_state.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+using esphome::transit_tracker::Schedule;
+using esphome::transit_tracker::ScheduleState;
+using esphome::transit_tracker::Trip;
+
+namespace {
+
+// Every trip and headsign of a schedule carries the same tag, so a reader can
+// tell a torn or recycled-while-read schedule from a whole one
+void fill_schedule(Schedule &schedule, uint32_t tag) {
+  size_t count = 1 + tag % 12;
+  std::string headsign = "headsign " + std::to_string(tag);
+  for (size_t i = 0; i < count; i++) {
+    Trip trip{};
+    trip.trip_key = tag;
+    trip.arrival_time = tag;
+    trip.headsign_offset = schedule.headsigns.add(headsign);
+    trip.headsign_length = headsign.size();
+    schedule.trips.push_back(trip);
+  }
+}
+
+bool schedule_is_whole(const Schedule &schedule) {
+  if (schedule.trips.empty()) {
+    return schedule.generation == 0;
+  }
+
+  uint32_t tag = schedule.trips[0].trip_key;
+  if (schedule.trips.size() != 1 + tag % 12) {
+    return false;
+  }
+
+  std::string headsign = "headsign " + std::to_string(tag);
+  for (const Trip &trip : schedule.trips) {
+    if (trip.trip_key != tag || trip.arrival_time != time_t(tag) || headsign != schedule.headsign(trip)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void stress_schedule_state(uint32_t publishes, int readers) {
+  ScheduleState state;
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> loads{0};
+  std::atomic<uint32_t> torn{0};
+  std::atomic<uint32_t> went_back{0};
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < readers; i++) {
+    threads.emplace_back([&] {
+      uint32_t last_generation = 0;
+      while (!done.load()) {
+        std::shared_ptr<const Schedule> schedule = state.load();
+        // Hold it a little, as a frame would
+        for (int pass = 0; pass < 2; pass++) {
+          if (!schedule_is_whole(*schedule)) {
+            torn++;
+          }
+        }
+        if (schedule->generation < last_generation) {
+          went_back++;
+        }
+        last_generation = schedule->generation;
+        loads++;
+      }
+    });
+  }
+
+  for (uint32_t tag = 1; tag <= publishes; tag++) {
+    Schedule &next = state.begin();
+    fill_schedule(next, tag);
+    state.publish();
+  }
+
+  done = true;
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  printf("ScheduleState: %" PRIu32 " publishes, %" PRIu64 " loads on %d readers\n", publishes, loads.load(), readers);
+  CHECK_EQ(torn.load(), 0u);
+  CHECK_EQ(went_back.load(), 0u);
+  CHECK(schedule_is_whole(*state.load()));
+  CHECK_EQ(state.load()->generation, publishes);
+}
+
+// The whole tracker: messages ingested on one thread while another draws
+void stress_tracker(uint32_t messages) {
+  host::TrackerOptions options;
+  options.limit = 6;
+  options.height = 64;
+  options.scroll_headsigns = true;
+  host::TrackerFixture fixture(options);
+  fixture.setup();
+
+  std::atomic<bool> done{false};
+  std::atomic<uint32_t> frames{0};
+
+  std::thread renderer([&] {
+    while (!done.load()) {
+      fixture.draw();
+      frames++;
+    }
+  });
+
+  host::ScheduleOptions schedule;
+  schedule.now = options.now;
+  for (uint32_t i = 0; i < messages; i++) {
+    schedule.variant = i;
+    schedule.trips = 1 + i % 6;
+    schedule.long_headsigns = i % 2 == 0;
+    schedule.rtl = false;
+    CHECK(fixture.deliver(host::make_schedule_message(schedule)));
+  }
+
+  // Let the renderer catch up with the last schedule
+  uint32_t seen = frames.load();
+  while (frames.load() < seen + 2) {
+    std::this_thread::yield();
+  }
+  done = true;
+  renderer.join();
+
+  printf("Tracker: %" PRIu32 " schedules ingested during %" PRIu32 " frames\n", messages, frames.load());
+  CHECK_EQ(fixture.tracker.get_ingest_stats().messages, messages);
+  CHECK(frames.load() > 0);
+
+  // The final frame matches one drawn with nothing else going on
+  fixture.draw();
+  uint32_t concurrent = fixture.display.hash();
+  fixture.draw();
+  CHECK_EQ(fixture.display.hash(), concurrent);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  bool quick = argc > 1 && strcmp(argv[1], "--quick") == 0;
+
+  // The render thread and ingest both run off the host clock; freeze it so
+  // the last frames are comparable
+  host::use_manual_clock();
+
+  stress_schedule_state(quick ? 2000 : 200000, 3);
+  stress_tracker(quick ? 200 : 5000);
+
+  return host_check_exit();
+}
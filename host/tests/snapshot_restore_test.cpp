@@ -0,0 +1,130 @@
+// A schedule saved before a reboot is drawn at boot, while Wi-Fi connects and
+// before the clock is set: as stale scheduled times until SNTP syncs, then
+// with countdowns, unless the snapshot turns out to be too old to show.
+
+#include <cstdint>
+
+#include "check.h"
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+#include "host/runtime.h"
+#include "schedules.h"
+#include "tracker_fixture.h"
+
+using esphome::App;
+using esphome::Component;
+
+namespace {
+
+const time_t NOW = 1700000000;
+// TransitTracker::SNAPSHOT_MAX_AGE
+const time_t SNAPSHOT_MAX_AGE = 2 * 60 * 60;
+// Times of day drawn for trips restored before the clock was set
+const esphome::Color STALE_COLOR(0x505050);
+
+// Holds up Application::setup() like Wi-Fi does until it connects, and
+// draws a frame from its first loop, as the display would in the meantime
+class WifiWait : public Component {
+  public:
+    explicit WifiWait(host::TrackerFixture &fixture) : fixture_(fixture) {}
+
+    float get_setup_priority() const override { return esphome::setup_priority::WIFI; }
+    bool can_proceed() override { return this->frame_ != 0; }
+    void loop() override {
+      if (this->frame_ == 0) {
+        this->fixture_.draw();
+        this->frame_ = this->fixture_.display.hash();
+      }
+    }
+
+    uint32_t frame() const { return this->frame_; }
+
+  protected:
+    host::TrackerFixture &fixture_;
+    uint32_t frame_ = 0;
+};
+
+host::TrackerOptions boot_options() {
+  host::TrackerOptions options;
+  options.persist_schedule = true;
+  options.base_url = "";
+  options.now = 0;
+  return options;
+}
+
+// The frame drawn during the Wi-Fi wait at boot, with the RTC unsynchronized
+uint32_t boot_frame() {
+  host::TrackerFixture fixture(boot_options());
+  WifiWait wifi(fixture);
+  App.register_component(&wifi);
+  fixture.setup();
+  return wifi.frame();
+}
+
+// The frame once the clock is set to `now`, with whatever the snapshot held
+uint32_t synced_frame(time_t now) {
+  host::TrackerFixture fixture(boot_options());
+  fixture.setup();
+  fixture.rtc.host_synchronize(now);
+  fixture.draw();
+  return fixture.display.hash();
+}
+
+bool has_pixels_of(host::FramebufferDisplay &display, esphome::Color color) {
+  for (int y = 0; y < display.get_height(); y++) {
+    for (int x = 0; x < display.get_width(); x++) {
+      if (display.pixel(x, y) == color) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+int main() {
+  host::set_log_level(ESPHOME_LOG_LEVEL_NONE);
+  host::wipe_preferences();
+
+  uint32_t status_frame = boot_frame();
+  CHECK(status_frame != 0);
+  uint32_t empty_frame = synced_frame(NOW + SNAPSHOT_MAX_AGE + 60);
+
+  {
+    host::TrackerOptions options = boot_options();
+    options.now = NOW;
+    host::TrackerFixture fixture(options);
+    fixture.setup();
+    host::ScheduleOptions schedule;
+    schedule.now = NOW;
+    CHECK(fixture.deliver(host::make_schedule_message(schedule)));
+  }
+
+  // Set up ahead of Wi-Fi, so the snapshot is on screen while it connects
+  uint32_t restored_frame = boot_frame();
+  CHECK(restored_frame != status_frame);
+
+  host::TrackerFixture fixture(boot_options());
+  fixture.setup();
+  fixture.draw();
+  CHECK_EQ(fixture.display.hash(), restored_frame);
+  CHECK(has_pixels_of(fixture.display, STALE_COLOR));
+
+  // Scheduled times don't change until the clock does
+  CHECK(!fixture.tracker.needs_redraw());
+
+  fixture.rtc.host_synchronize(NOW);
+  CHECK(fixture.tracker.needs_redraw());
+  fixture.draw();
+  CHECK(fixture.display.hash() != restored_frame);
+  CHECK(!has_pixels_of(fixture.display, STALE_COLOR));
+  CHECK(fixture.display.hash() != empty_frame);
+
+  // A snapshot found to be older than the limit once the clock is set is
+  // dropped, rather than left showing trips that may be long gone
+  CHECK_EQ(synced_frame(NOW + SNAPSHOT_MAX_AGE + 60), empty_frame);
+
+  host::wipe_preferences();
+  return host_check_exit();
+}
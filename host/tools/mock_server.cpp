@@ -0,0 +1,206 @@
+// A local Transit Tracker server for pointing a device or the host build at:
+// serves generated schedules, or plays a recorded trace, to every subscriber.
+//
+//   transit_tracker_mock_server [--port N] [--trace FILE] [--speed X] [--heartbeat MS]
+//                               [--trips N] [--rtl] [--loop]
+//
+// With a trace, trip times are shifted by the time since it was recorded, so
+// a device with a synchronized clock shows them as upcoming. Each subscriber
+// gets messages in the encoding its subscribe asked for, JSON unless it sent
+// "encoding":"msgpack".
+
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <thread>
+
+#include "esphome/core/hal.h"
+#include "host/clock.h"
+#include "mock_server.h"
+#include "schedules.h"
+#include "trace.h"
+
+using namespace host;
+
+namespace {
+
+volatile sig_atomic_t interrupted = 0;
+
+// Adds `shift` seconds to every arrivalTime and departureTime
+std::string shift_times(const std::string &payload, time_t shift) {
+  static const std::regex TIME_FIELD("\"(arrivalTime|departureTime)\":(\\d+)");
+  std::string shifted;
+  auto last = payload.cbegin();
+  for (std::sregex_iterator it(payload.begin(), payload.end(), TIME_FIELD), end; it != end; ++it) {
+    const std::smatch &match = *it;
+    shifted.append(last, match[0].first);
+    shifted += "\"" + match[1].str() + "\":" + std::to_string(std::stoll(match[2].str()) + shift);
+    last = match[0].second;
+  }
+  shifted.append(last, payload.cend());
+  return shifted;
+}
+
+int usage() {
+  fprintf(stderr, "usage: transit_tracker_mock_server [--port N] [--trace FILE] [--speed X] [--heartbeat MS]\n"
+                  "                                   [--trips N] [--rtl] [--loop]\n");
+  return EXIT_FAILURE;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+
+  uint16_t port = 8080;
+  std::string trace_path;
+  double speed = 1.0;
+  uint32_t heartbeat = 15000;
+  int trips = 6;
+  bool rtl = false;
+  bool loop = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--port" && has_value) {
+      port = atoi(argv[++i]);
+    } else if (arg == "--trace" && has_value) {
+      trace_path = argv[++i];
+    } else if (arg == "--speed" && has_value) {
+      speed = atof(argv[++i]);
+    } else if (arg == "--heartbeat" && has_value) {
+      heartbeat = atoi(argv[++i]);
+    } else if (arg == "--trips" && has_value) {
+      trips = atoi(argv[++i]);
+    } else if (arg == "--rtl") {
+      rtl = true;
+    } else if (arg == "--loop") {
+      loop = true;
+    } else {
+      return usage();
+    }
+  }
+
+  Trace trace;
+  if (!trace_path.empty()) {
+    std::string error;
+    if (!load_trace(trace_path, &trace, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+
+  set_clock_speed(speed);
+
+  MockServer server;
+  // Guards latest and subscribers. The subscribe handler takes it under the
+  // server's lock, so it must not be held while calling into the server.
+  std::mutex latest_lock;
+  TraceEvent latest{0, false, ""};
+  // Whether each subscribed connection asked for MessagePack
+  std::map<int, bool> subscribers;
+
+  auto generate = [&]() {
+    ScheduleOptions options;
+    options.trips = trips;
+    options.rtl = rtl;
+    options.long_headsigns = true;
+    options.now = time(nullptr);
+    options.variant = esphome::millis() / 30000;
+    return TraceEvent{0, false, make_schedule_message(options)};
+  };
+
+  auto send = [&](int connection, const TraceEvent &event, bool msgpack) {
+    TraceEvent encoded = encode_event(event, msgpack);
+    server.send(connection, encoded.payload, encoded.binary);
+  };
+
+  // Encodes each message once per encoding in use
+  auto broadcast = [&](const TraceEvent &event) {
+    std::map<int, bool> recipients;
+    {
+      std::lock_guard<std::mutex> guard(latest_lock);
+      recipients = subscribers;
+    }
+
+    TraceEvent encoded[2];
+    bool have[2] = {false, false};
+    for (const auto &recipient : recipients) {
+      bool msgpack = recipient.second;
+      if (!have[msgpack]) {
+        encoded[msgpack] = encode_event(event, msgpack);
+        have[msgpack] = true;
+      }
+      server.send(recipient.first, encoded[msgpack].payload, encoded[msgpack].binary);
+    }
+  };
+
+  server.on_subscribe([&](int connection, const std::string &message) {
+    printf("Subscribe: %s\n", message.c_str());
+    // Recognized without parsing, like the subscribe itself
+    bool msgpack = message.find("\"encoding\":\"msgpack\"") != std::string::npos;
+    std::lock_guard<std::mutex> guard(latest_lock);
+    subscribers[connection] = msgpack;
+    if (trace.events.empty()) {
+      send(connection, generate(), msgpack);
+    } else if (!latest.payload.empty()) {
+      send(connection, latest, msgpack);
+    }
+  });
+
+  // Recorded traces carry their own heartbeats
+  server.set_heartbeat_interval(trace.events.empty() ? heartbeat : 0);
+  if (!server.start(port)) {
+    fprintf(stderr, "Cannot listen on port %u\n", port);
+    return EXIT_FAILURE;
+  }
+  printf("Listening on %s\n", server.url().c_str());
+
+  signal(SIGINT, [](int) { interrupted = 1; });
+  signal(SIGTERM, [](int) { interrupted = 1; });
+
+  if (trace.events.empty()) {
+    while (!interrupted) {
+      sleep_clock(30000);
+      if (!interrupted) {
+        broadcast(generate());
+      }
+    }
+  } else {
+    do {
+      uint32_t start = esphome::millis();
+      time_t shift = trace.epoch != 0 ? time(nullptr) - trace.epoch : 0;
+      for (const TraceEvent &event : trace.events) {
+        while (!interrupted && static_cast<int32_t>(esphome::millis() - start - event.at_ms) < 0) {
+          sleep_clock(std::min<uint32_t>(event.at_ms - (esphome::millis() - start), 100));
+        }
+        if (interrupted) {
+          break;
+        }
+
+        // Times are shifted in the JSON form, whatever the trace was recorded in
+        TraceEvent shifted = encode_event(event, false);
+        if (!shifted.binary && shift != 0) {
+          shifted.payload = shift_times(shifted.payload, shift);
+        }
+        if (event_name(event) == "schedule") {
+          std::lock_guard<std::mutex> guard(latest_lock);
+          latest = shifted;
+        }
+        broadcast(shifted);
+      }
+    } while (loop && !interrupted);
+  }
+
+  printf("Sent %" PRIu64 " messages to %" PRIu32 " connections\n", server.messages_sent(),
+         server.connections_accepted());
+  return EXIT_SUCCESS;
+}
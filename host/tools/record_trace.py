@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""Records a Transit Tracker server's messages into a replay trace.
+
+The host build's websocket client has no TLS, so this records from wss://
+servers. The output is the format transit_tracker_replay reads:
+
+    python3 host/tools/record_trace.py wss://tt.example.com/ out.trace \\
+        --schedule "1_100;1_200" --seconds 900
+
+Needs the `websockets` package.
+"""
+
+import argparse
+import asyncio
+import base64
+import json
+import time
+
+import websockets
+
+
+def format_event(at_ms, message):
+    if isinstance(message, bytes):
+        return f"{at_ms}\tb\t{base64.b64encode(message).decode()}\n"
+    if "\n" in message or "\r" in message:
+        return f"{at_ms}\tT\t{base64.b64encode(message.encode()).decode()}\n"
+    return f"{at_ms}\tt\t{message}\n"
+
+
+async def record(args):
+    subscribe = {
+        "event": "schedule:subscribe",
+        "data": {
+            "subscriptionId": 0,
+            "routeStopPairs": args.schedule,
+            "limit": args.limit,
+            "sortByDeparture": False,
+            "listMode": "sequential",
+        },
+    }
+    if args.feed:
+        subscribe["data"]["feedCode"] = args.feed
+    if args.msgpack:
+        subscribe["data"]["encoding"] = "msgpack"
+
+    events = 0
+    with open(args.trace, "w") as out:
+        out.write(f"# transit-tracker trace v1\n# epoch {int(time.time())}\n")
+        start = time.monotonic()
+        async with websockets.connect(args.url, max_size=None) as socket:
+            await socket.send(json.dumps(subscribe))
+            deadline = start + args.seconds
+            while time.monotonic() < deadline:
+                try:
+                    message = await asyncio.wait_for(socket.recv(), deadline - time.monotonic())
+                except asyncio.TimeoutError:
+                    break
+                out.write(format_event(int((time.monotonic() - start) * 1000), message))
+                out.flush()
+                events += 1
+
+    print(f"Recorded {events} events to {args.trace}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("url")
+    parser.add_argument("trace")
+    parser.add_argument("--schedule", required=True, help="routeStopPairs, as in the YAML config")
+    parser.add_argument("--limit", type=int, default=6)
+    parser.add_argument("--feed", default="")
+    parser.add_argument("--seconds", type=int, default=900)
+    parser.add_argument("--msgpack", action="store_true")
+    try:
+        asyncio.run(record(parser.parse_args()))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,280 @@
+// Records traces from a Transit Tracker server and replays them against the
+// host build through a local mock server.
+//
+//   transit_tracker_replay synthesize <trace> [--seconds N] [--trips N] [--rtl] [--msgpack]
+//   transit_tracker_replay record <ws-url> <trace> --schedule PAIRS [--limit N] [--feed CODE]
+//                                 [--seconds N] [--msgpack]
+//   transit_tracker_replay replay <trace> [--speed X] [--scenario NAME|all] [--network-task]
+//                                 [--rtl] [--limit N] [--check]
+//
+// The host client has no TLS; tools/record_trace.py records from wss:// URLs
+// into the same format.
+
+#include <ArduinoWebsockets.h>
+
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "host/runtime.h"
+#include "replay.h"
+#include "trace.h"
+
+using namespace host;
+
+namespace {
+
+struct Arguments {
+  std::vector<std::string> positional;
+  std::vector<std::pair<std::string, std::string>> options;
+
+  bool flag(const char *name) const {
+    for (const auto &option : this->options) {
+      if (option.first == name) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::string value(const char *name, const std::string &fallback = "") const {
+    for (const auto &option : this->options) {
+      if (option.first == name) {
+        return option.second;
+      }
+    }
+    return fallback;
+  }
+};
+
+// Options that take a value; everything else starting with -- is a flag
+const char *const VALUE_OPTIONS[] = {"--seconds", "--trips", "--schedule", "--limit", "--feed", "--speed",
+                                     "--scenario"};
+
+bool parse_arguments(int argc, char **argv, Arguments *arguments) {
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      arguments->positional.push_back(arg);
+      continue;
+    }
+
+    bool takes_value = false;
+    for (const char *name : VALUE_OPTIONS) {
+      takes_value |= arg == name;
+    }
+    if (takes_value && i + 1 >= argc) {
+      fprintf(stderr, "%s needs a value\n", arg.c_str());
+      return false;
+    }
+    arguments->options.emplace_back(arg, takes_value ? argv[++i] : "");
+  }
+  return true;
+}
+
+int usage() {
+  fprintf(stderr,
+          "usage:\n"
+          "  transit_tracker_replay synthesize <trace> [--seconds N] [--trips N] [--rtl] [--msgpack]\n"
+          "  transit_tracker_replay record <ws-url> <trace> --schedule PAIRS [--limit N] [--feed CODE]\n"
+          "                                [--seconds N] [--msgpack]\n"
+          "  transit_tracker_replay replay <trace> [--speed X] [--scenario NAME|all] [--network-task]\n"
+          "                                [--rtl] [--limit N] [--check]\n"
+          "scenarios: steady burst heartbeat-gap server-restart\n");
+  return EXIT_FAILURE;
+}
+
+int synthesize(const Arguments &arguments) {
+  if (arguments.positional.size() != 1) {
+    return usage();
+  }
+
+  SynthesizeOptions options;
+  options.duration_ms = std::stoul(arguments.value("--seconds", "900")) * 1000;
+  options.trips = std::stoi(arguments.value("--trips", "6"));
+  options.rtl = arguments.flag("--rtl");
+  options.msgpack = arguments.flag("--msgpack");
+
+  Trace trace = synthesize_trace(options);
+  if (!save_trace(arguments.positional[0], trace)) {
+    fprintf(stderr, "Cannot write %s\n", arguments.positional[0].c_str());
+    return EXIT_FAILURE;
+  }
+  printf("Wrote %zu events over %" PRIu32 "s to %s\n", trace.events.size(), trace.duration_ms() / 1000,
+         arguments.positional[0].c_str());
+  return EXIT_SUCCESS;
+}
+
+volatile sig_atomic_t interrupted = 0;
+
+int record(const Arguments &arguments) {
+  std::string schedule = arguments.value("--schedule");
+  if (arguments.positional.size() != 2 || schedule.empty()) {
+    return usage();
+  }
+  const std::string &url = arguments.positional[0];
+  const std::string &path = arguments.positional[1];
+  uint32_t seconds = std::stoul(arguments.value("--seconds", "900"));
+
+  TraceWriter writer;
+  time_t epoch = time(nullptr);
+  if (!writer.open(path, epoch)) {
+    fprintf(stderr, "Cannot write %s\n", path.c_str());
+    return EXIT_FAILURE;
+  }
+
+  websockets::WebsocketsClient client;
+  uint32_t start = esphome::millis();
+  size_t events = 0;
+  client.onMessage([&](websockets::WebsocketsMessage message) {
+    writer.write({esphome::millis() - start, message.isBinary(), message.rawData()});
+    events++;
+  });
+
+  if (!client.connect(url.c_str())) {
+    fprintf(stderr, "Cannot connect to %s\n", url.c_str());
+    return EXIT_FAILURE;
+  }
+
+  std::string subscribe = "{\"event\":\"schedule:subscribe\",\"data\":{\"subscriptionId\":0,\"routeStopPairs\":\"" +
+                          schedule + "\",\"limit\":" + arguments.value("--limit", "6") +
+                          ",\"sortByDeparture\":false,\"listMode\":\"sequential\"";
+  std::string feed = arguments.value("--feed");
+  if (!feed.empty()) {
+    subscribe += ",\"feedCode\":\"" + feed + "\"";
+  }
+  if (arguments.flag("--msgpack")) {
+    subscribe += ",\"encoding\":\"msgpack\"";
+  }
+  subscribe += "}}";
+  client.send(subscribe.c_str());
+
+  signal(SIGINT, [](int) { interrupted = 1; });
+  printf("Recording %s for %" PRIu32 "s, Ctrl-C to stop early\n", url.c_str(), seconds);
+  while (!interrupted && esphome::millis() - start < seconds * 1000 && client.available()) {
+    client.poll();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  client.close();
+  printf("Recorded %zu events to %s\n", events, path.c_str());
+  return EXIT_SUCCESS;
+}
+
+int replay(const Arguments &arguments) {
+  if (arguments.positional.size() != 1) {
+    return usage();
+  }
+
+  Trace trace;
+  std::string error;
+  if (!load_trace(arguments.positional[0], &trace, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return EXIT_FAILURE;
+  }
+
+  ReplayOptions options;
+  options.speed = std::stod(arguments.value("--speed", "1000"));
+  options.network_task = arguments.flag("--network-task");
+  options.rtl = arguments.flag("--rtl");
+  options.limit = std::stoi(arguments.value("--limit", "6"));
+  if (options.speed < 1.0 || options.speed > 1000.0) {
+    fprintf(stderr, "--speed must be between 1 and 1000\n");
+    return EXIT_FAILURE;
+  }
+
+  std::vector<ReplayScenario> scenarios;
+  std::string scenario = arguments.value("--scenario", "all");
+  if (scenario == "all") {
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+      scenarios.push_back(ReplayScenario(i));
+    }
+  } else {
+    ReplayScenario parsed;
+    if (!parse_scenario(scenario, &parsed)) {
+      return usage();
+    }
+    scenarios.push_back(parsed);
+  }
+
+  printf("%s: %zu events over %" PRIu32 "s at %gx%s\n", arguments.positional[0].c_str(), trace.events.size(),
+         trace.duration_ms() / 1000, options.speed, options.network_task ? ", network task" : "");
+  print_report_header();
+
+  bool check = arguments.flag("--check");
+  bool passed = true;
+  for (ReplayScenario scenario : scenarios) {
+    options.scenario = scenario;
+    ReplayReport report = run_replay(trace, options);
+    print_report(report);
+
+    if (!check) {
+      continue;
+    }
+
+    // Every scenario must end with the tracker receiving schedules again,
+    // without a reboot; faults that break the connection must reconnect
+    std::vector<std::string> failures;
+    if (report.rebooted) {
+      failures.push_back("rebooted");
+    }
+    if (report.ingested == 0 || (scenario != SCENARIO_STEADY && report.ingested_after_fault == 0)) {
+      failures.push_back("no schedules after the fault");
+    }
+    if (report.dropped > 0) {
+      failures.push_back("dropped messages");
+    }
+    if (scenario == SCENARIO_STEADY || scenario == SCENARIO_BURST) {
+      if (report.reconnects > 0 || report.lost > 0) {
+        failures.push_back("reconnected or lost messages on a healthy connection");
+      }
+    } else if (report.reconnects == 0) {
+      failures.push_back("never reconnected");
+    }
+
+    for (const std::string &failure : failures) {
+      fprintf(stderr, "%s: %s\n", report.scenario.c_str(), failure.c_str());
+    }
+    passed &= failures.empty();
+  }
+
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  setvbuf(stdout, nullptr, _IOLBF, 0);
+  if (argc < 2) {
+    return usage();
+  }
+
+  Arguments arguments;
+  if (!parse_arguments(argc, argv, &arguments)) {
+    return usage();
+  }
+
+  // Reconnects log warnings by design; TT_LOG_LEVEL still overrides this
+  if (getenv("TT_LOG_LEVEL") == nullptr) {
+    set_log_level(ESPHOME_LOG_LEVEL_ERROR);
+  }
+
+  std::string command = argv[1];
+  if (command == "synthesize") {
+    return synthesize(arguments);
+  }
+  if (command == "record") {
+    return record(arguments);
+  }
+  if (command == "replay") {
+    return replay(arguments);
+  }
+  return usage();
+}